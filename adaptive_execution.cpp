@@ -0,0 +1,85 @@
+#include "adaptive_execution.h"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+ExecutionCostModel ExecutionCostModel::Default() {
+    ExecutionCostModel model;
+    model.thread_count = max(1u, thread::hardware_concurrency());
+    return model;
+}
+
+ExecutionPlanner::ExecutionPlanner() : model_(ExecutionCostModel::Default()) {
+}
+
+ExecutionPlanner::ExecutionPlanner(const ExecutionPlanner& other) : model_(other.model_) {
+    CopyMetrics(other);
+}
+
+ExecutionPlanner& ExecutionPlanner::operator=(const ExecutionPlanner& other) {
+    if (this != &other) {
+        model_ = other.model_;
+        CopyMetrics(other);
+    }
+    return *this;
+}
+
+ExecutionDecision ExecutionPlanner::Plan(const ExecutionOperation operation, const uint64_t work) const {
+    const double sequential_ns = static_cast<double>(work) * model_.unit_cost_ns[static_cast<int>(operation)];
+    const double parallel_ns = model_.parallel_overhead_ns + sequential_ns / static_cast<double>(model_.thread_count);
+
+    ExecutionDecision decision;
+    if (model_.thread_count > 1 && parallel_ns < sequential_ns) {
+        decision.parallel = true;
+        if (operation == ExecutionOperation::SEARCH) {
+            //Задача должна окупать свой запуск; задач больше, чем потоков, чтобы выровнять неравные диапазоны
+            const double task_count = sequential_ns / max(model_.parallel_overhead_ns, 1.0);
+            decision.task_count = static_cast<size_t>(clamp(task_count, 2.0, 4.0 * model_.thread_count));
+        } else {
+            //Слова MATCH и REMOVE делит между потоками сам параллельный алгоритм
+            decision.task_count = model_.thread_count;
+        }
+    }
+
+    AtomicCounters& counters = counters_[static_cast<int>(operation)];
+    if (decision.parallel) {
+        counters.parallel.fetch_add(1, memory_order_relaxed);
+        counters.tasks.fetch_add(decision.task_count, memory_order_relaxed);
+    } else {
+        counters.sequential.fetch_add(1, memory_order_relaxed);
+    }
+    counters.work.fetch_add(work, memory_order_relaxed);
+    return decision;
+}
+
+ExecutionMetrics ExecutionPlanner::GetMetrics() const {
+    ExecutionMetrics metrics;
+    for (int i = 0; i < EXECUTION_OPERATION_COUNT; ++i) {
+        metrics.operations[i].sequential = counters_[i].sequential.load(memory_order_relaxed);
+        metrics.operations[i].parallel = counters_[i].parallel.load(memory_order_relaxed);
+        metrics.operations[i].tasks = counters_[i].tasks.load(memory_order_relaxed);
+        metrics.operations[i].work = counters_[i].work.load(memory_order_relaxed);
+    }
+    return metrics;
+}
+
+void ExecutionPlanner::ResetMetrics() {
+    for (AtomicCounters& counters : counters_) {
+        counters.sequential.store(0, memory_order_relaxed);
+        counters.parallel.store(0, memory_order_relaxed);
+        counters.tasks.store(0, memory_order_relaxed);
+        counters.work.store(0, memory_order_relaxed);
+    }
+}
+
+void ExecutionPlanner::CopyMetrics(const ExecutionPlanner& other) {
+    const ExecutionMetrics metrics = other.GetMetrics();
+    for (int i = 0; i < EXECUTION_OPERATION_COUNT; ++i) {
+        counters_[i].sequential.store(metrics.operations[i].sequential, memory_order_relaxed);
+        counters_[i].parallel.store(metrics.operations[i].parallel, memory_order_relaxed);
+        counters_[i].tasks.store(metrics.operations[i].tasks, memory_order_relaxed);
+        counters_[i].work.store(metrics.operations[i].work, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Политика выполнения для FindTopDocuments, MatchDocument и RemoveDocument SearchServer:
+ * вместо std::execution::seq или par сервер сам оценивает стоимость вызова и выбирает
+ * последовательное или параллельное выполнение и число задач, см. ExecutionPlanner.
+ */
+struct AdaptiveExecution {};
+
+inline constexpr AdaptiveExecution adaptive_execution{};
+
+enum class ExecutionOperation {
+    SEARCH,
+    MATCH,
+    REMOVE
+};
+
+constexpr int EXECUTION_OPERATION_COUNT = 3;
+
+/*
+ * Модель стоимости вызова. Работа вызова измеряется в единицах операции:
+ * SEARCH - постинги плюс-слов, умноженные на (1 + число минус-слов), так как каждый
+ * встреченный документ проверяется на все минус-слова; MATCH - слова запроса;
+ * REMOVE - слова документа.
+ * Последовательно вызов стоит work * unit_cost_ns, параллельно - parallel_overhead_ns
+ * на запуск задач плюс work * unit_cost_ns / thread_count.
+ */
+struct ExecutionCostModel {
+    std::array<double, EXECUTION_OPERATION_COUNT> unit_cost_ns = {20.0, 200.0, 50.0};
+    double parallel_overhead_ns = 250000.0;
+    size_t thread_count = 1;
+
+    /*
+     * Модель по умолчанию для числа потоков машины, без замеров.
+     */
+    static ExecutionCostModel Default();
+};
+
+struct ExecutionDecision {
+    bool parallel = false;
+    //Число задач, на которые делится параллельный вызов; 1 для последовательного
+    size_t task_count = 1;
+};
+
+/*
+ * Счётчики принятых решений по каждой операции.
+ */
+struct ExecutionMetrics {
+    struct Counters {
+        uint64_t sequential = 0;
+        uint64_t parallel = 0;
+        //Сумма task_count параллельных решений
+        uint64_t tasks = 0;
+        //Сумма оценок работы всех решений
+        uint64_t work = 0;
+    };
+
+    std::array<Counters, EXECUTION_OPERATION_COUNT> operations;
+
+    const Counters& operator[](ExecutionOperation operation) const {
+        return operations[static_cast<int>(operation)];
+    }
+};
+
+/*
+ * Выбирает способ выполнения по модели стоимости и записывает каждое решение в метрики.
+ * Plan можно вызывать из нескольких потоков, SetCostModel - нет.
+ */
+class ExecutionPlanner {
+public:
+    ExecutionPlanner();
+
+    ExecutionPlanner(const ExecutionPlanner& other);
+
+    ExecutionPlanner& operator=(const ExecutionPlanner& other);
+
+    ExecutionDecision Plan(ExecutionOperation operation, uint64_t work) const;
+
+    const ExecutionCostModel& GetCostModel() const {
+        return model_;
+    }
+
+    void SetCostModel(const ExecutionCostModel& model) {
+        model_ = model;
+    }
+
+    ExecutionMetrics GetMetrics() const;
+
+    void ResetMetrics();
+
+private:
+    //Счётчики разнесены по строкам кэша, чтобы параллельные запросы разных операций не мешали друг другу
+    struct alignas(64) AtomicCounters {
+        std::atomic<uint64_t> sequential{0};
+        std::atomic<uint64_t> parallel{0};
+        std::atomic<uint64_t> tasks{0};
+        std::atomic<uint64_t> work{0};
+    };
+
+    ExecutionCostModel model_;
+    mutable std::array<AtomicCounters, EXECUTION_OPERATION_COUNT> counters_;
+
+    void CopyMetrics(const ExecutionPlanner& other);
+};
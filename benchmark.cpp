@@ -0,0 +1,659 @@
+#include "benchmark.h"
+#include "concurrent_hash_map.h"
+#include "corpus_loader.h"
+#include "durable_search_server.h"
+#include "frozen_search_server.h"
+#include "index_delta.h"
+#include "log_duration.h"
+#include "load_generator.h"
+#include "process_queries.h"
+#include "query_server.h"
+#include "segmented_search_server.h"
+#include "trace.h"
+
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count,
+                               int max_word_count) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+    }
+    return queries;
+}
+
+SearchServer BuildBenchmarkServer(const vector<string>& documents) {
+    SearchServer search_server(string_view("and with"));
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    return search_server;
+}
+
+namespace {
+
+void PrintMemoryLine(ostream& out, const string& name, size_t bytes, const IndexMemoryStats& stats,
+                     int document_count) {
+    out << "  "s << name << ": "s << bytes << " B, "s
+        << (document_count > 0 ? bytes * 1.0 / document_count : 0.0) << " B/doc, "s
+        << (stats.posting_count > 0 ? bytes * 1.0 / stats.posting_count : 0.0) << " B/posting"s << endl;
+}
+
+}
+
+void BenchmarkMemory(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10000, 10);
+    for (const int document_count : {1000, 10000}) {
+        const auto documents = GenerateQueries(generator, dictionary, document_count, 70);
+        SearchServer search_server = [&out, &documents, document_count]() {
+            LOG_DURATION_STREAM("Build index of "s + to_string(document_count) + " documents"s, out);
+            return BuildBenchmarkServer(documents);
+        }();
+
+        const IndexMemoryStats stats = search_server.GetMemoryStats();
+        out << "Memory for "s << document_count << " documents, "s << stats.posting_count << " postings:"s << endl;
+        PrintMemoryLine(out, "term dictionary"s, stats.term_dictionary, stats, document_count);
+        PrintMemoryLine(out, "postings"s, stats.postings, stats, document_count);
+        PrintMemoryLine(out, "term frequencies"s, stats.term_frequencies, stats, document_count);
+        PrintMemoryLine(out, "forward index"s, stats.forward_index, stats, document_count);
+        PrintMemoryLine(out, "document attributes"s, stats.document_attributes, stats, document_count);
+        PrintMemoryLine(out, "stop words"s, stats.stop_words, stats, document_count);
+        PrintMemoryLine(out, "document ids"s, stats.document_ids, stats, document_count);
+        PrintMemoryLine(out, "tombstones"s, stats.tombstones, stats, document_count);
+        PrintMemoryLine(out, "spelling index"s, stats.spelling_index, stats, document_count);
+        PrintMemoryLine(out, "total"s, stats.Total(), stats, document_count);
+    }
+}
+
+void BenchmarkCorpusLoading(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20000, 70);
+    const auto path = filesystem::temp_directory_path() / "search_server_benchmark_corpus.tsv"s;
+    {
+        ofstream file(path, ios::binary);
+        for (size_t id = 0; id < documents.size(); ++id) {
+            file << id << "\tACTUAL\t1 2 3\t"s << documents[id] << '\n';
+        }
+    }
+
+    {
+        SearchServer search_server(string_view("and with"));
+        LOG_DURATION_STREAM("Load corpus line by line"s, out);
+        ifstream file(path, ios::binary);
+        string line;
+        while (getline(file, line)) {
+            istringstream fields(line);
+            int id;
+            string status;
+            string ratings;
+            string text;
+            fields >> id;
+            fields.ignore(1);
+            getline(fields, status, '\t');
+            getline(fields, ratings, '\t');
+            getline(fields, text);
+            search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+    for (const size_t threads : {size_t{1}, size_t{thread::hardware_concurrency()}}) {
+        SearchServer search_server(string_view("and with"));
+        LOG_DURATION_STREAM("LoadCorpus, "s + to_string(threads) + " threads"s, out);
+        LoadCorpus(path.string(), search_server, threads);
+    }
+    filesystem::remove(path);
+}
+
+void BenchmarkCompactScoring(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20000, 70);
+    //Широкие запросы: каждое слово встречается в заметной доле документов
+    const auto queries = GenerateQueries(generator, dictionary, 200, 10);
+    SearchServer search_server = BuildBenchmarkServer(documents);
+
+    vector<vector<Document>> results[2];
+    for (const ScoringMode mode : {ScoringMode::EXACT, ScoringMode::COMPACT}) {
+        search_server.SetScoringMode(mode);
+        auto& mode_results = results[static_cast<int>(mode)];
+        LOG_DURATION_STREAM(mode == ScoringMode::EXACT ? "Exact scoring"s
+                                                       : "Compact scoring, "s + scoring::GetKernelName(), out);
+        for (const string& query : queries) {
+            mode_results.push_back(search_server.FindTopDocuments(query));
+        }
+    }
+
+    double max_deviation = 0.0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        for (size_t j = 0; j < min(results[0][i].size(), results[1][i].size()); ++j) {
+            max_deviation = max(max_deviation, abs(results[0][i][j].relevance - results[1][i][j].relevance));
+        }
+    }
+    out << "Max relevance deviation of compact scoring: "s << max_deviation << endl;
+}
+
+void BenchmarkIntraQueryParallelism(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 100, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 50000, 30);
+    SearchServer search_server = BuildBenchmarkServer(documents);
+    //Запрос из двух частых слов: параллелизм по словам дал бы не больше двух потоков
+    const string query = dictionary[0] + " "s + dictionary[1];
+
+    {
+        LOG_DURATION_STREAM("Broad query, seq"s, out);
+        for (int i = 0; i < 20; ++i) {
+            search_server.FindTopDocuments(execution::seq, query);
+        }
+    }
+    {
+        LOG_DURATION_STREAM("Broad query, par by document ranges"s, out);
+        for (int i = 0; i < 20; ++i) {
+            search_server.FindTopDocuments(execution::par, query);
+        }
+    }
+}
+
+void BenchmarkBatchQueries(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20000, 50);
+    const auto queries = GenerateQueries(generator, dictionary, 2000, 5);
+    SearchServer search_server = BuildBenchmarkServer(documents);
+
+    {
+        LOG_DURATION_STREAM("ProcessQueries, "s + to_string(queries.size()) + " queries"s, out);
+        ProcessQueries(search_server, queries);
+    }
+    {
+        LOG_DURATION_STREAM("ProcessQueriesBatched, "s + to_string(queries.size()) + " queries"s, out);
+        ProcessQueriesBatched(search_server, queries);
+    }
+}
+
+void BenchmarkQueryServer(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 5000, 50);
+    const auto queries = GenerateQueries(generator, dictionary, 1000, 5);
+    SearchServer search_server = BuildBenchmarkServer(documents);
+
+    QueryServer query_server(search_server);
+    thread loop([&query_server]() {
+        query_server.Run();
+    });
+    for (const size_t pipeline_depth : {1, 32}) {
+        LoadTestOptions options;
+        options.port = query_server.GetPort();
+        options.pipeline_depth = pipeline_depth;
+        options.request_count = 2000;
+        out << "Query server, pipeline depth "s << pipeline_depth << ": "s << RunLoadTest(queries, options) << endl;
+    }
+    query_server.Stop();
+    loop.join();
+}
+
+void BenchmarkConcurrentIngestion(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20000, 50);
+
+    for (const int producer_count : {1, 2, 4, 8}) {
+        SegmentedSearchServer server(string_view("and with"));
+        LOG_DURATION_STREAM("SegmentedSearchServer ingestion, "s + to_string(producer_count) + " producers"s, out);
+        vector<thread> producers;
+        for (int producer = 0; producer < producer_count; ++producer) {
+            producers.emplace_back([&, producer]() {
+                for (size_t id = producer; id < documents.size(); id += producer_count) {
+                    server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1, 2, 3});
+                }
+            });
+        }
+        for (thread& producer : producers) {
+            producer.join();
+        }
+        server.WaitForMerges();
+    }
+}
+
+void BenchmarkImpactOrderedSearch(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2000, 10);
+    //Короткие частые запросы: по одному-два слова
+    const auto queries = GenerateQueries(generator, dictionary, 1000, 2);
+    for (const int document_count : {5000, 20000, 80000}) {
+        //Документы разной длины, иначе TF почти всех постингов совпадают и выдачу нельзя определить раньше
+        vector<string> documents;
+        documents.reserve(document_count);
+        for (int i = 0; i < document_count; ++i) {
+            documents.push_back(GenerateQuery(generator, dictionary, uniform_int_distribution(5, 100)(generator)));
+        }
+        SearchServer search_server = BuildBenchmarkServer(documents);
+        {
+            LOG_DURATION_STREAM("Build impact index, "s + to_string(document_count) + " documents"s, out);
+            search_server.BuildImpactIndex();
+        }
+        for (const ScoringMode mode : {ScoringMode::EXACT, ScoringMode::IMPACT}) {
+            search_server.SetScoringMode(mode);
+            LOG_DURATION_STREAM((mode == ScoringMode::EXACT ? "Exact"s : "Impact-ordered"s) + " top documents, "s
+                                + to_string(document_count) + " documents"s, out);
+            for (const string& query : queries) {
+                search_server.FindTopDocuments(query);
+            }
+        }
+    }
+}
+
+void BenchmarkSpellingSuggestions(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20000, 50);
+    const SearchServer search_server = [&out, &documents]() {
+        LOG_DURATION_STREAM("Build index of "s + to_string(documents.size()) + " documents"s, out);
+        return BuildBenchmarkServer(documents);
+    }();
+    {
+        //Та же работа, что индекс исправлений делает при наполнении сервера
+        LOG_DURATION_STREAM("Spelling index of "s + to_string(dictionary.size()) + " terms"s, out);
+        SpellingIndex spelling_index;
+        for (size_t term = 0; term < dictionary.size(); ++term) {
+            spelling_index.AddTerm(term, dictionary[term]);
+        }
+    }
+
+    //Опечатки: одна или две замены символа в словах словаря
+    vector<string> misspelled;
+    for (int i = 0; i < 10000; ++i) {
+        string word = dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        for (int edit = uniform_int_distribution(1, 2)(generator); edit > 0; --edit) {
+            word[uniform_int_distribution<size_t>(0, word.size() - 1)(generator)] = uniform_int_distribution('a', 'z')(generator);
+        }
+        misspelled.push_back(move(word));
+    }
+    size_t found = 0;
+    const auto start = chrono::steady_clock::now();
+    for (const string& word : misspelled) {
+        found += search_server.SuggestCorrections(word).empty() ? 0 : 1;
+    }
+    const auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+    out << "Suggestions for "s << misspelled.size() << " misspelled words: "s << elapsed.count() / 1000 / misspelled.size()
+        << " us/word, "s << found << " words with suggestions"s << endl;
+}
+
+void BenchmarkMemoryResources(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20000, 50);
+    const auto queries = GenerateQueries(generator, dictionary, 2000, 5);
+
+    const auto run = [&](const string& name, const MemoryOptions& memory) {
+        SearchServer search_server(string_view("and with"), memory);
+        {
+            LOG_DURATION_STREAM(name + ": ingest "s + to_string(documents.size()) + " documents"s, out);
+            for (size_t i = 0; i < documents.size(); ++i) {
+                search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            }
+        }
+        {
+            LOG_DURATION_STREAM(name + ": "s + to_string(queries.size()) + " queries"s, out);
+            ProcessQueries(search_server, queries);
+        }
+        {
+            LOG_DURATION_STREAM(name + ": remove "s + to_string(documents.size() / 2) + " documents"s, out);
+            for (size_t i = 0; i < documents.size(); i += 2) {
+                search_server.RemoveDocument(i);
+            }
+        }
+    };
+
+    run("Default allocator"s, MemoryOptions{pmr::get_default_resource(), false});
+    {
+        pmr::unsynchronized_pool_resource pool;
+        run("Pool resource, query arenas"s, MemoryOptions{&pool, true});
+    }
+    {
+        pmr::synchronized_pool_resource pool;
+        run("Synchronized pool resource, query arenas"s, MemoryOptions{&pool, true});
+    }
+}
+
+void BenchmarkConcurrentHashMap(ostream& out) {
+    const int operation_count = 2'000'000;
+    for (const int key_count : {64, 100'000}) {
+        for (const int thread_count : {1, 2, 4, 8}) {
+            const auto run = [&](const string& name, auto& map, auto add) {
+                LOG_DURATION_STREAM(name + ", "s + to_string(key_count) + " keys, "s + to_string(thread_count)
+                                    + " threads"s, out);
+                vector<thread> threads;
+                for (int t = 0; t < thread_count; ++t) {
+                    threads.emplace_back([&, t] {
+                        mt19937 generator(t);
+                        uniform_int_distribution<int> key_distribution(0, key_count - 1);
+                        for (int i = 0; i < operation_count / thread_count; ++i) {
+                            add(map, key_distribution(generator));
+                        }
+                    });
+                }
+                for (thread& thread : threads) {
+                    thread.join();
+                }
+            };
+            {
+                unordered_map<int, double> locked_map;
+                mutex locked_map_mutex;
+                run("unordered_map + mutex"s, locked_map, [&locked_map_mutex](unordered_map<int, double>& map,
+                                                                               const int key) {
+                    lock_guard lock(locked_map_mutex);
+                    map[key] += 1.0;
+                });
+            }
+            ConcurrentHashMap<int, double> concurrent_hash_map;
+            run("ConcurrentHashMap"s, concurrent_hash_map, [](ConcurrentHashMap<int, double>& map, const int key) {
+                map.Add(key, 1.0);
+            });
+        }
+    }
+}
+
+void BenchmarkDocumentReordering(ostream& out) {
+    //Документы 32 тем со своими словарями, id перемешаны
+    mt19937 generator;
+    const int topic_count = 32;
+    const int document_count = 40000;
+    vector<vector<string>> topics;
+    for (int topic = 0; topic < topic_count; ++topic) {
+        topics.push_back(GenerateDictionary(generator, 300, 8));
+        for (string& word : topics.back()) {
+            word += to_string(topic);
+        }
+    }
+    vector<int> ids(document_count);
+    iota(ids.begin(), ids.end(), 0);
+    shuffle(ids.begin(), ids.end(), generator);
+    vector<string> texts(document_count);
+    for (int i = 0; i < document_count; ++i) {
+        texts[i] = GenerateQuery(generator, topics[i % topic_count], 40);
+    }
+    vector<string> queries;
+    for (int i = 0; i < 2000; ++i) {
+        queries.push_back(GenerateQuery(generator, topics[i % topic_count], 3));
+    }
+
+    vector<SegmentDocument> documents;
+    map<int, map<string_view, double>> word_freqs;
+    SegmentPostings postings;
+    for (int i = 0; i < document_count; ++i) {
+        documents.push_back({ids[i], DocumentStatus::ACTUAL, 0});
+        const vector<string_view> words = SplitIntoWords(texts[i]);
+        for (const string_view word : words) {
+            word_freqs[ids[i]][word] += 1.0 / words.size();
+        }
+    }
+    for (const auto& [id, freqs] : word_freqs) {
+        for (const auto& [word, freq] : freqs) {
+            postings[word].emplace_back(id, freq);
+        }
+    }
+    for (const DocumentOrder order : {DocumentOrder::BY_ID, DocumentOrder::BY_SIMILARITY}) {
+        const string name = order == DocumentOrder::BY_ID ? "by id"s : "by similarity"s;
+        size_t bytes = 0;
+        {
+            LOG_DURATION_STREAM("IndexSegment of "s + to_string(document_count) + " documents "s + name, out);
+            bytes = IndexSegment(documents, postings, order).GetGapEncodedPostingBytes();
+        }
+        out << "  gap-encoded postings: "s << bytes << " B"s << endl;
+
+        SegmentPolicy policy;
+        policy.background_merge = false;
+        policy.merge_order = order;
+        SegmentedSearchServer server(string_view(""), policy);
+        for (int i = 0; i < document_count; ++i) {
+            server.AddDocument(ids[i], texts[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        server.Flush();
+        LOG_DURATION_STREAM("SegmentedSearchServer, merged "s + name + ", "s + to_string(queries.size()) + " queries"s,
+                            out);
+        for (const string& query : queries) {
+            server.FindTopDocuments(query);
+        }
+    }
+}
+
+void BenchmarkFrozenSearchServer(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20000, 70);
+    const auto queries = GenerateQueries(generator, dictionary, 2000, 5);
+    const SearchServer search_server = BuildBenchmarkServer(documents);
+    const FrozenSearchServer frozen = [&out, &search_server]() {
+        LOG_DURATION_STREAM("Freeze index of "s + to_string(search_server.GetDocumentCount()) + " documents"s, out);
+        return FrozenSearchServer(search_server);
+    }();
+    out << "  SearchServer: "s << search_server.GetMemoryStats().Total() << " B, frozen: "s
+        << frozen.GetMemoryUsage() << " B"s << endl;
+
+    const auto run = [&out, &queries](const string& name, const auto& server) {
+        LOG_DURATION_STREAM(name + ", "s + to_string(queries.size()) + " queries"s, out);
+        for (const string& query : queries) {
+            server.FindTopDocuments(query);
+        }
+    };
+    run("SearchServer"s, search_server);
+    run("FrozenSearchServer"s, frozen);
+}
+
+void BenchmarkAdaptiveExecution(ostream& out) {
+    //Много коротких запросов и немного длинных
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10000, 30);
+    vector<string> queries = GenerateQueries(generator, dictionary, 500, 3);
+    for (int i = 0; i < 20; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, 40, 0.1));
+    }
+    SearchServer search_server = BuildBenchmarkServer(documents);
+
+    const auto run = [&out, &queries](const string& name, const auto& policy, const SearchServer& server) {
+        LOG_DURATION_STREAM(name + ", "s + to_string(queries.size()) + " queries"s, out);
+        for (const string& query : queries) {
+            server.FindTopDocuments(policy, query);
+        }
+    };
+    const auto print_metrics = [&out, &search_server]() {
+        const ExecutionMetrics::Counters counters = search_server.GetExecutionMetrics()[ExecutionOperation::SEARCH];
+        out << "  sequential: "s << counters.sequential << ", parallel: "s << counters.parallel
+            << ", tasks: "s << counters.tasks << endl;
+        search_server.ResetExecutionMetrics();
+    };
+    run("seq"s, execution::seq, search_server);
+    run("par"s, execution::par, search_server);
+    run("adaptive, default model"s, adaptive_execution, search_server);
+    print_metrics();
+    {
+        LOG_DURATION_STREAM("Calibrate execution"s, out);
+        search_server.CalibrateExecution();
+    }
+    const ExecutionCostModel& model = search_server.GetExecutionCostModel();
+    out << "  threads: "s << model.thread_count << ", overhead: "s << model.parallel_overhead_ns
+        << " ns, posting: "s << model.unit_cost_ns[static_cast<int>(ExecutionOperation::SEARCH)] << " ns"s << endl;
+    run("adaptive, calibrated model"s, adaptive_execution, search_server);
+    print_metrics();
+}
+
+void BenchmarkConjunctiveQuery(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 200, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20000, 40);
+    vector<string> queries;
+    for (int i = 0; i < 200; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, 3));
+    }
+    const SearchServer search_server = BuildBenchmarkServer(documents);
+
+    //Прежний способ: обычный поиск, каждый кандидат проверяется через MatchDocument
+    size_t candidate_count = 0;
+    {
+        LOG_DURATION_STREAM("FindTopDocuments + MatchDocument, "s + to_string(queries.size()) + " queries"s, out);
+        for (const string& query : queries) {
+            const size_t word_count = SplitIntoWords(query).size();
+            search_server.FindTopDocuments(query, [&](int document_id, DocumentStatus, int) {
+                ++candidate_count;
+                return get<0>(search_server.MatchDocument(query, document_id)).size() == word_count;
+            });
+        }
+    }
+    out << "  candidates: "s << candidate_count << endl;
+
+    candidate_count = 0;
+    {
+        LOG_DURATION_STREAM("FindTopDocumentsConjunctive, "s + to_string(queries.size()) + " queries"s, out);
+        for (const string& query : queries) {
+            search_server.FindTopDocumentsConjunctive(query, DocumentFilter(), [&](int, DocumentStatus, int) {
+                ++candidate_count;
+                return true;
+            });
+        }
+    }
+    out << "  candidates: "s << candidate_count << endl;
+}
+
+void BenchmarkTracing(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10000, 30);
+    const auto queries = GenerateQueries(generator, dictionary, 2000, 3);
+    const SearchServer search_server = BuildBenchmarkServer(documents);
+
+    for (const bool enabled : {false, true}) {
+        tracing::Clear();
+        tracing::SetEnabled(enabled);
+        {
+            LOG_DURATION_STREAM("Tracing "s + (enabled ? "on"s : "off"s) + ", "s + to_string(queries.size())
+                                + " queries"s, out);
+            for (const string& query : queries) {
+                search_server.FindTopDocuments(query);
+            }
+        }
+        ostringstream trace;
+        tracing::WriteChromeTrace(trace);
+        out << "  events: "s << tracing::CollectEvents().size() << ", slow queries: "s
+            << tracing::GetSlowQueries().size() << ", trace JSON: "s << trace.str().size() << " B"s << endl;
+    }
+    tracing::SetEnabled(false);
+    tracing::Clear();
+}
+
+void BenchmarkIndexDelta(ostream& out) {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10000, 30);
+    const auto directory = filesystem::temp_directory_path() / "search_server_delta_benchmark"s;
+    filesystem::remove_all(directory);
+
+    DurableSearchServer source(directory.string(), "and with"s);
+    size_t text_size = 0;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        source.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        text_size += documents[i].size();
+    }
+    source.Sync();
+    const size_t half = documents.size() / 2;
+
+    {
+        LOG_DURATION_STREAM("Replay AddDocument, "s + to_string(documents.size()) + " documents"s, out);
+        BuildBenchmarkServer(documents);
+    }
+    string delta;
+    {
+        LOG_DURATION_STREAM("Export full delta"s, out);
+        delta = source.ExportDelta(0);
+    }
+    out << "  delta: "s << delta.size() << " B, texts: "s << text_size << " B"s << endl;
+    {
+        LOG_DURATION_STREAM("Apply full delta"s, out);
+        IndexReplica replica;
+        replica.Apply(delta);
+    }
+    IndexReplica replica;
+    replica.Apply(source.ExportDelta(0));
+    {
+        //Вторая половина документов заменяется, реплика догоняет одной дельтой
+        for (size_t i = half; i < documents.size(); ++i) {
+            source.RemoveDocument(static_cast<int>(i));
+            source.AddDocument(static_cast<int>(i), documents[documents.size() - 1 - i],
+                               DocumentStatus::ACTUAL, {4});
+        }
+        const string update = source.ExportDelta(replica.GetSequence());
+        LOG_DURATION_STREAM("Apply delta replacing "s + to_string(documents.size() - half) + " documents"s, out);
+        replica.Apply(update);
+    }
+    out << "  replica checksum matches: "s << (replica.GetChecksum() == source.GetChecksum() ? "yes"s : "no"s) << endl;
+    filesystem::remove_all(directory);
+}
+
+void RunBenchmarks(ostream& out) {
+    BenchmarkMemory(out);
+    BenchmarkCorpusLoading(out);
+    BenchmarkCompactScoring(out);
+    BenchmarkIntraQueryParallelism(out);
+    BenchmarkBatchQueries(out);
+    BenchmarkQueryServer(out);
+    BenchmarkConcurrentIngestion(out);
+    BenchmarkImpactOrderedSearch(out);
+    BenchmarkSpellingSuggestions(out);
+    BenchmarkMemoryResources(out);
+    BenchmarkConcurrentHashMap(out);
+    BenchmarkDocumentReordering(out);
+    BenchmarkFrozenSearchServer(out);
+    BenchmarkAdaptiveExecution(out);
+    BenchmarkConjunctiveQuery(out);
+    BenchmarkTracing(out);
+    BenchmarkIndexDelta(out);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "search_server.h"
+
+/*
+ * Генерация синтетического корпуса для замеров скорости и памяти.
+ * Документы и запросы составляются из случайных слов общего словаря.
+ */
+std::string GenerateWord(std::mt19937& generator, int max_length);
+
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length);
+
+std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int word_count,
+                          double minus_prob = 0);
+
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary,
+                                         int query_count, int max_word_count);
+
+SearchServer BuildBenchmarkServer(const std::vector<std::string>& documents);
+
+/*
+ * Память индекса по структурам, в байтах на документ и на постинг.
+ */
+void BenchmarkMemory(std::ostream& out);
+
+/*
+ * Загрузка корпуса из файла построчным чтением и LoadCorpus.
+ */
+void BenchmarkCorpusLoading(std::ostream& out);
+
+/*
+ * Точный и компактный подсчёт релевантности на широких запросах.
+ */
+void BenchmarkCompactScoring(std::ostream& out);
+
+/*
+ * Один широкий запрос последовательно и с разбиением по диапазонам id.
+ */
+void BenchmarkIntraQueryParallelism(std::ostream& out);
+
+/*
+ * Пакет запросов с общими словами: по одному и с общим обходом постингов.
+ */
+void BenchmarkBatchQueries(std::ostream& out);
+
+/*
+ * QPS и задержки QueryServer через петлевой интерфейс, без конвейера и с конвейером.
+ */
+void BenchmarkQueryServer(std::ostream& out);
+
+/*
+ * Наполнение SegmentedSearchServer из нескольких потоков-производителей.
+ */
+void BenchmarkConcurrentIngestion(std::ostream& out);
+
+/*
+ * Короткие запросы в точном режиме и с обходом постингов по убыванию вклада на корпусах разного размера.
+ */
+void BenchmarkImpactOrderedSearch(std::ostream& out);
+
+/*
+ * Построение индекса исправлений и время подбора исправлений на слово с опечаткой.
+ */
+void BenchmarkSpellingSuggestions(std::ostream& out);
+
+/*
+ * Наполнение, запросы и удаление с распределителем по умолчанию и с пулами узлов индекса и аренами запросов.
+ */
+void BenchmarkMemoryResources(std::ostream& out);
+
+/*
+ * Сложение в общую карту из нескольких потоков: unordered_map под одним мьютексом
+ * против ConcurrentHashMap на малом (сильная конкуренция) и большом числе ключей.
+ */
+void BenchmarkConcurrentHashMap(std::ostream& out);
+
+/*
+ * Размер постингов при кодировании разностей и скорость запросов к сегментам
+ * с документами по id и по сходству на корпусе из тематических документов.
+ */
+void BenchmarkDocumentReordering(std::ostream& out);
+
+/*
+ * Память и скорость запросов SearchServer и замороженного из него FrozenSearchServer.
+ */
+void BenchmarkFrozenSearchServer(std::ostream& out);
+
+/*
+ * Поиск с seq, par и adaptive_execution до и после самонастройки, с числом принятых решений.
+ */
+void BenchmarkAdaptiveExecution(std::ostream& out);
+
+/*
+ * Запросы "все слова": обычный поиск с проверкой кандидатов через MatchDocument
+ * против пересечения постингов в FindTopDocumentsConjunctive, с числом проверенных кандидатов.
+ */
+void BenchmarkConjunctiveQuery(std::ostream& out);
+
+/*
+ * Цена трассировки: поиск с выключенной и включённой записью интервалов, размер выгрузки.
+ */
+void BenchmarkTracing(std::ostream& out);
+
+/*
+ * Репликация: воспроизведение AddDocument на реплике против применения дельты
+ * с теми же документами, размер дельты против размера текстов.
+ */
+void BenchmarkIndexDelta(std::ostream& out);
+
+void RunBenchmarks(std::ostream& out = std::cout);
@@ -0,0 +1,34 @@
+#include "binary_format.h"
+
+#include <array>
+
+using namespace std;
+
+namespace binary_format {
+
+namespace {
+
+array<uint32_t, 256> MakeCrc32Table() {
+    array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < table.size(); ++i) {
+        uint32_t value = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+        }
+        table[i] = value;
+    }
+    return table;
+}
+
+}
+
+uint32_t ComputeCrc32(const string_view data, uint32_t crc) {
+    static const array<uint32_t, 256> table = MakeCrc32Table();
+    crc ^= 0xFFFFFFFFu;
+    for (const char c : data) {
+        crc = table[(crc ^ static_cast<unsigned char>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/*
+ * Запись и чтение чисел и строк в little-endian двоичном формате, CRC32 для проверки целостности.
+ * Используется журналом изменений, снимками и дельтами индекса.
+ */
+namespace binary_format {
+
+template <typename Int>
+void PutInt(std::string& out, Int value) {
+    static_assert(std::is_integral_v<Int>);
+    for (size_t i = 0; i < sizeof(Int); ++i) {
+        out.push_back(static_cast<char>(static_cast<uint64_t>(value) >> (8 * i) & 0xFF));
+    }
+}
+
+//Число по 7 бит в байте, старший бит - признак продолжения
+inline void PutVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline void PutDouble(std::string& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    PutInt(out, bits);
+}
+
+inline void PutString(std::string& out, std::string_view value) {
+    PutInt(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+/*
+ * Последовательное чтение из буфера. При нехватке данных методы возвращают false
+ * и читатель переходит в состояние ошибки.
+ */
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data_(data) {}
+
+    template <typename Int>
+    bool GetInt(Int& value) {
+        static_assert(std::is_integral_v<Int>);
+        if (!Require(sizeof(Int))) {
+            return false;
+        }
+        uint64_t result = 0;
+        for (size_t i = 0; i < sizeof(Int); ++i) {
+            result |= static_cast<uint64_t>(static_cast<unsigned char>(data_[i])) << (8 * i);
+        }
+        value = static_cast<Int>(result);
+        data_.remove_prefix(sizeof(Int));
+        return true;
+    }
+
+    bool GetVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!Require(1)) {
+                return false;
+            }
+            const auto byte = static_cast<unsigned char>(data_[0]);
+            data_.remove_prefix(1);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (byte < 0x80) {
+                return true;
+            }
+        }
+        ok_ = false;
+        return false;
+    }
+
+    bool GetDouble(double& value) {
+        uint64_t bits;
+        if (!GetInt(bits)) {
+            return false;
+        }
+        std::memcpy(&value, &bits, sizeof(bits));
+        return true;
+    }
+
+    //Строка ссылается на исходный буфер
+    bool GetString(std::string_view& value) {
+        uint32_t size;
+        if (!GetInt(size) || !Require(size)) {
+            return false;
+        }
+        value = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return true;
+    }
+
+    bool GetBytes(size_t size, std::string_view& value) {
+        if (!Require(size)) {
+            return false;
+        }
+        value = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return true;
+    }
+
+    size_t GetRemaining() const {
+        return data_.size();
+    }
+
+    bool IsOk() const {
+        return ok_;
+    }
+
+private:
+    std::string_view data_;
+    bool ok_ = true;
+
+    bool Require(size_t size) {
+        if (data_.size() < size) {
+            ok_ = false;
+        }
+        return ok_;
+    }
+};
+
+/*
+ * CRC32 данных data. Чтобы посчитать сумму по частям, в crc передаётся сумма предыдущих частей.
+ */
+uint32_t ComputeCrc32(std::string_view data, uint32_t crc = 0);
+
+}
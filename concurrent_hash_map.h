@@ -0,0 +1,376 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Конкурентная хеш-таблица с открытой адресацией и линейным пробированием.
+ * Ключ - любой тип с хешем Hash и сравнением KeyEqual. Значение - тривиально копируемый тип,
+ * хранится в std::atomic и меняется циклом CAS, поэтому сложение double в одну ячейку
+ * из многих потоков не теряет слагаемых.
+ * Чтение (Find, ForEach) не берёт блокировок. Новый ключ занимает свободную ячейку через CAS;
+ * читатель, попавший на ячейку в процессе записи ключа, дожидается её публикации.
+ * Таблица растёт на ходу: поток, упёршийся в предел заполнения, дожидается выхода пишущих потоков,
+ * переносит ячейки в таблицу вдвое больше и публикует её. Читатели в это время продолжают работать
+ * со старой таблицей, поэтому старые таблицы освобождаются только вместе с картой. Их суммарный
+ * размер (1/2 + 1/4 + ... текущей) почти равен текущей таблице: выросшая карта занимает около
+ * двух своих итоговых размеров. Если число ключей известно заранее, его стоит передать
+ * в конструктор как expected_size - тогда таблица не растёт и лишней памяти нет.
+ * Удаление ключей не поддерживается.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class ConcurrentHashMap {
+public:
+    static_assert(std::is_trivially_copyable_v<Value>, "ConcurrentHashMap stores values in std::atomic");
+
+    explicit ConcurrentHashMap(size_t expected_size = 0, Hash hash = Hash(), KeyEqual equal = KeyEqual())
+        : hash_(std::move(hash)), equal_(std::move(equal)) {
+        size_t capacity = MIN_CAPACITY;
+        while (capacity * MAX_LOAD_NUMERATOR / MAX_LOAD_DENOMINATOR < expected_size) {
+            capacity *= 2;
+        }
+        tables_.push_back(std::make_unique<Table>(capacity));
+        table_.store(tables_.back().get(), std::memory_order_release);
+    }
+
+    ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+    ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+    ~ConcurrentHashMap() {
+        for (const auto& table : tables_) {
+            table->DestroyKeys();
+        }
+    }
+
+    /*
+     * Вставляет пару, если ключа ещё нет. Возвращает, была ли вставка.
+     */
+    bool Insert(const Key& key, const Value& value) {
+        return WithSlot(key, value, [](std::atomic<Value>&, const bool inserted) {
+            return inserted;
+        });
+    }
+
+    void InsertOrAssign(const Key& key, const Value& value) {
+        WithSlot(key, value, [&value](std::atomic<Value>& slot_value, const bool inserted) {
+            if (!inserted) {
+                slot_value.store(value, std::memory_order_relaxed);
+            }
+            return true;
+        });
+    }
+
+    /*
+     * Атомарно заменяет значение ключа на func(значение), для нового ключа - на func(Value()).
+     * func может вызываться несколько раз, если значение одновременно меняют другие потоки.
+     * Возвращает новое значение.
+     */
+    template <typename Func>
+    Value Update(const Key& key, Func func) {
+        return WithSlot(key, func(Value()), [&func](std::atomic<Value>& slot_value, const bool inserted) {
+            Value current = slot_value.load(std::memory_order_relaxed);
+            if (inserted) {
+                return current;
+            }
+            Value updated = func(current);
+            while (!slot_value.compare_exchange_weak(current, updated, std::memory_order_relaxed)) {
+                updated = func(current);
+            }
+            return updated;
+        });
+    }
+
+    /*
+     * Прибавляет delta к значению ключа, отсутствующий ключ считается равным Value().
+     */
+    Value Add(const Key& key, const Value& delta) {
+        return Update(key, [&delta](const Value& value) {
+            return value + delta;
+        });
+    }
+
+    std::optional<Value> Find(const Key& key) const {
+        const Table& table = *table_.load(std::memory_order_acquire);
+        const size_t hash = hash_(key);
+        for (size_t i = table.GetIndex(hash);; i = (i + 1) & table.mask) {
+            const Slot& slot = table.slots[i];
+            if (WaitForSlot(slot) == EMPTY) {
+                return std::nullopt;
+            }
+            if (slot.hash == hash && equal_(slot.GetKey(), key)) {
+                return slot.value.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /*
+     * Вызывает func(key, value) для каждой пары без копирования всей таблицы.
+     * Обход слабо согласован: пары, вставленные во время обхода, могут в него не попасть.
+     */
+    template <typename Func>
+    void ForEach(Func func) const {
+        const Table& table = *table_.load(std::memory_order_acquire);
+        for (size_t i = 0; i <= table.mask; ++i) {
+            const Slot& slot = table.slots[i];
+            if (slot.state.load(std::memory_order_acquire) == FULL) {
+                func(slot.GetKey(), slot.value.load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+    //Число ключей; во время вставок может учитывать ещё не опубликованные
+    size_t size() const {
+        return table_.load(std::memory_order_acquire)->size.load(std::memory_order_relaxed);
+    }
+
+    size_t GetCapacity() const {
+        return table_.load(std::memory_order_acquire)->mask + 1;
+    }
+
+private:
+    static constexpr size_t MIN_CAPACITY = 16;
+    //Предел заполнения 3/4: при линейном пробировании цепочки ещё коротки
+    static constexpr size_t MAX_LOAD_NUMERATOR = 3;
+    static constexpr size_t MAX_LOAD_DENOMINATOR = 4;
+    //Число счётчиков пишущих потоков; поток пишет в свой, чтобы не делить строку кеша с другими
+    static constexpr size_t WRITER_STRIPES = 16;
+
+    enum : uint8_t { EMPTY, BUSY, FULL };
+
+    struct Slot {
+        std::atomic<uint8_t> state{EMPTY};
+        size_t hash = 0;
+        std::aligned_storage_t<sizeof(Key), alignof(Key)> key;
+        std::atomic<Value> value;
+
+        const Key& GetKey() const {
+            return *std::launder(reinterpret_cast<const Key*>(&key));
+        }
+    };
+
+    struct Table {
+        explicit Table(size_t capacity)
+            : slots(new Slot[capacity]),
+              mask(capacity - 1),
+              shift(64 - Log2(capacity)),
+              max_size(capacity * MAX_LOAD_NUMERATOR / MAX_LOAD_DENOMINATOR) {
+        }
+
+        //Фибоначчиево хеширование: старшие биты произведения перемешивают и последовательные хеши
+        size_t GetIndex(size_t hash) const {
+            return static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> shift);
+        }
+
+        void DestroyKeys() {
+            if constexpr (!std::is_trivially_destructible_v<Key>) {
+                for (size_t i = 0; i <= mask; ++i) {
+                    if (slots[i].state.load(std::memory_order_relaxed) == FULL) {
+                        std::launder(reinterpret_cast<Key*>(&slots[i].key))->~Key();
+                    }
+                }
+            }
+        }
+
+        static int Log2(size_t capacity) {
+            int log = 0;
+            while ((size_t{1} << log) < capacity) {
+                ++log;
+            }
+            return log;
+        }
+
+        std::unique_ptr<Slot[]> slots;
+        size_t mask;
+        int shift;
+        size_t max_size;
+        //Занятые и зарезервированные под вставку ячейки
+        std::atomic<size_t> size{0};
+    };
+
+    struct alignas(64) WriterCounter {
+        std::atomic<int> count{0};
+    };
+
+    //Пишущий поток внутри таблицы: рост ждёт, пока таких не останется
+    class WriterGuard {
+    public:
+        explicit WriterGuard(const ConcurrentHashMap& map) : counter_(map.writers_[GetStripe()].count) {
+            while (true) {
+                counter_.fetch_add(1, std::memory_order_seq_cst);
+                if (!map.resizing_.load(std::memory_order_seq_cst)) {
+                    table_ = map.table_.load(std::memory_order_acquire);
+                    return;
+                }
+                counter_.fetch_sub(1, std::memory_order_seq_cst);
+                while (map.resizing_.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        WriterGuard(const WriterGuard&) = delete;
+        WriterGuard& operator=(const WriterGuard&) = delete;
+
+        ~WriterGuard() {
+            counter_.fetch_sub(1, std::memory_order_seq_cst);
+        }
+
+        Table& GetTable() const {
+            return *table_;
+        }
+
+    private:
+        std::atomic<int>& counter_;
+        Table* table_ = nullptr;
+
+        static size_t GetStripe() {
+            static std::atomic<size_t> next_stripe{0};
+            thread_local const size_t stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % WRITER_STRIPES;
+            return stripe;
+        }
+    };
+
+    Hash hash_;
+    KeyEqual equal_;
+    std::atomic<Table*> table_{nullptr};
+    //Текущая таблица и все прежние, на которые ещё могут смотреть читатели
+    std::vector<std::unique_ptr<Table>> tables_;
+    mutable std::array<WriterCounter, WRITER_STRIPES> writers_;
+    std::atomic<bool> resizing_{false};
+    std::mutex grow_mutex_;
+
+    //Ждёт окончания записи ключа в ячейку и возвращает EMPTY или FULL
+    static uint8_t WaitForSlot(const Slot& slot) {
+        uint8_t state = slot.state.load(std::memory_order_acquire);
+        while (state == BUSY) {
+            std::this_thread::yield();
+            state = slot.state.load(std::memory_order_acquire);
+        }
+        return state;
+    }
+
+    /*
+     * Находит или вставляет ключ и вызывает func(атомарное значение, вставлен ли ключ)
+     * внутри WriterGuard, так что рост таблицы не потеряет изменение.
+     */
+    template <typename Func>
+    auto WithSlot(const Key& key, const Value& initial, Func func) {
+        const size_t hash = hash_(key);
+        while (true) {
+            Table* full_table = nullptr;
+            {
+                WriterGuard guard(*this);
+                Table& table = guard.GetTable();
+                const auto [value, inserted] = FindOrInsert(table, key, hash, initial);
+                if (value != nullptr) {
+                    return func(*value, inserted);
+                }
+                full_table = &table;
+            }
+            Grow(full_table);
+        }
+    }
+
+    /*
+     * Ячейка ключа в table и признак вставки, или nullptr, если новому ключу не хватило места.
+     */
+    std::pair<std::atomic<Value>*, bool> FindOrInsert(Table& table, const Key& key, const size_t hash,
+                                                       const Value& initial) {
+        for (size_t i = table.GetIndex(hash);; i = (i + 1) & table.mask) {
+            Slot& slot = table.slots[i];
+            while (WaitForSlot(slot) == EMPTY) {
+                if (table.size.fetch_add(1, std::memory_order_relaxed) >= table.max_size) {
+                    table.size.fetch_sub(1, std::memory_order_relaxed);
+                    return {nullptr, false};
+                }
+                uint8_t expected = EMPTY;
+                if (slot.state.compare_exchange_strong(expected, BUSY, std::memory_order_acquire)) {
+                    slot.hash = hash;
+                    try {
+                        new (&slot.key) Key(key);
+                    } catch (...) {
+                        slot.state.store(EMPTY, std::memory_order_release);
+                        table.size.fetch_sub(1, std::memory_order_relaxed);
+                        throw;
+                    }
+                    slot.value.store(initial, std::memory_order_relaxed);
+                    slot.state.store(FULL, std::memory_order_release);
+                    return {&slot.value, true};
+                }
+                //Ячейку заняли раньше, после публикации её ключ надо сравнить с нашим
+                table.size.fetch_sub(1, std::memory_order_relaxed);
+            }
+            if (slot.hash == hash && equal_(slot.GetKey(), key)) {
+                return {&slot.value, false};
+            }
+        }
+    }
+
+    /*
+     * Заменяет заполненную таблицу full_table вдвое большей, если этого ещё не сделал другой поток.
+     */
+    void Grow(Table* full_table) {
+        std::lock_guard lock(grow_mutex_);
+        if (table_.load(std::memory_order_acquire) != full_table) {
+            return;
+        }
+        resizing_.store(true, std::memory_order_seq_cst);
+        for (const WriterCounter& writer : writers_) {
+            while (writer.count.load(std::memory_order_seq_cst) != 0) {
+                std::this_thread::yield();
+            }
+        }
+
+        //Пишущих потоков нет, ячейки переносятся без синхронизации и старая таблица не меняется
+        std::unique_ptr<Table> grown;
+        try {
+            grown = Rehash(*full_table);
+        } catch (...) {
+            resizing_.store(false, std::memory_order_seq_cst);
+            throw;
+        }
+
+        table_.store(grown.get(), std::memory_order_release);
+        tables_.push_back(std::move(grown));
+        resizing_.store(false, std::memory_order_seq_cst);
+    }
+
+    //Таблица вдвое больше с парами table. Вызывается, когда пишущих потоков нет
+    static std::unique_ptr<Table> Rehash(const Table& table) {
+        auto grown = std::make_unique<Table>((table.mask + 1) * 2);
+        size_t size = 0;
+        for (size_t i = 0; i <= table.mask; ++i) {
+            const Slot& slot = table.slots[i];
+            if (slot.state.load(std::memory_order_relaxed) != FULL) {
+                continue;
+            }
+            size_t j = grown->GetIndex(slot.hash);
+            while (grown->slots[j].state.load(std::memory_order_relaxed) != EMPTY) {
+                j = (j + 1) & grown->mask;
+            }
+            Slot& target = grown->slots[j];
+            target.hash = slot.hash;
+            try {
+                new (&target.key) Key(slot.GetKey());
+            } catch (...) {
+                grown->DestroyKeys();
+                throw;
+            }
+            target.value.store(slot.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            target.state.store(FULL, std::memory_order_relaxed);
+            ++size;
+        }
+        grown->size.store(size, std::memory_order_relaxed);
+        return grown;
+    }
+};
@@ -0,0 +1,212 @@
+#include "corpus_loader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <execution>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+struct ParsedChunk {
+    string_view data;
+    size_t line_count = 0;
+    //Номера строк здесь отсчитываются от начала куска
+    vector<CorpusRecord> records;
+    vector<CorpusError> errors;
+};
+
+class MappedFile {
+public:
+    explicit MappedFile(const string& path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("Can't open corpus file "s + path);
+        }
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) != 0) {
+            close(fd);
+            throw runtime_error("Can't stat corpus file "s + path);
+        }
+        size_ = file_stat.st_size;
+        if (size_ > 0) {
+            data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (data_ == MAP_FAILED) {
+            throw runtime_error("Can't map corpus file "s + path);
+        }
+        if (size_ > 0) {
+            madvise(data_, size_, MADV_SEQUENTIAL);
+        }
+    }
+
+    ~MappedFile() {
+        if (size_ > 0) {
+            munmap(data_, size_);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    string_view GetData() const {
+        return {static_cast<const char*>(data_), size_};
+    }
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+bool ParseInt(string_view text, int& value) {
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    return error == errc() && end == text.data() + text.size();
+}
+
+bool ParseStatus(string_view text, DocumentStatus& status) {
+    static const pair<string_view, DocumentStatus> names[] = {
+        {"ACTUAL"sv, DocumentStatus::ACTUAL},
+        {"IRRELEVANT"sv, DocumentStatus::IRRELEVANT},
+        {"BANNED"sv, DocumentStatus::BANNED},
+        {"REMOVED"sv, DocumentStatus::REMOVED},
+    };
+    for (const auto& [name, value] : names) {
+        if (text == name) {
+            status = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+//Отрезает от line поле до табуляции
+bool TakeField(string_view& line, string_view& field) {
+    const size_t tab = line.find('\t');
+    if (tab == line.npos) {
+        return false;
+    }
+    field = line.substr(0, tab);
+    line.remove_prefix(tab + 1);
+    return true;
+}
+
+}
+
+string ParseCorpusRecord(string_view line, CorpusRecord& record) {
+    string_view id_field;
+    string_view status_field;
+    string_view ratings_field;
+    if (!TakeField(line, id_field) || !TakeField(line, status_field) || !TakeField(line, ratings_field)) {
+        return "expected 4 tab-separated fields"s;
+    }
+    if (!ParseInt(id_field, record.document_id) || record.document_id < 0) {
+        return "invalid document id '"s + string(id_field) + "'"s;
+    }
+    if (!ParseStatus(status_field, record.status)) {
+        return "invalid status '"s + string(status_field) + "'"s;
+    }
+    while (true) {
+        const size_t start = ratings_field.find_first_not_of(' ');
+        if (start == ratings_field.npos) {
+            break;
+        }
+        ratings_field.remove_prefix(start);
+        const string_view rating_text = ratings_field.substr(0, ratings_field.find(' '));
+        int rating = 0;
+        if (!ParseInt(rating_text, rating)) {
+            return "invalid rating '"s + string(rating_text) + "'"s;
+        }
+        record.ratings.push_back(rating);
+        ratings_field.remove_prefix(rating_text.size());
+    }
+    record.text = line;
+    return {};
+}
+
+namespace {
+
+void ParseChunk(ParsedChunk& chunk) {
+    string_view data = chunk.data;
+    while (!data.empty()) {
+        const size_t end = data.find('\n');
+        string_view line = data.substr(0, end);
+        data.remove_prefix(end == data.npos ? data.size() : end + 1);
+        ++chunk.line_count;
+
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        CorpusRecord record;
+        record.line = chunk.line_count;
+        if (string error = ParseCorpusRecord(line, record); !error.empty()) {
+            chunk.errors.push_back({chunk.line_count, move(error)});
+            continue;
+        }
+        chunk.records.push_back(move(record));
+    }
+}
+
+//Делит данные на куски примерно равного размера, заканчивающиеся переводом строки
+vector<ParsedChunk> SplitIntoChunks(string_view data, size_t chunk_count) {
+    vector<ParsedChunk> chunks;
+    const size_t chunk_size = max<size_t>(1, data.size() / chunk_count);
+    while (!data.empty()) {
+        size_t end = data.size();
+        if (chunk_size < data.size()) {
+            const size_t line_end = data.find('\n', chunk_size);
+            end = line_end == data.npos ? data.size() : line_end + 1;
+        }
+        chunks.emplace_back().data = data.substr(0, end);
+        data.remove_prefix(end);
+    }
+    return chunks;
+}
+
+}
+
+CorpusLoadResult LoadCorpusFromMemory(string_view data, SearchServer& search_server, size_t thread_count) {
+    //Кусков больше, чем потоков, чтобы выровнять нагрузку
+    vector<ParsedChunk> chunks = SplitIntoChunks(data, max<size_t>(1, thread_count) * 4);
+    if (thread_count > 1) {
+        for_each(execution::par, chunks.begin(), chunks.end(), ParseChunk);
+    } else {
+        for_each(chunks.begin(), chunks.end(), ParseChunk);
+    }
+
+    CorpusLoadResult result;
+    size_t first_line = 0;
+    for (ParsedChunk& chunk : chunks) {
+        auto error = chunk.errors.begin();
+        const auto flush_errors_before = [&](size_t line) {
+            for (; error != chunk.errors.end() && error->line < line; ++error) {
+                result.errors.push_back({first_line + error->line, move(error->message)});
+            }
+        };
+        for (const CorpusRecord& record : chunk.records) {
+            flush_errors_before(record.line);
+            try {
+                search_server.AddDocument(record.document_id, record.text, record.status, record.ratings);
+                ++result.loaded;
+            } catch (const invalid_argument& e) {
+                result.errors.push_back({first_line + record.line, e.what()});
+            }
+        }
+        flush_errors_before(chunk.line_count + 1);
+        first_line += chunk.line_count;
+    }
+    return result;
+}
+
+CorpusLoadResult LoadCorpus(const string& path, SearchServer& search_server, size_t thread_count) {
+    const MappedFile file(path);
+    return LoadCorpusFromMemory(file.GetData(), search_server, thread_count);
+}
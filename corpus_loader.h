@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+/*
+ * Загрузка корпуса документов из файла.
+ *
+ * Формат: одна запись на строку, поля разделены табуляцией:
+ *     id <TAB> status <TAB> ratings <TAB> text
+ * id - неотрицательное целое, status - ACTUAL, IRRELEVANT, BANNED или REMOVED,
+ * ratings - целые через пробел (поле может быть пустым), text - текст документа до конца строки.
+ * Пустые строки и строки, начинающиеся с #, пропускаются. Допускаются окончания строк \r\n.
+ */
+
+struct CorpusError {
+    //Номер строки, начиная с 1
+    size_t line = 0;
+    std::string message;
+};
+
+struct CorpusRecord {
+    //Номер строки, заполняется загрузчиком
+    size_t line = 0;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string_view text;
+};
+
+struct CorpusLoadResult {
+    size_t loaded = 0;
+    std::vector<CorpusError> errors;
+};
+
+/*
+ * Разбирает одну запись без перевода строки. Текст записи ссылается на line.
+ * Возвращает сообщение об ошибке или пустую строку.
+ */
+std::string ParseCorpusRecord(std::string_view line, CorpusRecord& record);
+
+/*
+ * Отображает файл в память, делит его на куски по границам строк и разбирает куски
+ * в thread_count потоков. Текст документов передаётся в SearchServer прямо из отображения.
+ * Ошибочные записи не прерывают загрузку, а попадают в errors с номером строки.
+ * Бросает runtime_error, только если файл не удаётся открыть.
+ */
+CorpusLoadResult LoadCorpus(const std::string& path, SearchServer& search_server,
+                            size_t thread_count = std::thread::hardware_concurrency());
+
+/*
+ * То же для корпуса, уже находящегося в памяти.
+ */
+CorpusLoadResult LoadCorpusFromMemory(std::string_view data, SearchServer& search_server,
+                                      size_t thread_count = std::thread::hardware_concurrency());
@@ -1,6 +1,15 @@
 #pragma once
 #include <iostream>
 
+enum class DocumentStatus {
+    ACTUAL,
+    IRRELEVANT,
+    BANNED,
+    REMOVED
+};
+
+const int DOCUMENT_STATUS_COUNT = 4;
+
 struct Document {
     Document() = default;
 
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Битовая карта документов по их id. Растёт по мере установки битов,
+ * занимает max_id / 8 байт.
+ */
+class DocumentBitmap {
+public:
+    void Set(int document_id) {
+        const size_t word = document_id / 64;
+        if (word >= words_.size()) {
+            words_.resize(word + 1, 0);
+        }
+        const uint64_t mask = uint64_t{1} << (document_id % 64);
+        if ((words_[word] & mask) == 0) {
+            words_[word] |= mask;
+            ++count_;
+        }
+    }
+
+    void Reset(int document_id) {
+        const size_t word = document_id / 64;
+        const uint64_t mask = uint64_t{1} << (document_id % 64);
+        if (word < words_.size() && (words_[word] & mask) != 0) {
+            words_[word] &= ~mask;
+            --count_;
+        }
+    }
+
+    bool Test(int document_id) const {
+        const size_t word = document_id / 64;
+        return word < words_.size() && (words_[word] >> (document_id % 64) & 1) != 0;
+    }
+
+    //Биты документов с id от index * 64 до index * 64 + 63
+    uint64_t GetWord(size_t index) const {
+        return index < words_.size() ? words_[index] : 0;
+    }
+
+    void Clear() {
+        words_.clear();
+        count_ = 0;
+    }
+
+    //Число установленных битов
+    size_t count() const {
+        return count_;
+    }
+
+    bool empty() const {
+        return count_ == 0;
+    }
+
+    size_t GetMemoryUsage() const {
+        return words_.capacity() * sizeof(uint64_t);
+    }
+
+private:
+    std::vector<uint64_t> words_;
+    size_t count_ = 0;
+};
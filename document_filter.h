@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+
+#include "document.h"
+
+/*
+ * Декларативный фильтр документов: множество статусов, диапазон рейтинга и диапазон id.
+ * В отличие от функции-предиката, фильтр понятен серверу: статусы проверяются по битовым
+ * картам, а диапазон id - по отсортированным постингам, без обращения к атрибутам документа.
+ */
+struct DocumentFilter {
+    static constexpr uint8_t ALL_STATUSES = (1 << DOCUMENT_STATUS_COUNT) - 1;
+
+    //Бит i разрешает статус DocumentStatus(i)
+    uint8_t statuses = ALL_STATUSES;
+    int min_rating = std::numeric_limits<int>::min();
+    int max_rating = std::numeric_limits<int>::max();
+    int min_id = 0;
+    int max_id = std::numeric_limits<int>::max();
+
+    static DocumentFilter ByStatus(DocumentStatus status) {
+        return ByStatuses({status});
+    }
+
+    static DocumentFilter ByStatuses(std::initializer_list<DocumentStatus> statuses) {
+        DocumentFilter filter;
+        filter.statuses = 0;
+        for (const DocumentStatus status : statuses) {
+            filter.statuses |= StatusBit(status);
+        }
+        return filter;
+    }
+
+    bool HasStatus(DocumentStatus status) const {
+        return (statuses & StatusBit(status)) != 0;
+    }
+
+    bool HasAllStatuses() const {
+        return statuses == ALL_STATUSES;
+    }
+
+    bool HasRatingRange() const {
+        return min_rating != std::numeric_limits<int>::min() || max_rating != std::numeric_limits<int>::max();
+    }
+
+    bool Matches(int document_id, DocumentStatus status, int rating) const {
+        return HasStatus(status) && min_rating <= rating && rating <= max_rating
+               && min_id <= document_id && document_id <= max_id;
+    }
+
+private:
+    static uint8_t StatusBit(DocumentStatus status) {
+        return static_cast<uint8_t>(1 << static_cast<int>(status));
+    }
+};
@@ -0,0 +1,154 @@
+#include "document_reordering.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+//Участки меньше этого не делятся, документы в них остаются в исходном порядке
+constexpr size_t MIN_PARTITION_SIZE = 16;
+constexpr int MAX_DEPTH = 24;
+constexpr int MAX_ITERATION_COUNT = 20;
+
+class Bisection {
+public:
+    Bisection(const vector<uint32_t>& document_offsets, const vector<uint32_t>& document_terms, size_t term_count)
+        : document_offsets_(document_offsets),
+          document_terms_(document_terms),
+          left_degrees_(term_count, 0),
+          right_degrees_(term_count, 0),
+          log2_(document_offsets.size() + 2, 0.0) {
+        for (size_t i = 1; i < log2_.size(); ++i) {
+            log2_[i] = log2(static_cast<double>(i));
+        }
+    }
+
+    void Split(const vector<uint32_t>::iterator begin, const vector<uint32_t>::iterator end, const int depth) {
+        const size_t size = end - begin;
+        if (size < 2 * MIN_PARTITION_SIZE || depth >= MAX_DEPTH) {
+            sort(begin, end);
+            return;
+        }
+        const auto middle = begin + size / 2;
+        for (int iteration = 0; iteration < MAX_ITERATION_COUNT; ++iteration) {
+            if (!SwapDocuments(begin, middle, end)) {
+                break;
+            }
+        }
+        Split(begin, middle, depth + 1);
+        Split(middle, end, depth + 1);
+    }
+
+private:
+    using Gain = pair<double, uint32_t>;
+
+    const vector<uint32_t>& document_offsets_;
+    const vector<uint32_t>& document_terms_;
+    //Число документов с термином в левой и правой половинах текущего участка
+    vector<int> left_degrees_;
+    vector<int> right_degrees_;
+    vector<double> log2_;
+    vector<Gain> left_gains_;
+    vector<Gain> right_gains_;
+
+    template <typename Func>
+    void ForEachTerm(const uint32_t document, Func func) const {
+        for (uint32_t i = document_offsets_[document]; i < document_offsets_[document + 1]; ++i) {
+            func(document_terms_[i]);
+        }
+    }
+
+    //Оценка числа битов на разности номеров degree документов с термином в половине из size документов
+    double ComputeCost(const int degree, const size_t size) const {
+        return degree * (log2_[size] - log2_[degree + 1]);
+    }
+
+    void ComputeGains(const vector<uint32_t>::iterator begin, const vector<uint32_t>::iterator end,
+                      const vector<int>& from_degrees, const size_t from_size,
+                      const vector<int>& to_degrees, const size_t to_size, vector<Gain>& gains) const {
+        gains.clear();
+        for (auto it = begin; it != end; ++it) {
+            double gain = 0.0;
+            ForEachTerm(*it, [&](const uint32_t term) {
+                const int from = from_degrees[term];
+                const int to = to_degrees[term];
+                gain += ComputeCost(from, from_size) + ComputeCost(to, to_size)
+                        - ComputeCost(from - 1, from_size) - ComputeCost(to + 1, to_size);
+            });
+            gains.emplace_back(gain, *it);
+        }
+        sort(gains.begin(), gains.end(), [](const Gain& lhs, const Gain& rhs) {
+            return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+        });
+    }
+
+    /*
+     * Один проход обменов между половинами [begin, middle) и [middle, end).
+     * Возвращает false, если выгодных обменов не нашлось.
+     */
+    bool SwapDocuments(const vector<uint32_t>::iterator begin, const vector<uint32_t>::iterator middle,
+                       const vector<uint32_t>::iterator end) {
+        //Обнуляются только счётчики терминов участка, чтобы проход стоил O(постингов участка)
+        for (auto it = begin; it != end; ++it) {
+            ForEachTerm(*it, [this](const uint32_t term) {
+                left_degrees_[term] = 0;
+                right_degrees_[term] = 0;
+            });
+        }
+        for (auto it = begin; it != middle; ++it) {
+            ForEachTerm(*it, [this](const uint32_t term) {
+                ++left_degrees_[term];
+            });
+        }
+        for (auto it = middle; it != end; ++it) {
+            ForEachTerm(*it, [this](const uint32_t term) {
+                ++right_degrees_[term];
+            });
+        }
+
+        const size_t left_size = middle - begin;
+        const size_t right_size = end - middle;
+        ComputeGains(begin, middle, left_degrees_, left_size, right_degrees_, right_size, left_gains_);
+        ComputeGains(middle, end, right_degrees_, right_size, left_degrees_, left_size, right_gains_);
+
+        //Самые выгодные переходы слева направо и справа налево обмениваются парами
+        size_t swap_count = 0;
+        while (swap_count < left_gains_.size() && swap_count < right_gains_.size()
+               && left_gains_[swap_count].first + right_gains_[swap_count].first > 0.0) {
+            ++swap_count;
+        }
+        if (swap_count == 0) {
+            return false;
+        }
+
+        auto out = begin;
+        for (size_t i = swap_count; i < left_gains_.size(); ++i) {
+            *out++ = left_gains_[i].second;
+        }
+        for (size_t i = 0; i < swap_count; ++i) {
+            *out++ = right_gains_[i].second;
+        }
+        for (size_t i = swap_count; i < right_gains_.size(); ++i) {
+            *out++ = right_gains_[i].second;
+        }
+        for (size_t i = 0; i < swap_count; ++i) {
+            *out++ = left_gains_[i].second;
+        }
+        return true;
+    }
+};
+
+}
+
+vector<uint32_t> ComputeBisectionOrder(const vector<uint32_t>& document_offsets, const vector<uint32_t>& document_terms,
+                                       const size_t term_count) {
+    const size_t document_count = document_offsets.empty() ? 0 : document_offsets.size() - 1;
+    vector<uint32_t> order(document_count);
+    iota(order.begin(), order.end(), 0);
+    Bisection(document_offsets, document_terms, term_count).Split(order.begin(), order.end(), 0);
+    return order;
+}
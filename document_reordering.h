@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Порядок документов, в котором документы с общими терминами стоят рядом: рекурсивная
+ * бисекция двудольного графа документ-термин (алгоритм BP). Участок документов делится
+ * пополам, затем пары документов обмениваются между половинами, пока обмен уменьшает оценку
+ * логарифмов разностей номеров в постингах, и обе половины делятся дальше. Чем меньше разности,
+ * тем короче постинги при кодировании разностей и тем плотнее обращения к атрибутам документов.
+ * document_offsets и document_terms - прямой индекс: термины документа d лежат в document_terms
+ * с позиции document_offsets[d] до document_offsets[d + 1], номера терминов меньше term_count.
+ * Возвращает перестановку: order[i] - документ, который встаёт на место i.
+ */
+std::vector<uint32_t> ComputeBisectionOrder(const std::vector<uint32_t>& document_offsets,
+                                            const std::vector<uint32_t>& document_terms, size_t term_count);
+
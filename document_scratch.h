@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Рабочие массивы запроса по плотным номерам документов: состояние документа и накопленная
+ * релевантность. У каждого потока свой набор; массивы только растут, а перед следующим
+ * запросом сбрасываются лишь затронутые ячейки. Так запрос стоит O(обойдённых постингов),
+ * а не O(числа документов), и не выделяет память, когда массивы уже доросли до индекса.
+ * Набор берётся через Acquire на один запрос, вложенные запросы в одном потоке не допускаются.
+ */
+class DocumentScratch {
+public:
+    enum State : char { UNSEEN, MATCHED, REJECTED };
+
+    //Набор текущего потока для номеров [0, document_count), очищенный от прошлого запроса
+    static DocumentScratch& Acquire(size_t document_count) {
+        thread_local DocumentScratch scratch;
+        scratch.Reset();
+        if (scratch.states_.size() < document_count) {
+            scratch.states_.resize(document_count, UNSEEN);
+            scratch.relevance_.resize(document_count, 0.0);
+        }
+        return scratch;
+    }
+
+    State GetState(uint32_t document) const {
+        return states_[document];
+    }
+
+    void SetState(uint32_t document, State state) {
+        if (states_[document] == UNSEEN) {
+            touched_.push_back(document);
+        }
+        states_[document] = state;
+    }
+
+    void AddRelevance(uint32_t document, double relevance) {
+        relevance_[document] += relevance;
+    }
+
+    void SetRelevance(uint32_t document, double relevance) {
+        relevance_[document] = relevance;
+    }
+
+    double GetRelevance(uint32_t document) const {
+        return relevance_[document];
+    }
+
+    //Затронутые запросом номера в порядке первого обращения
+    const std::vector<uint32_t>& GetTouched() const {
+        return touched_;
+    }
+
+    void SortTouched() {
+        std::sort(touched_.begin(), touched_.end());
+    }
+
+private:
+    std::vector<State> states_;
+    std::vector<double> relevance_;
+    std::vector<uint32_t> touched_;
+
+    DocumentScratch() = default;
+
+    void Reset() {
+        for (const uint32_t document : touched_) {
+            states_[document] = UNSEEN;
+            relevance_[document] = 0.0;
+        }
+        touched_.clear();
+    }
+};
@@ -0,0 +1,118 @@
+#include "durable_search_server.h"
+#include "index_delta.h"
+#include "index_snapshot.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+const string SNAPSHOT_FILE = "index.snapshot"s;
+const string LOG_FILE = "index.wal"s;
+
+string PrepareDirectory(const string& directory) {
+    filesystem::create_directories(directory);
+    return directory;
+}
+
+}
+
+DurableSearchServer::DurableSearchServer(const string& directory, const string_view stop_text,
+                                         WriteAheadLog::Options options)
+    : snapshot_path_((filesystem::path(PrepareDirectory(directory)) / SNAPSHOT_FILE).string()),
+      log_path_((filesystem::path(directory) / LOG_FILE).string()),
+      search_server_(stop_text) {
+    if (optional<IndexSnapshot> snapshot = LoadSnapshot(snapshot_path_)) {
+        search_server_ = move(snapshot->search_server);
+        last_sequence_ = snapshot->sequence;
+    } else {
+        //Пустой снимок сохраняет стоп-слова, без них журнал нельзя воспроизвести
+        SaveSnapshot(search_server_, last_sequence_, snapshot_path_);
+    }
+    history_begin_ = last_sequence_;
+    for (const int document_id : search_server_) {
+        added_sequences_.emplace_hint(added_sequences_.end(), document_id, last_sequence_);
+    }
+    last_sequence_ = WriteAheadLog::Recover(log_path_, last_sequence_, [this](const WalRecord& record) {
+        if (record.type == WalRecord::Type::ADD) {
+            search_server_.AddDocument(record.document_id, record.text, record.status, record.ratings);
+            TrackAdd(record.document_id, record.sequence);
+        } else {
+            search_server_.RemoveDocument(record.document_id);
+            TrackRemove(record.document_id, record.sequence);
+        }
+    });
+    checksum_ = ComputeIndexChecksum(search_server_);
+    log_ = make_unique<WriteAheadLog>(log_path_, last_sequence_ + 1, options);
+}
+
+void DurableSearchServer::AddDocument(int document_id, const string_view document, const DocumentStatus status,
+                                      const vector<int>& ratings) {
+    search_server_.AddDocument(document_id, document, status, ratings);
+    last_sequence_ = log_->AppendAdd(document_id, document, status, ratings);
+    checksum_ += ComputeDocumentChecksum(search_server_, document_id);
+    TrackAdd(document_id, last_sequence_);
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+    if (!search_server_.GetDocumentParams(document_id)) {
+        return;
+    }
+    checksum_ -= ComputeDocumentChecksum(search_server_, document_id);
+    search_server_.RemoveDocument(document_id);
+    last_sequence_ = log_->AppendRemove(document_id);
+    TrackRemove(document_id, last_sequence_);
+}
+
+void DurableSearchServer::Sync() {
+    log_->Sync();
+}
+
+void DurableSearchServer::Checkpoint() {
+    log_->Sync();
+    SaveSnapshot(search_server_, last_sequence_, snapshot_path_);
+    log_->Truncate();
+}
+
+string DurableSearchServer::ExportDelta(const uint64_t after_sequence) const {
+    if (after_sequence > last_sequence_) {
+        throw invalid_argument("No changes after "s + to_string(after_sequence) + ", last change is "s
+                               + to_string(last_sequence_));
+    }
+    const DeltaRange range{after_sequence, last_sequence_, after_sequence < history_begin_};
+    vector<int> removed_ids;
+    vector<int> added_ids;
+    if (range.full) {
+        added_ids.assign(search_server_.begin(), search_server_.end());
+    } else {
+        for (const auto& [document_id, sequence] : removed_sequences_) {
+            if (sequence > after_sequence) {
+                removed_ids.push_back(document_id);
+            }
+        }
+        //Документы идут по возрастанию id, так реплика дописывает их в конец постингов
+        for (const auto& [document_id, sequence] : added_sequences_) {
+            if (sequence > after_sequence) {
+                added_ids.push_back(document_id);
+            }
+        }
+    }
+    return EncodeDelta(search_server_, range, checksum_, removed_ids, added_ids);
+}
+
+void DurableSearchServer::ExportDelta(const uint64_t after_sequence, const string& path) const {
+    WriteFileAtomically(path, ExportDelta(after_sequence));
+}
+
+void DurableSearchServer::TrackAdd(const int document_id, const uint64_t sequence) {
+    added_sequences_[document_id] = sequence;
+    //Реплика сама удалит старую версию заново добавленного документа
+    removed_sequences_.erase(document_id);
+}
+
+void DurableSearchServer::TrackRemove(const int document_id, const uint64_t sequence) {
+    added_sequences_.erase(document_id);
+    removed_sequences_[document_id] = sequence;
+}
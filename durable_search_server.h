@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+/*
+ * Поисковый сервер, переживающий сбои.
+ * Каталог содержит снимок индекса и журнал изменений после него. При открытии снимок
+ * загружается, а журнал применяется поверх. Каждое изменение сначала применяется к индексу,
+ * затем попадает в журнал, который сбрасывается на диск группами в фоне.
+ * Checkpoint записывает новый снимок и очищает покрытый им журнал.
+ * Для реплик сервер выгружает дельты изменений после заданного номера, см. index_delta.h.
+ */
+class DurableSearchServer {
+public:
+    /*
+     * Стоп-слова stop_text используются, только если в каталоге ещё нет снимка.
+     */
+    DurableSearchServer(const std::string& directory, const std::string_view stop_text,
+                        WriteAheadLog::Options options = {});
+
+    void AddDocument(int document_id, const std::string_view document, const DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    const SearchServer& GetServer() const {
+        return search_server_;
+    }
+
+    //Номер последнего применённого изменения
+    uint64_t GetLastSequence() const {
+        return last_sequence_;
+    }
+
+    //Ждёт, пока все принятые изменения не окажутся на диске
+    void Sync();
+
+    void Checkpoint();
+
+    /*
+     * Дельта изменений после after_sequence по последнее применённое. Удаления помнятся
+     * с открытия сервера, поэтому для более ранних номеров выгружается полная дельта.
+     */
+    std::string ExportDelta(uint64_t after_sequence) const;
+
+    void ExportDelta(uint64_t after_sequence, const std::string& path) const;
+
+    //Контрольная сумма индекса, как её считает ComputeIndexChecksum
+    uint64_t GetChecksum() const {
+        return checksum_;
+    }
+
+private:
+    const std::string snapshot_path_;
+    const std::string log_path_;
+    SearchServer search_server_;
+    uint64_t last_sequence_ = 0;
+    std::unique_ptr<WriteAheadLog> log_;
+    uint64_t checksum_ = 0;
+    //Номер, с которого известны все изменения
+    uint64_t history_begin_ = 0;
+    //Номера изменений, которыми документы попали в индекс или были удалены
+    std::map<int, uint64_t> added_sequences_;
+    std::map<int, uint64_t> removed_sequences_;
+
+    void TrackAdd(int document_id, uint64_t sequence);
+
+    void TrackRemove(int document_id, uint64_t sequence);
+};
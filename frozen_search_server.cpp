@@ -0,0 +1,142 @@
+#include "frozen_search_server.h"
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+FrozenSearchServer::FrozenSearchServer(const SearchServer& search_server) {
+    const auto& stop_words = search_server.GetStopWords();
+    stop_words_ = FrozenStringSet(vector<string_view>(stop_words.begin(), stop_words.end()));
+
+    document_ids_.assign(search_server.begin(), search_server.end());
+    statuses_.reserve(document_ids_.size());
+    ratings_.reserve(document_ids_.size());
+    vector<string_view> words;
+    size_t posting_count = 0;
+    for (const int document_id : document_ids_) {
+        const SearchServer::DocsParams params = *search_server.GetDocumentParams(document_id);
+        statuses_.push_back(params.status);
+        ratings_.push_back(params.rating);
+        const auto& word_freqs = search_server.GetWordFrequencies(document_id);
+        for (const auto& [word, _] : word_freqs) {
+            words.push_back(word);
+        }
+        posting_count += word_freqs.size();
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    terms_ = FrozenStringSet(words);
+    sorted_terms_.reserve(words.size());
+    for (const string_view word : words) {
+        sorted_terms_.push_back(terms_.Find(word));
+    }
+
+    //Обе CSR строятся сортировкой подсчётом: документы обходятся по возрастанию номера
+    posting_offsets_.assign(terms_.size() + 1, 0);
+    document_term_offsets_.reserve(document_ids_.size() + 1);
+    document_terms_.reserve(posting_count);
+    for (const int document_id : document_ids_) {
+        document_term_offsets_.push_back(document_terms_.size());
+        const size_t first = document_terms_.size();
+        for (const auto& [word, _] : search_server.GetWordFrequencies(document_id)) {
+            const uint32_t term = terms_.Find(word);
+            document_terms_.push_back(term);
+            ++posting_offsets_[term + 1];
+        }
+        sort(document_terms_.begin() + first, document_terms_.end());
+    }
+    document_term_offsets_.push_back(document_terms_.size());
+    partial_sum(posting_offsets_.begin(), posting_offsets_.end(), posting_offsets_.begin());
+
+    posting_documents_.resize(posting_count);
+    posting_freqs_.resize(posting_count);
+    vector<uint32_t> positions(posting_offsets_.begin(), posting_offsets_.end() - 1);
+    for (uint32_t document = 0; document < document_ids_.size(); ++document) {
+        for (const auto& [word, freq] : search_server.GetWordFrequencies(document_ids_[document])) {
+            const uint32_t position = positions[terms_.Find(word)]++;
+            posting_documents_[position] = document;
+            posting_freqs_[position] = freq;
+        }
+    }
+}
+
+vector<Document> FrozenSearchServer::FindTopDocuments(const string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(execution::seq, raw_query, DocumentFilter::ByStatus(status));
+}
+
+vector<Document> FrozenSearchServer::FindTopDocuments(const string_view raw_query, const DocumentFilter& filter) const {
+    return FindTopDocuments(execution::seq, raw_query, filter);
+}
+
+tuple<vector<string_view>, DocumentStatus> FrozenSearchServer::MatchDocument(const string_view raw_query,
+                                                                             const int document_id) const {
+    const Query query = ParseQuery(raw_query);
+    vector<string_view> matched_words;
+    const auto it = lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
+    if (it == document_ids_.end() || *it != document_id) {
+        return {matched_words, DocumentStatus::REMOVED};
+    }
+    const uint32_t document = it - document_ids_.begin();
+
+    const auto has_word = [this, document](const string_view word) {
+        const uint32_t term = terms_.Find(word);
+        return term != FrozenStringSet::NOT_FOUND && HasTerm(document, term);
+    };
+    if (any_of(query.minus_words.begin(), query.minus_words.end(), has_word)) {
+        return {matched_words, statuses_[document]};
+    }
+    for (const string_view word : query.plus_words) {
+        if (has_word(word)) {
+            matched_words.push_back(terms_.Get(terms_.Find(word)));
+        }
+    }
+    return {matched_words, statuses_[document]};
+}
+
+size_t FrozenSearchServer::GetMemoryUsage() const {
+    using memory_usage::HeapBytes;
+    return stop_words_.GetMemoryUsage() + terms_.GetMemoryUsage() + HeapBytes(sorted_terms_)
+           + HeapBytes(document_ids_) + HeapBytes(statuses_) + HeapBytes(ratings_)
+           + HeapBytes(posting_offsets_) + HeapBytes(posting_documents_) + HeapBytes(posting_freqs_)
+           + HeapBytes(document_term_offsets_) + HeapBytes(document_terms_);
+}
+
+FrozenSearchServer::Query FrozenSearchServer::ParseQuery(const string_view text) const {
+    Query query;
+    for (string_view word : SplitIntoWords(text)) {
+        bool is_minus = false;
+        if (!word.empty() && word[0] == '-') {
+            is_minus = true;
+            word.remove_prefix(1);
+        }
+        bool is_prefix = false;
+        if (word.size() > 1 && word.back() == '*') {
+            is_prefix = true;
+            word.remove_suffix(1);
+        }
+        if (!SearchServer::IsValidWord(word)) {
+            throw invalid_argument(__FUNCTION__ + " invalid word error!"s);
+        }
+        auto& words = is_minus ? query.minus_words : query.plus_words;
+        if (is_prefix) {
+            auto it = lower_bound(sorted_terms_.begin(), sorted_terms_.end(), word,
+                                  [this](const uint32_t term, const string_view value) {
+                return terms_.Get(term) < value;
+            });
+            for (size_t count = 0; count < MAX_PREFIX_EXPANSION && it != sorted_terms_.end()
+                                   && terms_.Get(*it).substr(0, word.size()) == word; ++count, ++it) {
+                words.insert(terms_.Get(*it));
+            }
+        } else if (stop_words_.Find(word) == FrozenStringSet::NOT_FOUND) {
+            words.insert(word);
+        }
+    }
+    return query;
+}
+
+bool FrozenSearchServer::HasTerm(const uint32_t document, const uint32_t term) const {
+    return binary_search(document_terms_.begin() + document_term_offsets_[document],
+                         document_terms_.begin() + document_term_offsets_[document + 1], term);
+}
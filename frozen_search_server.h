@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cmath>
+#include <execution>
+#include <set>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "document_scratch.h"
+#include "minimal_perfect_hash.h"
+#include "search_server.h"
+
+/*
+ * Индекс только для чтения, замороженный из SearchServer.
+ * Все структуры - плоские массивы: постинги и прямой индекс в виде CSR, атрибуты документов
+ * по порядковому номеру документа (номера идут по возрастанию id). Термины и стоп-слова ищутся
+ * минимальной совершенной хеш-функцией с проверкой отпечатка, без деревьев и без аллокаций узлов.
+ * Точные частоты слов лежат рядом с постингами, так что подсчёт релевантности не обращается
+ * к прямому индексу. Выдача совпадает с SearchServer в режиме ScoringMode::EXACT.
+ */
+class FrozenSearchServer {
+public:
+    explicit FrozenSearchServer(const SearchServer& search_server);
+
+    template <typename ExPo, typename Predicate>
+    std::vector<Document> FindTopDocuments(ExPo&& policy, const std::string_view raw_query,
+                                           const DocumentFilter& filter, const Predicate predicate) const {
+        std::vector<Document> matched_documents = FindAllDocuments(ParseQuery(raw_query), filter, predicate);
+        SearchServer::SelectTopDocuments(policy, matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+        return matched_documents;
+    }
+
+    template <typename ExPo, typename Predicate>
+    std::vector<Document> FindTopDocuments(ExPo&& policy, const std::string_view raw_query,
+                                           const Predicate predicate) const {
+        return FindTopDocuments(policy, raw_query, DocumentFilter(), predicate);
+    }
+
+    template <typename ExPo>
+    std::vector<Document> FindTopDocuments(ExPo&& policy, const std::string_view raw_query,
+                                           const DocumentFilter& filter) const {
+        return FindTopDocuments(policy, raw_query, filter, AnyDocument());
+    }
+
+    template <typename ExPo>
+    std::vector<Document> FindTopDocuments(ExPo&& policy, const std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL) const {
+        return FindTopDocuments(policy, raw_query, DocumentFilter::ByStatus(status));
+    }
+
+    template <typename Predicate>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, const Predicate predicate) const {
+        return FindTopDocuments(std::execution::seq, raw_query, predicate);
+    }
+
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, const DocumentFilter& filter) const;
+
+    /*
+     * Как SearchServer::MatchDocument. Совпавшие слова указывают в хранилище самого индекса.
+     */
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query,
+                                                                            int document_id) const;
+
+    //Сопоставление - несколько бинарных поисков, параллелить нечего
+    template <typename ExPo>
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExPo&&, const std::string_view raw_query,
+                                                                            int document_id) const {
+        return MatchDocument(raw_query, document_id);
+    }
+
+    int GetDocumentCount() const {
+        return static_cast<int>(document_ids_.size());
+    }
+
+    std::vector<int>::const_iterator begin() const {
+        return document_ids_.begin();
+    }
+
+    std::vector<int>::const_iterator end() const {
+        return document_ids_.end();
+    }
+
+    /*
+     * Память в куче, занятая индексом, в байтах.
+     */
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Query {
+        //Множества, а не векторы: порядок суммирования вкладов тот же, что у SearchServer
+        std::set<std::string_view> plus_words;
+        std::set<std::string_view> minus_words;
+    };
+
+    struct AnyDocument {
+        bool operator()(int, DocumentStatus, int) const {
+            return true;
+        }
+    };
+
+    FrozenStringSet stop_words_;
+    FrozenStringSet terms_;
+    //Номера терминов в лексикографическом порядке, для префиксных слов
+    std::vector<uint32_t> sorted_terms_;
+
+    std::vector<int> document_ids_;
+    std::vector<DocumentStatus> statuses_;
+    std::vector<int> ratings_;
+
+    //Постинги термина t: номера документов и частоты с позиции posting_offsets_[t] до posting_offsets_[t + 1]
+    std::vector<uint32_t> posting_offsets_;
+    std::vector<uint32_t> posting_documents_;
+    std::vector<double> posting_freqs_;
+
+    //Термины документа d по возрастанию номера с позиции document_term_offsets_[d]
+    std::vector<uint32_t> document_term_offsets_;
+    std::vector<uint32_t> document_terms_;
+
+    Query ParseQuery(std::string_view text) const;
+
+    bool HasTerm(uint32_t document, uint32_t term) const;
+
+    template <typename Predicate>
+    std::vector<Document> FindAllDocuments(const Query& query, const DocumentFilter& filter,
+                                           const Predicate& predicate) const {
+        //Слова с IDF в порядке множества, как их суммирует SearchServer
+        std::vector<std::pair<uint32_t, double>> term_idfs;
+        for (const std::string_view word : query.plus_words) {
+            const uint32_t term = terms_.Find(word);
+            if (term == FrozenStringSet::NOT_FOUND || query.minus_words.count(word) > 0) {
+                continue;
+            }
+            const uint32_t word_count = posting_offsets_[term + 1] - posting_offsets_[term];
+            term_idfs.emplace_back(term, std::log(GetDocumentCount() * 1.0 / static_cast<double>(word_count)));
+        }
+        if (term_idfs.empty()) {
+            return {};
+        }
+
+        //Рабочие массивы потока: запрос трогает только ячейки документов из своих постингов
+        DocumentScratch& scratch = DocumentScratch::Acquire(document_ids_.size());
+        std::vector<uint32_t> matched;
+        for (const std::string_view word : query.minus_words) {
+            const uint32_t term = terms_.Find(word);
+            if (term == FrozenStringSet::NOT_FOUND) {
+                continue;
+            }
+            for (uint32_t i = posting_offsets_[term]; i < posting_offsets_[term + 1]; ++i) {
+                scratch.SetState(posting_documents_[i], DocumentScratch::REJECTED);
+            }
+        }
+
+        //Диапазон id фильтра - диапазон номеров, постинги отсекаются бинарным поиском
+        const uint32_t first = std::lower_bound(document_ids_.begin(), document_ids_.end(), filter.min_id)
+                               - document_ids_.begin();
+        const uint32_t last = std::upper_bound(document_ids_.begin(), document_ids_.end(), filter.max_id)
+                              - document_ids_.begin();
+        for (const auto& [term, inverse_document_freq] : term_idfs) {
+            const auto postings_begin = posting_documents_.begin() + posting_offsets_[term];
+            const auto postings_end = posting_documents_.begin() + posting_offsets_[term + 1];
+            for (auto it = std::lower_bound(postings_begin, postings_end, first); it != postings_end && *it < last; ++it) {
+                const uint32_t document = *it;
+                DocumentScratch::State state = scratch.GetState(document);
+                if (state == DocumentScratch::UNSEEN) {
+                    const bool allowed = filter.HasStatus(statuses_[document])
+                                         && filter.min_rating <= ratings_[document]
+                                         && ratings_[document] <= filter.max_rating
+                                         && predicate(document_ids_[document], statuses_[document], ratings_[document]);
+                    state = allowed ? DocumentScratch::MATCHED : DocumentScratch::REJECTED;
+                    scratch.SetState(document, state);
+                    if (allowed) {
+                        matched.push_back(document);
+                    }
+                }
+                if (state == DocumentScratch::MATCHED) {
+                    scratch.AddRelevance(document, posting_freqs_[it - posting_documents_.begin()] * inverse_document_freq);
+                }
+            }
+        }
+
+        std::vector<Document> matched_documents;
+        matched_documents.reserve(matched.size());
+        for (const uint32_t document : matched) {
+            matched_documents.emplace_back(document_ids_[document], scratch.GetRelevance(document), ratings_[document]);
+        }
+        return matched_documents;
+    }
+};
@@ -0,0 +1,48 @@
+#include "impact_index.h"
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+ImpactIndex::ImpactIndex(const TermImpacts& term_impacts) {
+    double max_impact = 0.0;
+    size_t posting_count = 0;
+    for (const auto& impacts : term_impacts) {
+        for (const auto& [_, impact] : impacts) {
+            max_impact = max(max_impact, impact);
+        }
+        posting_count += impacts.size();
+    }
+    if (max_impact > 0.0) {
+        impact_scale_ = max_impact / IMPACT_LEVELS;
+    }
+
+    term_offsets_.reserve(term_impacts.size() + 1);
+    postings_.reserve(posting_count);
+    for (const auto& impacts : term_impacts) {
+        term_offsets_.push_back(postings_.size());
+        const size_t first = postings_.size();
+        for (const auto& [document_id, impact] : impacts) {
+            //Ненулевой вклад никогда не превращается в 0, иначе документ выпал бы из поиска
+            const long level = clamp(lround(impact / impact_scale_), 1L, static_cast<long>(IMPACT_LEVELS));
+            postings_.push_back({document_id, static_cast<uint8_t>(level)});
+        }
+        sort(postings_.begin() + first, postings_.end(), [](const Posting& lhs, const Posting& rhs) {
+            return lhs.impact > rhs.impact || (lhs.impact == rhs.impact && lhs.document_id < rhs.document_id);
+        });
+    }
+    term_offsets_.push_back(postings_.size());
+}
+
+IteratorRange<vector<ImpactIndex::Posting>::const_iterator> ImpactIndex::GetPostings(const uint32_t term) const {
+    if (static_cast<size_t>(term) + 1 >= term_offsets_.size()) {
+        return {postings_.end(), postings_.end()};
+    }
+    return {postings_.begin() + term_offsets_[term], postings_.begin() + term_offsets_[term + 1]};
+}
+
+size_t ImpactIndex::GetMemoryUsage() const {
+    return memory_usage::HeapBytes(term_offsets_) + memory_usage::HeapBytes(postings_);
+}
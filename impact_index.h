@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "paginator.h"
+
+/*
+ * Постинги, упорядоченные по вкладу документа в релевантность, для поиска score-at-a-time.
+ * Вклад TF * IDF квантуется в 8 бит общим для всего индекса шагом: значение q означает
+ * вклад q * GetImpactScale(). Постинги термина идут по убыванию вклада, а при равном
+ * вкладе - по возрастанию id, так что документы с равным вкладом образуют непрерывный участок.
+ * Ошибка квантования одного вклада не больше одного шага.
+ * Индекс не отслеживает изменения сервера и строится заново целиком.
+ */
+class ImpactIndex {
+public:
+    static constexpr uint32_t IMPACT_LEVELS = 255;
+
+    struct Posting {
+        int document_id = 0;
+        uint8_t impact = 0;
+    };
+
+    //Постинги при построении: индекс вектора - номер термина, пары (id документа, вклад TF * IDF)
+    using TermImpacts = std::vector<std::vector<std::pair<int, double>>>;
+
+    ImpactIndex() = default;
+
+    explicit ImpactIndex(const TermImpacts& term_impacts);
+
+    //Пустой диапазон для терминов, которых не было при построении
+    IteratorRange<std::vector<Posting>::const_iterator> GetPostings(uint32_t term) const;
+
+    double GetImpactScale() const {
+        return impact_scale_;
+    }
+
+    size_t GetMemoryUsage() const;
+
+private:
+    double impact_scale_ = 1.0;
+    std::vector<uint32_t> term_offsets_;
+    std::vector<Posting> postings_;
+};
@@ -0,0 +1,345 @@
+#include "index_delta.h"
+#include "binary_format.h"
+#include "index_snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+const string DELTA_MAGIC = "SDLT"s;
+const uint32_t DELTA_VERSION = 1;
+
+//Перемешивание битов из splitmix64
+uint64_t Mix(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+/*
+ * Переносимый 64-битный хеш последовательности чисел и строк. Строки читаются
+ * по 8 байт, поэтому хеш документа дешевле его сериализации.
+ */
+class Hasher {
+public:
+    void Add(uint64_t value) {
+        state_ = Mix(state_ + value);
+    }
+
+    void Add(const string_view str) {
+        Add(str.size());
+        size_t i = 0;
+        for (; i + 8 <= str.size(); i += 8) {
+            Add(ReadChunk(str.substr(i, 8)));
+        }
+        if (i < str.size()) {
+            Add(ReadChunk(str.substr(i)));
+        }
+    }
+
+    void Add(const double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        Add(bits);
+    }
+
+    uint64_t Get() const {
+        return state_;
+    }
+
+private:
+    uint64_t state_ = 0;
+
+    static uint64_t ReadChunk(const string_view chunk) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < chunk.size(); ++i) {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(chunk[i])) << (8 * i);
+        }
+        return value;
+    }
+};
+
+Hasher StartDocument(const int document_id, const SearchServer::DocsParams& params) {
+    Hasher hasher;
+    hasher.Add(static_cast<uint64_t>(document_id));
+    hasher.Add(static_cast<uint64_t>(params.status));
+    hasher.Add(static_cast<uint64_t>(params.rating));
+    return hasher;
+}
+
+uint64_t ComputeStopWordsChecksum(const vector<string_view>& stop_words) {
+    Hasher hasher;
+    hasher.Add(stop_words.size());
+    for (const string_view word : stop_words) {
+        hasher.Add(word);
+    }
+    return hasher.Get();
+}
+
+//Рейтинг может быть отрицательным, а varint выгоден для малых по модулю чисел
+uint64_t ZigZag(const int value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int UnZigZag(const uint64_t value) {
+    return static_cast<int>(static_cast<uint32_t>(value >> 1) ^ -static_cast<uint32_t>(value & 1));
+}
+
+}
+
+uint64_t ComputeDocumentChecksum(const SearchServer& search_server, const int document_id) {
+    Hasher hasher = StartDocument(document_id, *search_server.GetDocumentParams(document_id));
+    for (const auto& [word, freq] : search_server.GetWordFrequencies(document_id)) {
+        hasher.Add(word);
+        hasher.Add(freq);
+    }
+    return hasher.Get();
+}
+
+uint64_t ComputeIndexChecksum(const SearchServer& search_server) {
+    const auto& stop_words = search_server.GetStopWords();
+    uint64_t checksum = ComputeStopWordsChecksum({stop_words.begin(), stop_words.end()});
+    for (const int document_id : search_server) {
+        checksum += ComputeDocumentChecksum(search_server, document_id);
+    }
+    return checksum;
+}
+
+string EncodeDelta(const SearchServer& search_server, const DeltaRange& range, const uint64_t checksum,
+                   const vector<int>& removed_ids, const vector<int>& added_ids) {
+    using namespace binary_format;
+    string data = DELTA_MAGIC;
+    PutInt(data, DELTA_VERSION);
+    PutInt(data, range.base_sequence);
+    PutInt(data, range.sequence);
+    PutInt(data, static_cast<uint8_t>(range.full));
+    PutInt(data, checksum);
+
+    PutVarint(data, search_server.GetStopWords().size());
+    for (const string& word : search_server.GetStopWords()) {
+        PutString(data, word);
+    }
+    PutVarint(data, removed_ids.size());
+    for (const int document_id : removed_ids) {
+        PutVarint(data, static_cast<uint32_t>(document_id));
+    }
+
+    //Словарь дельты: каждое слово добавленных документов записывается один раз
+    vector<string_view> words;
+    for (const int document_id : added_ids) {
+        for (const auto& [word, _] : search_server.GetWordFrequencies(document_id)) {
+            words.push_back(word);
+        }
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    unordered_map<string_view, uint32_t> word_indexes;
+    word_indexes.reserve(words.size());
+    PutVarint(data, words.size());
+    for (const string_view word : words) {
+        word_indexes.emplace(word, static_cast<uint32_t>(word_indexes.size()));
+        PutString(data, word);
+    }
+
+    //Слова документа - разности номеров по возрастанию. Частоты слов документа обычно
+    //кратны одной величине и повторяются, поэтому пишутся таблицей различных значений
+    PutVarint(data, added_ids.size());
+    vector<double> freqs;
+    for (const int document_id : added_ids) {
+        const SearchServer::DocsParams params = *search_server.GetDocumentParams(document_id);
+        const auto& word_freqs = search_server.GetWordFrequencies(document_id);
+        PutVarint(data, static_cast<uint32_t>(document_id));
+        PutInt(data, static_cast<uint8_t>(params.status));
+        PutVarint(data, ZigZag(params.rating));
+
+        freqs.clear();
+        for (const auto& [_, freq] : word_freqs) {
+            if (find(freqs.begin(), freqs.end(), freq) == freqs.end()) {
+                freqs.push_back(freq);
+            }
+        }
+        PutVarint(data, freqs.size());
+        for (const double freq : freqs) {
+            PutDouble(data, freq);
+        }
+        PutVarint(data, word_freqs.size());
+        int64_t previous = -1;
+        for (const auto& [word, freq] : word_freqs) {
+            const uint32_t index = word_indexes.at(word);
+            PutVarint(data, index - previous - 1);
+            previous = index;
+            if (freqs.size() > 1) {
+                PutVarint(data, find(freqs.begin(), freqs.end(), freq) - freqs.begin());
+            }
+        }
+    }
+
+    PutInt(data, ComputeCrc32(data));
+    return data;
+}
+
+void IndexReplica::Apply(const string_view delta) {
+    using namespace binary_format;
+    const auto corrupted = []() {
+        return runtime_error("Index delta is corrupted"s);
+    };
+    if (delta.size() < DELTA_MAGIC.size() + sizeof(uint32_t)
+        || delta.compare(0, DELTA_MAGIC.size(), DELTA_MAGIC) != 0) {
+        throw corrupted();
+    }
+    const string_view body = delta.substr(0, delta.size() - sizeof(uint32_t));
+    Reader checksum_reader(delta.substr(body.size()));
+    uint32_t crc = 0;
+    if (!checksum_reader.GetInt(crc) || crc != ComputeCrc32(body)) {
+        throw corrupted();
+    }
+
+    Reader reader(body.substr(DELTA_MAGIC.size()));
+    uint32_t version = 0;
+    DeltaRange range;
+    uint8_t full = 0;
+    uint64_t checksum = 0;
+    uint64_t stop_word_count = 0;
+    if (!reader.GetInt(version) || version != DELTA_VERSION || !reader.GetInt(range.base_sequence)
+        || !reader.GetInt(range.sequence) || !reader.GetInt(full) || !reader.GetInt(checksum)
+        || !reader.GetVarint(stop_word_count) || stop_word_count > reader.GetRemaining()) {
+        throw corrupted();
+    }
+    range.full = full != 0;
+    vector<string_view> stop_words(stop_word_count);
+    for (string_view& word : stop_words) {
+        reader.GetString(word);
+    }
+    //Счётчики проверяются по остатку буфера: на каждый элемент приходится хотя бы байт
+    const auto get_count = [&reader](uint64_t& count) {
+        return reader.GetVarint(count) && count <= reader.GetRemaining();
+    };
+    uint64_t removed_count = 0;
+    vector<int> removed_ids;
+    if (get_count(removed_count)) {
+        removed_ids.resize(removed_count);
+    }
+    for (int& document_id : removed_ids) {
+        uint64_t value = 0;
+        reader.GetVarint(value);
+        document_id = static_cast<int>(value);
+    }
+
+    //Документы разбираются целиком до изменения реплики; слова ссылаются на буфер дельты
+    SearchServer::FrequencyBatch batch;
+    uint64_t word_count = 0;
+    if (get_count(word_count)) {
+        batch.words.resize(word_count);
+    }
+    for (string_view& word : batch.words) {
+        reader.GetString(word);
+    }
+    uint64_t added_count = 0;
+    get_count(added_count);
+    uint64_t added_checksum = 0;
+    vector<double> freqs;
+    for (uint64_t i = 0; i < added_count && reader.IsOk(); ++i) {
+        SearchServer::FrequencyBatch::Document& document = batch.documents.emplace_back();
+        uint64_t id = 0;
+        uint8_t status = 0;
+        uint64_t rating = 0;
+        uint64_t freq_count = 0;
+        uint64_t document_word_count = 0;
+        reader.GetVarint(id);
+        reader.GetInt(status);
+        reader.GetVarint(rating);
+        document.id = static_cast<int>(id);
+        document.params = {static_cast<DocumentStatus>(status), UnZigZag(rating)};
+        freqs.assign(get_count(freq_count) ? freq_count : 0, 0.0);
+        for (double& freq : freqs) {
+            reader.GetDouble(freq);
+        }
+        get_count(document_word_count);
+
+        Hasher hasher = StartDocument(document.id, document.params);
+        document.words_begin = batch.word_freqs.size();
+        uint64_t index = 0;
+        for (uint64_t j = 0; j < document_word_count && reader.IsOk(); ++j) {
+            uint64_t gap = 0;
+            uint64_t freq_index = 0;
+            reader.GetVarint(gap);
+            index = j == 0 ? gap : index + gap + 1;
+            if (freqs.size() > 1) {
+                reader.GetVarint(freq_index);
+            }
+            if (index >= batch.words.size() || freq_index >= freqs.size()) {
+                throw corrupted();
+            }
+            batch.word_freqs.emplace_back(static_cast<uint32_t>(index), freqs[freq_index]);
+            hasher.Add(batch.words[index]);
+            hasher.Add(freqs[freq_index]);
+        }
+        document.words_end = batch.word_freqs.size();
+        added_checksum += hasher.Get();
+    }
+    if (!reader.IsOk() || reader.GetRemaining() != 0) {
+        throw corrupted();
+    }
+
+    if (!range.full && range.base_sequence != sequence_) {
+        throw runtime_error("Delta starts after change "s + to_string(range.base_sequence)
+                            + ", replica is at "s + to_string(sequence_));
+    }
+    //Пустая реплика берёт стоп-слова источника из первой же дельты
+    const bool rebuild = range.full || (sequence_ == 0 && search_server_.GetDocumentCount() == 0);
+    const auto& current_stop_words = search_server_.GetStopWords();
+    if (!rebuild && !equal(stop_words.begin(), stop_words.end(),
+                           current_stop_words.begin(), current_stop_words.end())) {
+        throw runtime_error("Delta changes stop words of the replica"s);
+    }
+
+    try {
+        if (rebuild) {
+            search_server_ = SearchServer(stop_words);
+            checksum_ = ComputeIndexChecksum(search_server_);
+        }
+        const auto remove = [this](const int document_id) {
+            if (search_server_.GetDocumentParams(document_id)) {
+                checksum_ -= ComputeDocumentChecksum(search_server_, document_id);
+                search_server_.RemoveDocument(document_id);
+            }
+        };
+        //Все удаления идут до вставки, тогда индекс уплотняется от силы один раз на дельту
+        for (const int document_id : removed_ids) {
+            remove(document_id);
+        }
+        for (const auto& document : batch.documents) {
+            remove(document.id);
+        }
+        search_server_.AddDocumentsWithFrequencies(batch);
+        checksum_ += added_checksum;
+    } catch (...) {
+        Reset();
+        throw;
+    }
+
+    if (checksum_ != checksum) {
+        Reset();
+        throw runtime_error("Replica diverged from the source at change "s + to_string(range.sequence));
+    }
+    sequence_ = range.sequence;
+}
+
+void IndexReplica::ApplyFile(const string& path) {
+    const optional<string> delta = ReadWholeFile(path);
+    if (!delta) {
+        throw runtime_error("Can't read index delta "s + path);
+    }
+    Apply(*delta);
+}
+
+void IndexReplica::Reset() {
+    search_server_ = SearchServer();
+    sequence_ = 0;
+    checksum_ = ComputeIndexChecksum(search_server_);
+}
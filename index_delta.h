@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+
+/*
+ * Дельты индекса для репликации. Дельта переводит индекс из состояния после изменения
+ * base_sequence в состояние после sequence: содержит стоп-слова, id удалённых документов
+ * и добавленные документы с атрибутами и частотами слов, так что реплика применяет её
+ * без разбора текста. Слова добавленных документов записаны один раз в словаре дельты,
+ * документы ссылаются на них номерами. Полная дельта содержит весь индекс и применяется
+ * к любой реплике. В конце дельты - CRC32 всех байтов, в заголовке - контрольная сумма
+ * индекса источника, по которой реплика проверяет, что пришла к тому же состоянию.
+ */
+
+/*
+ * Контрольная сумма документа: его id, атрибутов и частот слов.
+ */
+uint64_t ComputeDocumentChecksum(const SearchServer& search_server, int document_id);
+
+/*
+ * Контрольная сумма состояния индекса: стоп-слов и всех документов. Не зависит от порядка
+ * добавления документов и складывается из сумм документов, поэтому её можно вести
+ * по ходу изменений, а не пересчитывать по всему индексу.
+ */
+uint64_t ComputeIndexChecksum(const SearchServer& search_server);
+
+struct DeltaRange {
+    uint64_t base_sequence = 0;
+    uint64_t sequence = 0;
+    //Дельта содержит весь индекс: реплика забывает свои документы
+    bool full = false;
+};
+
+/*
+ * Кодирует дельту. Документы added_ids берутся из search_server в их текущем состоянии,
+ * checksum - контрольная сумма search_server после sequence.
+ */
+std::string EncodeDelta(const SearchServer& search_server, const DeltaRange& range, uint64_t checksum,
+                        const std::vector<int>& removed_ids, const std::vector<int>& added_ids);
+
+/*
+ * Реплика индекса, которая догоняет источник, применяя его дельты по порядку.
+ */
+class IndexReplica {
+public:
+    IndexReplica() = default;
+
+    /*
+     * Применяет дельту. Бросает runtime_error, если дельта повреждена, начинается не с номера
+     * реплики или меняет стоп-слова непустой реплики. Если после применения контрольная сумма
+     * разошлась с источником, реплика очищается и тоже бросает runtime_error: её нужно заново
+     * заполнить полной дельтой.
+     */
+    void Apply(std::string_view delta);
+
+    void ApplyFile(const std::string& path);
+
+    const SearchServer& GetServer() const {
+        return search_server_;
+    }
+
+    //Номер последнего изменения источника, отражённого в реплике
+    uint64_t GetSequence() const {
+        return sequence_;
+    }
+
+    uint64_t GetChecksum() const {
+        return checksum_;
+    }
+
+private:
+    SearchServer search_server_;
+    uint64_t sequence_ = 0;
+    uint64_t checksum_ = ComputeIndexChecksum(search_server_);
+
+    void Reset();
+};
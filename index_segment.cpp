@@ -0,0 +1,303 @@
+#include "index_segment.h"
+#include "document_reordering.h"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+IndexSegment::IndexSegment(vector<SegmentDocument> documents, const SegmentPostings& postings,
+                           const DocumentOrder order)
+    : documents_(move(documents)), deleted_(documents_.size(), false) {
+    sort(documents_.begin(), documents_.end(), [](const SegmentDocument& lhs, const SegmentDocument& rhs) {
+        return lhs.id < rhs.id;
+    });
+    id_to_document_.reserve(documents_.size());
+    for (uint32_t document = 0; document < documents_.size(); ++document) {
+        id_to_document_.emplace_back(documents_[document].id, document);
+    }
+    if (order == DocumentOrder::BY_SIMILARITY) {
+        ReorderBySimilarity(postings);
+    }
+
+    term_offsets_.reserve(postings.size() + 1);
+    posting_offsets_.reserve(postings.size() + 1);
+    document_freq_.reserve(postings.size());
+    vector<uint32_t> terms_per_document(documents_.size() + 1, 0);
+
+    for (const auto& [term, term_postings] : postings) {
+        term_offsets_.push_back(term_data_.size());
+        posting_offsets_.push_back(postings_.size());
+        term_data_ += term;
+
+        const size_t first = postings_.size();
+        for (const auto& [document_id, term_freq] : term_postings) {
+            const uint32_t document = FindDocument(document_id);
+            postings_.push_back({document, term_freq});
+            ++terms_per_document[document + 1];
+        }
+        sort(postings_.begin() + first, postings_.end(), [](const Posting& lhs, const Posting& rhs) {
+            return lhs.document < rhs.document;
+        });
+        document_freq_.push_back(term_postings.size());
+    }
+    term_offsets_.push_back(term_data_.size());
+    posting_offsets_.push_back(postings_.size());
+
+    //Прямой индекс строится сортировкой подсчётом по номерам документов
+    for (size_t i = 1; i < terms_per_document.size(); ++i) {
+        terms_per_document[i] += terms_per_document[i - 1];
+    }
+    document_term_offsets_ = terms_per_document;
+    document_terms_.resize(postings_.size());
+    for (uint32_t term = 0; term + 1 < posting_offsets_.size(); ++term) {
+        for (const Posting& posting : GetPostings(term)) {
+            document_terms_[terms_per_document[posting.document]++] = term;
+        }
+    }
+}
+
+shared_ptr<IndexSegment> IndexSegment::Merge(const vector<shared_ptr<IndexSegment>>& segments,
+                                             const vector<vector<bool>>& deleted, const DocumentOrder order) {
+    vector<SegmentDocument> documents;
+    SegmentPostings postings;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        const IndexSegment& segment = *segments[i];
+        for (uint32_t document = 0; document < segment.GetDocumentCount(); ++document) {
+            if (!deleted[i][document]) {
+                documents.push_back(segment.GetDocument(document));
+            }
+        }
+        for (uint32_t term = 0; term < segment.GetTermCount(); ++term) {
+            vector<pair<int, double>>* term_postings = nullptr;
+            for (const Posting& posting : segment.GetPostings(term)) {
+                if (deleted[i][posting.document]) {
+                    continue;
+                }
+                if (term_postings == nullptr) {
+                    term_postings = &postings[segment.GetTerm(term)];
+                }
+                term_postings->push_back({segment.GetDocument(posting.document).id, posting.term_freq});
+            }
+        }
+    }
+    return make_shared<IndexSegment>(move(documents), postings, order);
+}
+
+uint32_t IndexSegment::FindDocument(const int document_id) const {
+    const auto it = lower_bound(id_to_document_.begin(), id_to_document_.end(), document_id,
+                                [](const pair<int, uint32_t>& entry, const int id) {
+        return entry.first < id;
+    });
+    if (it == id_to_document_.end() || it->first != document_id) {
+        return NOT_FOUND;
+    }
+    return it->second;
+}
+
+size_t IndexSegment::GetGapEncodedPostingBytes() const {
+    size_t bytes = 0;
+    for (uint32_t term = 0; term < GetTermCount(); ++term) {
+        uint32_t previous = 0;
+        for (const Posting& posting : GetPostings(term)) {
+            //По 7 бит разности в байте
+            for (uint32_t gap = posting.document - previous; ; gap >>= 7) {
+                ++bytes;
+                if (gap < 128) {
+                    break;
+                }
+            }
+            previous = posting.document;
+        }
+    }
+    return bytes;
+}
+
+void IndexSegment::ReorderBySimilarity(const SegmentPostings& postings) {
+    //Прямой индекс в порядке id, термин - порядковый номер в postings
+    vector<uint32_t> term_offsets(documents_.size() + 1, 0);
+    for (const auto& [_, term_postings] : postings) {
+        for (const auto& [document_id, _] : term_postings) {
+            ++term_offsets[FindDocument(document_id) + 1];
+        }
+    }
+    for (size_t i = 1; i < term_offsets.size(); ++i) {
+        term_offsets[i] += term_offsets[i - 1];
+    }
+    vector<uint32_t> terms(term_offsets.back());
+    vector<uint32_t> positions(term_offsets.begin(), term_offsets.end() - 1);
+    uint32_t term = 0;
+    for (const auto& [_, term_postings] : postings) {
+        for (const auto& [document_id, _] : term_postings) {
+            terms[positions[FindDocument(document_id)]++] = term;
+        }
+        ++term;
+    }
+
+    const vector<uint32_t> order = ComputeBisectionOrder(term_offsets, terms, postings.size());
+    vector<SegmentDocument> reordered;
+    reordered.reserve(documents_.size());
+    for (uint32_t document = 0; document < order.size(); ++document) {
+        reordered.push_back(documents_[order[document]]);
+        //До перестановки номер документа совпадал с его местом в id_to_document_
+        id_to_document_[order[document]].second = document;
+    }
+    documents_ = move(reordered);
+}
+
+bool IndexSegment::RemoveDocument(const int document_id) {
+    const uint32_t document = FindDocument(document_id);
+    if (document == NOT_FOUND || deleted_[document]) {
+        return false;
+    }
+    deleted_[document] = true;
+    ++deleted_count_;
+    for (uint32_t i = document_term_offsets_[document]; i < document_term_offsets_[document + 1]; ++i) {
+        --document_freq_[document_terms_[i]];
+    }
+    return true;
+}
+
+uint32_t IndexSegment::FindTerm(const string_view term) const {
+    uint32_t left = 0;
+    uint32_t right = GetTermCount();
+    while (left < right) {
+        const uint32_t middle = left + (right - left) / 2;
+        if (GetTerm(middle) < term) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
+    }
+    return left < GetTermCount() && GetTerm(left) == term ? left : NOT_FOUND;
+}
+
+MutableSegment::MutableSegment(const size_t capacity) : capacity_(capacity), slots_(new Slot[capacity]) {
+}
+
+MutableSegment::AddResult MutableSegment::AddDocument(const SegmentDocument& document,
+                                                      const vector<string_view>& words) {
+    const size_t slot = slot_count_.fetch_add(1);
+    if (slot >= capacity_) {
+        return AddResult::FULL;
+    }
+    {
+        IdStripe& id_stripe = id_stripes_[GetIdStripeIndex(document.id)];
+        lock_guard guard(id_stripe.mutex);
+        //Место остаётся пустым и неопубликованным, при запечатывании оно пропускается
+        if (!id_stripe.slots.emplace(document.id, slot).second) {
+            return AddResult::DUPLICATE;
+        }
+    }
+    slots_[slot].document = document;
+
+    //TF и номер полосы считаются без блокировок, затем каждая полоса блокируется один раз
+    map<string_view, double> word_freqs;
+    const double inv_word_count = words.empty() ? 0.0 : 1.0 / static_cast<int>(words.size());
+    for (const string_view word : words) {
+        word_freqs[word] += inv_word_count;
+    }
+    vector<pair<size_t, const pair<const string_view, double>*>> stripe_words;
+    stripe_words.reserve(word_freqs.size());
+    for (const auto& word_freq : word_freqs) {
+        stripe_words.emplace_back(GetStripeIndex(word_freq.first), &word_freq);
+    }
+    sort(stripe_words.begin(), stripe_words.end());
+    for (auto it = stripe_words.begin(); it != stripe_words.end();) {
+        Stripe& stripe = stripes_[it->first];
+        lock_guard guard(stripe.mutex);
+        for (const size_t stripe_index = it->first; it != stripe_words.end() && it->first == stripe_index; ++it) {
+            const auto& [word, term_freq] = *it->second;
+            auto postings = stripe.postings.find(word);
+            if (postings == stripe.postings.end()) {
+                postings = stripe.postings.emplace(string(word), vector<pair<uint32_t, double>>{}).first;
+            }
+            postings->second.emplace_back(slot, term_freq);
+        }
+    }
+
+    //Публикация строго по порядку номеров: ждём, пока опубликуется предыдущий документ
+    const uint64_t sequence = next_sequence_.fetch_add(1) + 1;
+    slots_[slot].sequence.store(sequence, memory_order_relaxed);
+    while (published_sequence_.load(memory_order_acquire) != sequence - 1) {
+        this_thread::yield();
+    }
+    published_sequence_.store(sequence, memory_order_release);
+    return slot + 1 == capacity_ ? AddResult::FILLED : AddResult::ADDED;
+}
+
+bool MutableSegment::RemoveDocument(const int document_id) {
+    IdStripe& id_stripe = id_stripes_[GetIdStripeIndex(document_id)];
+    lock_guard guard(id_stripe.mutex);
+    const auto it = id_stripe.slots.find(document_id);
+    if (it == id_stripe.slots.end()) {
+        return false;
+    }
+    //Неопубликованный документ ещё не учтён в снимках, его удаление исказило бы число живых документов
+    Slot& slot = slots_[it->second];
+    const uint64_t sequence = slot.sequence.load(memory_order_relaxed);
+    if (sequence == 0 || sequence > GetPublishedSequence()) {
+        return false;
+    }
+    slot.removed.store(true, memory_order_relaxed);
+    id_stripe.slots.erase(it);
+    ++removed_count_;
+    return true;
+}
+
+bool MutableSegment::HasDocument(const int document_id) const {
+    const IdStripe& id_stripe = id_stripes_[GetIdStripeIndex(document_id)];
+    lock_guard guard(id_stripe.mutex);
+    return id_stripe.slots.count(document_id) > 0;
+}
+
+int MutableSegment::GetDocumentFrequency(const string_view term, const uint64_t snapshot) const {
+    int count = 0;
+    ForEachPosting(term, snapshot, [&count](const SegmentDocument&, double) {
+        ++count;
+    });
+    return count;
+}
+
+shared_ptr<IndexSegment> MutableSegment::Seal() const {
+    const uint64_t snapshot = GetPublishedSequence();
+    vector<SegmentDocument> documents;
+    for (size_t slot = 0; slot < GetDocumentCount(); ++slot) {
+        if (IsVisible(slot, snapshot)) {
+            documents.push_back(slots_[slot].document);
+        }
+    }
+    SegmentPostings postings;
+    for (const Stripe& stripe : stripes_) {
+        for (const auto& [term, term_postings] : stripe.postings) {
+            vector<pair<int, double>>* sealed_postings = nullptr;
+            for (const auto& [slot, term_freq] : term_postings) {
+                if (!IsVisible(slot, snapshot)) {
+                    continue;
+                }
+                if (sealed_postings == nullptr) {
+                    sealed_postings = &postings[term];
+                }
+                sealed_postings->emplace_back(slots_[slot].document.id, term_freq);
+            }
+        }
+    }
+    return make_shared<IndexSegment>(move(documents), postings);
+}
+
+void MutableSegment::Clear() {
+    for (size_t slot = 0; slot < GetDocumentCount(); ++slot) {
+        slots_[slot].sequence.store(0, memory_order_relaxed);
+        slots_[slot].removed.store(false, memory_order_relaxed);
+    }
+    slot_count_ = 0;
+    next_sequence_ = 0;
+    published_sequence_ = 0;
+    removed_count_ = 0;
+    for (Stripe& stripe : stripes_) {
+        stripe.postings.clear();
+    }
+    for (IdStripe& id_stripe : id_stripes_) {
+        id_stripe.slots.clear();
+    }
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "search_server.h"
+
+struct SegmentDocument {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    int rating = 0;
+};
+
+//Постинги при построении сегмента: термин -> пары (id документа, TF)
+using SegmentPostings = std::map<std::string_view, std::vector<std::pair<int, double>>>;
+
+//Порядок локальных номеров документов сегмента
+enum class DocumentOrder {
+    BY_ID,
+    //Документы с общими терминами рядом, см. ComputeBisectionOrder
+    BY_SIMILARITY
+};
+
+/*
+ * Неизменяемый сегмент индекса в отсортированных массивах.
+ * Документы адресуются локальным номером в порядке order, внешний id переводится
+ * в номер по отдельной таблице. Термины лежат одной строкой и упорядочены
+ * лексикографически, постинги каждого термина занимают непрерывный участок общего
+ * массива и упорядочены по локальным номерам.
+ * Изменяемы только отметки об удалении документов.
+ */
+class IndexSegment {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    struct Posting {
+        uint32_t document = 0;
+        double term_freq = 0.0;
+    };
+
+    IndexSegment(std::vector<SegmentDocument> documents, const SegmentPostings& postings,
+                 DocumentOrder order = DocumentOrder::BY_ID);
+
+    /*
+     * Сливает сегменты в один, пропуская документы, удалённые по снимкам deleted.
+     */
+    static std::shared_ptr<IndexSegment> Merge(const std::vector<std::shared_ptr<IndexSegment>>& segments,
+                                               const std::vector<std::vector<bool>>& deleted,
+                                               DocumentOrder order = DocumentOrder::BY_ID);
+
+    size_t GetDocumentCount() const {
+        return documents_.size();
+    }
+
+    size_t GetLiveDocumentCount() const {
+        return documents_.size() - deleted_count_;
+    }
+
+    const SegmentDocument& GetDocument(uint32_t document) const {
+        return documents_[document];
+    }
+
+    bool IsDeleted(uint32_t document) const {
+        return deleted_[document];
+    }
+
+    const std::vector<bool>& GetDeleted() const {
+        return deleted_;
+    }
+
+    //Локальный номер живого документа или NOT_FOUND
+    uint32_t FindDocument(int document_id) const;
+
+    /*
+     * Помечает документ удалённым. Возвращает false, если живого документа с таким id нет.
+     */
+    bool RemoveDocument(int document_id);
+
+    uint32_t FindTerm(std::string_view term) const;
+
+    size_t GetTermCount() const {
+        return term_offsets_.size() - 1;
+    }
+
+    std::string_view GetTerm(uint32_t term) const {
+        return std::string_view(term_data_).substr(term_offsets_[term], term_offsets_[term + 1] - term_offsets_[term]);
+    }
+
+    IteratorRange<std::vector<Posting>::const_iterator> GetPostings(uint32_t term) const {
+        return {postings_.begin() + posting_offsets_[term], postings_.begin() + posting_offsets_[term + 1]};
+    }
+
+    //Число живых документов с термином
+    int GetDocumentFrequency(uint32_t term) const {
+        return document_freq_[term];
+    }
+
+    /*
+     * Сколько байтов заняли бы локальные номера в постингах при кодировании разностей varint.
+     */
+    size_t GetGapEncodedPostingBytes() const;
+
+private:
+    std::vector<SegmentDocument> documents_;
+    //Пары (id, локальный номер), упорядоченные по id
+    std::vector<std::pair<int, uint32_t>> id_to_document_;
+    std::vector<bool> deleted_;
+    size_t deleted_count_ = 0;
+
+    std::string term_data_;
+    std::vector<uint32_t> term_offsets_;
+    std::vector<uint32_t> posting_offsets_;
+    std::vector<Posting> postings_;
+    std::vector<int> document_freq_;
+
+    //Термины каждого документа, нужны для пересчёта document_freq_ при удалении
+    std::vector<uint32_t> document_term_offsets_;
+    std::vector<uint32_t> document_terms_;
+
+    /*
+     * Переставляет документы, упорядоченные по id, в порядок ComputeBisectionOrder.
+     */
+    void ReorderBySimilarity(const SegmentPostings& postings);
+};
+
+/*
+ * Небольшой изменяемый сегмент, в который попадают новые документы.
+ * Документы можно добавлять из нескольких потоков одновременно: словарь и постинги разбиты
+ * на STRIPE_COUNT полос по хешу термина, у каждой полосы свой мьютекс, а места в таблице
+ * документов раздаются атомарным счётчиком. После вставки всех постингов документ получает
+ * номер публикации, публикации идут строго по порядку номеров. Поиск берёт номер последней
+ * публикации как снимок и видит документы с номерами не больше него целиком или не видит вовсе.
+ * Удаление, запечатывание и очистка требуют, чтобы добавления в это время не шли.
+ * По заполнении таблицы запечатывается в IndexSegment.
+ */
+class MutableSegment {
+public:
+    static constexpr size_t STRIPE_COUNT = 64;
+
+    enum class AddResult {
+        ADDED,
+        //Документ добавлен и занял последнее место, сегмент пора запечатать
+        FILLED,
+        //Мест нет, документ не добавлен
+        FULL,
+        DUPLICATE
+    };
+
+    explicit MutableSegment(size_t capacity);
+
+    AddResult AddDocument(const SegmentDocument& document, const std::vector<std::string_view>& words);
+
+    /*
+     * Удаляет опубликованный документ. Можно вызывать одновременно с AddDocument и поиском;
+     * документ, добавление которого ещё идёт, считается ещё не добавленным.
+     */
+    bool RemoveDocument(int document_id);
+
+    //Учитывает и документы, добавление которых ещё идёт
+    bool HasDocument(int document_id) const;
+
+    //Число занятых мест в таблице документов
+    size_t GetDocumentCount() const {
+        return std::min(slot_count_.load(), capacity_);
+    }
+
+    uint64_t GetPublishedSequence() const {
+        return published_sequence_.load(std::memory_order_acquire);
+    }
+
+    //Число живых документов, видимых в снимке snapshot
+    int GetLiveDocumentCount(uint64_t snapshot) const {
+        return static_cast<int>(snapshot) - removed_count_;
+    }
+
+    int GetDocumentFrequency(std::string_view term, uint64_t snapshot) const;
+
+    /*
+     * Вызывает func(document, term_freq) для каждого видимого в снимке snapshot документа с термином term.
+     */
+    template <typename Func>
+    void ForEachPosting(std::string_view term, uint64_t snapshot, Func func) const {
+        const Stripe& stripe = GetStripe(term);
+        std::lock_guard guard(stripe.mutex);
+        const auto postings = stripe.postings.find(term);
+        if (postings == stripe.postings.end()) {
+            return;
+        }
+        for (const auto& [slot, term_freq] : postings->second) {
+            if (IsVisible(slot, snapshot)) {
+                func(slots_[slot].document, term_freq);
+            }
+        }
+    }
+
+    std::shared_ptr<IndexSegment> Seal() const;
+
+    void Clear();
+
+private:
+    struct Slot {
+        SegmentDocument document;
+        //Номер публикации, 0 - документ ещё не опубликован
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<bool> removed{false};
+    };
+
+    struct Stripe {
+        mutable std::mutex mutex;
+        //Термин -> пары (место документа, TF)
+        std::map<std::string, std::vector<std::pair<uint32_t, double>>, std::less<>> postings;
+    };
+
+    struct IdStripe {
+        mutable std::mutex mutex;
+        std::unordered_map<int, uint32_t> slots;
+    };
+
+    const size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<size_t> slot_count_{0};
+    std::atomic<uint64_t> next_sequence_{0};
+    std::atomic<uint64_t> published_sequence_{0};
+    //Удалённые опубликованные документы
+    std::atomic<int> removed_count_{0};
+
+    std::array<Stripe, STRIPE_COUNT> stripes_;
+    std::array<IdStripe, STRIPE_COUNT> id_stripes_;
+
+    static size_t GetStripeIndex(std::string_view term) {
+        return std::hash<std::string_view>{}(term) % STRIPE_COUNT;
+    }
+
+    const Stripe& GetStripe(std::string_view term) const {
+        return stripes_[GetStripeIndex(term)];
+    }
+
+    static size_t GetIdStripeIndex(int document_id) {
+        return static_cast<unsigned>(document_id) % STRIPE_COUNT;
+    }
+
+    bool IsVisible(uint32_t slot, uint64_t snapshot) const {
+        const uint64_t sequence = slots_[slot].sequence.load(std::memory_order_relaxed);
+        return sequence != 0 && sequence <= snapshot && !slots_[slot].removed.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,145 @@
+#include "index_snapshot.h"
+#include "binary_format.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const string SNAPSHOT_MAGIC = "SSNP"s;
+const uint32_t SNAPSHOT_VERSION = 1;
+
+}
+
+void WriteFileAtomically(const string& path, const string& data) {
+    const string temp_path = path + ".tmp"s;
+    const int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw runtime_error("Can't create file "s + temp_path);
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t result = write(fd, data.data() + written, data.size() - written);
+        if (result < 0) {
+            close(fd);
+            throw runtime_error("Can't write file "s + temp_path);
+        }
+        written += result;
+    }
+    if (fsync(fd) != 0 || close(fd) != 0) {
+        throw runtime_error("Can't sync file "s + temp_path);
+    }
+    if (rename(temp_path.c_str(), path.c_str()) != 0) {
+        throw runtime_error("Can't rename file "s + temp_path);
+    }
+}
+
+optional<string> ReadWholeFile(const string& path) {
+    ifstream input(path, ios::binary);
+    if (!input) {
+        return nullopt;
+    }
+    ostringstream content;
+    content << input.rdbuf();
+    return content.str();
+}
+
+void SaveSnapshot(const SearchServer& search_server, uint64_t sequence, const string& path) {
+    using namespace binary_format;
+    string data = SNAPSHOT_MAGIC;
+    PutInt(data, SNAPSHOT_VERSION);
+    PutInt(data, sequence);
+
+    PutInt(data, static_cast<uint32_t>(search_server.GetStopWords().size()));
+    for (const string& word : search_server.GetStopWords()) {
+        PutString(data, word);
+    }
+
+    PutInt(data, static_cast<uint32_t>(search_server.GetDocumentCount()));
+    for (const int document_id : search_server) {
+        const SearchServer::DocsParams params = *search_server.GetDocumentParams(document_id);
+        PutInt(data, document_id);
+        PutInt(data, static_cast<uint8_t>(params.status));
+        PutInt(data, params.rating);
+        const auto& word_freqs = search_server.GetWordFrequencies(document_id);
+        PutInt(data, static_cast<uint32_t>(word_freqs.size()));
+        for (const auto& [word, freq] : word_freqs) {
+            PutString(data, word);
+            PutDouble(data, freq);
+        }
+    }
+
+    PutInt(data, ComputeCrc32(data));
+    WriteFileAtomically(path, data);
+}
+
+optional<IndexSnapshot> LoadSnapshot(const string& path) {
+    using namespace binary_format;
+    const optional<string> data = ReadWholeFile(path);
+    if (!data) {
+        return nullopt;
+    }
+    const auto corrupted = [&path]() {
+        return runtime_error("Snapshot "s + path + " is corrupted"s);
+    };
+    if (data->size() < SNAPSHOT_MAGIC.size() + sizeof(uint32_t)
+        || data->compare(0, SNAPSHOT_MAGIC.size(), SNAPSHOT_MAGIC) != 0) {
+        throw corrupted();
+    }
+    const string_view body = string_view(*data).substr(0, data->size() - sizeof(uint32_t));
+    Reader checksum_reader(string_view(*data).substr(body.size()));
+    uint32_t checksum = 0;
+    if (!checksum_reader.GetInt(checksum) || checksum != ComputeCrc32(body)) {
+        throw corrupted();
+    }
+
+    Reader reader(body.substr(SNAPSHOT_MAGIC.size()));
+    uint32_t version = 0;
+    uint64_t sequence = 0;
+    uint32_t stop_word_count = 0;
+    if (!reader.GetInt(version) || version != SNAPSHOT_VERSION || !reader.GetInt(sequence)
+        || !reader.GetInt(stop_word_count)) {
+        throw corrupted();
+    }
+    vector<string_view> stop_words(stop_word_count);
+    for (string_view& word : stop_words) {
+        reader.GetString(word);
+    }
+
+    IndexSnapshot snapshot{SearchServer(stop_words), sequence};
+    uint32_t document_count = 0;
+    reader.GetInt(document_count);
+    for (uint32_t i = 0; i < document_count && reader.IsOk(); ++i) {
+        int document_id = 0;
+        uint8_t status = 0;
+        SearchServer::DocsParams params;
+        uint32_t word_count = 0;
+        reader.GetInt(document_id);
+        reader.GetInt(status);
+        reader.GetInt(params.rating);
+        reader.GetInt(word_count);
+        params.status = static_cast<DocumentStatus>(status);
+
+        SearchServer::WordFrequencies word_freqs;
+        for (uint32_t j = 0; j < word_count && reader.IsOk(); ++j) {
+            string_view word;
+            double freq = 0.0;
+            reader.GetString(word);
+            reader.GetDouble(freq);
+            word_freqs.emplace(word, freq);
+        }
+        if (reader.IsOk()) {
+            snapshot.search_server.AddDocumentWithFrequencies(document_id, word_freqs, params);
+        }
+    }
+    if (!reader.IsOk() || reader.GetRemaining() != 0) {
+        throw corrupted();
+    }
+    return snapshot;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "search_server.h"
+
+struct IndexSnapshot {
+    SearchServer search_server;
+    //Номер последней операции журнала, отражённой в снимке
+    uint64_t sequence = 0;
+};
+
+/*
+ * Сохраняет снимок индекса: стоп-слова, атрибуты и частоты слов всех документов.
+ * Файл пишется во временный и атомарно переименовывается, так что на диске всегда
+ * лежит либо старый, либо новый целый снимок.
+ */
+void SaveSnapshot(const SearchServer& search_server, uint64_t sequence, const std::string& path);
+
+/*
+ * Загружает снимок. Возвращает пусто, если файла нет, и бросает runtime_error,
+ * если он повреждён.
+ */
+std::optional<IndexSnapshot> LoadSnapshot(const std::string& path);
+
+/*
+ * Записывает data в файл path через временный файл с fsync и rename.
+ */
+void WriteFileAtomically(const std::string& path, const std::string& data);
+
+//Содержимое файла целиком, пусто если файла нет
+std::optional<std::string> ReadWholeFile(const std::string& path);
@@ -0,0 +1,144 @@
+#include "load_generator.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <deque>
+#include <future>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <ostream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct ConnectionResult {
+    vector<chrono::microseconds> latencies;
+    size_t errors = 0;
+};
+
+void SendAll(int fd, string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (written <= 0) {
+            throw runtime_error("Connection to query server lost"s);
+        }
+        data.remove_prefix(written);
+    }
+}
+
+/*
+ * Держит до pipeline_depth запросов в полёте: после каждого ответа отправляет следующий запрос.
+ */
+ConnectionResult RunConnection(uint16_t port, const vector<string>& queries, size_t first_query,
+                               size_t request_count, size_t pipeline_depth) {
+    ConnectionResult result;
+    result.latencies.reserve(request_count);
+    const int fd = ConnectToQueryServer(port);
+
+    deque<Clock::time_point> in_flight;
+    size_t sent = 0;
+    string requests;
+    string input;
+    char buffer[64 * 1024];
+    try {
+        while (result.latencies.size() < request_count) {
+            requests.clear();
+            while (sent < request_count && in_flight.size() < pipeline_depth) {
+                requests += "FIND\t"sv;
+                requests += queries[(first_query + sent) % queries.size()];
+                requests += '\n';
+                in_flight.push_back(Clock::now());
+                ++sent;
+            }
+            SendAll(fd, requests);
+
+            const ssize_t read_size = recv(fd, buffer, sizeof(buffer), 0);
+            if (read_size <= 0) {
+                throw runtime_error("Connection to query server lost"s);
+            }
+            input.append(buffer, read_size);
+            size_t position = 0;
+            for (size_t end = input.find('\n'); end != string::npos; end = input.find('\n', position)) {
+                if (input.compare(position, 2, "OK"sv) != 0) {
+                    ++result.errors;
+                }
+                result.latencies.push_back(chrono::duration_cast<chrono::microseconds>(
+                        Clock::now() - in_flight.front()));
+                in_flight.pop_front();
+                position = end + 1;
+            }
+            input.erase(0, position);
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    return result;
+}
+
+}
+
+int ConnectToQueryServer(const uint16_t port) {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw runtime_error("Can't connect to query server on port "s + to_string(port));
+    }
+    const int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return fd;
+}
+
+LoadTestReport RunLoadTest(const vector<string>& queries, const LoadTestOptions& options) {
+    if (queries.empty() || options.connection_count == 0 || options.pipeline_depth == 0) {
+        throw invalid_argument("Load test needs queries, connections and a positive pipeline depth"s);
+    }
+
+    const Clock::time_point start = Clock::now();
+    vector<future<ConnectionResult>> connections;
+    for (size_t i = 0; i < options.connection_count; ++i) {
+        //Запросы делятся между соединениями поровну, остаток достаётся первым
+        const size_t request_count = options.request_count / options.connection_count
+                                     + (i < options.request_count % options.connection_count ? 1 : 0);
+        connections.push_back(async(launch::async, RunConnection, options.port, cref(queries),
+                                    i * queries.size() / options.connection_count, request_count,
+                                    options.pipeline_depth));
+    }
+
+    LoadTestReport report;
+    vector<chrono::microseconds> latencies;
+    for (auto& connection : connections) {
+        ConnectionResult result = connection.get();
+        report.errors += result.errors;
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+    }
+    report.seconds = chrono::duration<double>(Clock::now() - start).count();
+    report.requests = latencies.size();
+    report.queries_per_second = report.seconds > 0 ? report.requests / report.seconds : 0.0;
+    if (!latencies.empty()) {
+        sort(latencies.begin(), latencies.end());
+        report.p50_latency = latencies[latencies.size() / 2];
+        report.p99_latency = latencies[min(latencies.size() - 1, latencies.size() * 99 / 100)];
+        report.max_latency = latencies.back();
+    }
+    return report;
+}
+
+ostream& operator<<(ostream& out, const LoadTestReport& report) {
+    return out << report.requests << " requests ("s << report.errors << " errors) in "s << report.seconds
+               << " s: "s << report.queries_per_second << " QPS, latency p50 "s << report.p50_latency.count()
+               << " us, p99 "s << report.p99_latency.count() << " us, max "s << report.max_latency.count() << " us"s;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/*
+ * Генератор нагрузки для QueryServer: несколько соединений, в каждом до pipeline_depth
+ * запросов FIND в полёте. Задержка запроса - время от отправки до получения ответа.
+ */
+struct LoadTestOptions {
+    uint16_t port = 0;
+    size_t connection_count = 4;
+    size_t pipeline_depth = 16;
+    //Всего запросов по всем соединениям, запросы берутся из queries по кругу
+    size_t request_count = 10000;
+};
+
+struct LoadTestReport {
+    size_t requests = 0;
+    size_t errors = 0;
+    double seconds = 0.0;
+    double queries_per_second = 0.0;
+    std::chrono::microseconds p50_latency{0};
+    std::chrono::microseconds p99_latency{0};
+    std::chrono::microseconds max_latency{0};
+};
+
+/*
+ * Подключается к серверу на 127.0.0.1. Бросает runtime_error, если подключиться не удалось.
+ */
+int ConnectToQueryServer(uint16_t port);
+
+LoadTestReport RunLoadTest(const std::vector<std::string>& queries, const LoadTestOptions& options);
+
+std::ostream& operator<<(std::ostream& out, const LoadTestReport& report);
@@ -1,14 +1,79 @@
+#include "benchmark.h"
+#include "corpus_loader.h"
+#include "load_generator.h"
 #include "process_queries.h"
+#include "query_server.h"
 #include "search_server.h"
 #include "unit_tests.h"
 
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
 
 using namespace std;
 
-int main() {
+/*
+ * --serve <corpus> [port]: загружает корпус и обслуживает запросы, см. query_server.h.
+ */
+int Serve(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: "s << argv[0] << " --serve <corpus> [port]"s << endl;
+        return 1;
+    }
+    SearchServer search_server;
+    const CorpusLoadResult result = LoadCorpus(argv[2], search_server);
+    cerr << "Loaded "s << result.loaded << " documents, "s << result.errors.size() << " errors"s << endl;
+
+    QueryServer::Options options;
+    options.port = argc > 3 ? stoi(argv[3]) : 0;
+    QueryServer query_server(search_server, options);
+    cerr << "Listening on 127.0.0.1:"s << query_server.GetPort() << endl;
+    query_server.Run();
+    return 0;
+}
+
+/*
+ * --load-test <port> <queries> [connections] [pipeline depth] [requests]:
+ * нагружает сервер запросами из файла, по запросу на строку.
+ */
+int LoadTest(int argc, char* argv[]) {
+    if (argc < 4) {
+        cerr << "Usage: "s << argv[0] << " --load-test <port> <queries> [connections] [depth] [requests]"s << endl;
+        return 1;
+    }
+    LoadTestOptions options;
+    options.port = stoi(argv[2]);
+    vector<string> queries;
+    ifstream file(argv[3]);
+    for (string query; getline(file, query);) {
+        queries.push_back(move(query));
+    }
+    if (argc > 4) {
+        options.connection_count = stoul(argv[4]);
+    }
+    if (argc > 5) {
+        options.pipeline_depth = stoul(argv[5]);
+    }
+    if (argc > 6) {
+        options.request_count = stoul(argv[6]);
+    }
+    cout << RunLoadTest(queries, options) << endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && argv[1] == "--benchmark"s) {
+        RunBenchmarks();
+        return 0;
+    }
+    if (argc > 1 && argv[1] == "--serve"s) {
+        return Serve(argc, argv);
+    }
+    if (argc > 1 && argv[1] == "--load-test"s) {
+        return LoadTest(argc, argv);
+    }
+
     TestSearchServer();
     SearchServer search_server("and with"s);
 
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Точный подсчёт памяти, занятой контейнерами стандартной библиотеки.
+ * Размеры не включают служебные заголовки блоков самого malloc.
+ * Раскладка узлов зависит от реализации библиотеки. Предположения о ней собраны
+ * в TreeNodeSize и HashNodeSize, и только они описывают libstdc++. Остальной код
+ * и тесты считают размеры через эти функции.
+ */
+namespace memory_usage {
+
+//Заголовок узла красно-чёрного дерева std::map/std::set в libstdc++
+struct TreeNodeHeader {
+    int color;
+    void* parent;
+    void* left;
+    void* right;
+};
+
+constexpr size_t AlignUp(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+/*
+ * Размер узла std::map/std::set со значением Value в libstdc++:
+ * цвет и три указателя, затем значение.
+ */
+template <typename Value>
+constexpr size_t TreeNodeSize() {
+    constexpr size_t alignment = alignof(Value) > alignof(TreeNodeHeader) ? alignof(Value) : alignof(TreeNodeHeader);
+    return AlignUp(AlignUp(sizeof(TreeNodeHeader), alignof(Value)) + sizeof(Value), alignment);
+}
+
+/*
+ * Размер узла std::unordered_map/std::unordered_multimap с ключом Key и значением Value
+ * в libstdc++: указатель на следующий узел и значение, а после них хеш ключа.
+ * Хеш кешируется, только если std::hash<Key> не считается быстрым. Быстрыми считаются
+ * хеши целых, перечислений и указателей.
+ */
+template <typename Key, typename Value>
+constexpr size_t HashNodeSize() {
+    constexpr bool cached_hash = !(std::is_integral_v<Key> || std::is_enum_v<Key> || std::is_pointer_v<Key>);
+    constexpr size_t alignment = alignof(Value) > alignof(void*) ? alignof(Value) : alignof(void*);
+    constexpr size_t size = AlignUp(sizeof(void*), alignof(Value)) + sizeof(Value);
+    return AlignUp(cached_hash ? AlignUp(size, alignof(size_t)) + sizeof(size_t) : size, alignment);
+}
+
+//Память в куче, не считая самого объекта
+inline size_t HeapBytes(const std::string& str) {
+    //Короткие строки хранятся внутри объекта
+    return str.capacity() > 15 ? str.capacity() + 1 : 0;
+}
+
+template <typename Value, typename Allocator>
+size_t HeapBytes(const std::vector<Value, Allocator>& container) {
+    return container.capacity() * sizeof(Value);
+}
+
+template <typename Key, typename Compare, typename Allocator>
+size_t HeapBytes(const std::set<Key, Compare, Allocator>& container) {
+    return container.size() * TreeNodeSize<Key>();
+}
+
+template <typename Compare, typename Allocator>
+size_t HeapBytes(const std::set<std::string, Compare, Allocator>& container) {
+    size_t bytes = container.size() * TreeNodeSize<std::string>();
+    for (const std::string& str : container) {
+        bytes += HeapBytes(str);
+    }
+    return bytes;
+}
+
+template <typename Key, typename Value, typename Compare, typename Allocator>
+size_t HeapBytes(const std::map<Key, Value, Compare, Allocator>& container) {
+    return container.size() * TreeNodeSize<std::pair<const Key, Value>>();
+}
+
+//Узлы и массив корзин; единственная корзина пустой таблицы хранится внутри объекта
+template <typename Key, typename Value, typename Equal, typename Allocator>
+size_t HeapBytes(const std::unordered_multimap<Key, Value, std::hash<Key>, Equal, Allocator>& container) {
+    return container.size() * HashNodeSize<Key, std::pair<const Key, Value>>()
+           + (container.bucket_count() > 1 ? container.bucket_count() * sizeof(void*) : 0);
+}
+
+}
@@ -0,0 +1,170 @@
+#include "minimal_perfect_hash.h"
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <bitset>
+#include <functional>
+#include <numeric>
+
+using namespace std;
+
+namespace {
+
+int CountBits(const uint64_t word) {
+    return static_cast<int>(bitset<64>(word).count());
+}
+
+bool TestBit(const vector<uint64_t>& bits, const uint64_t position) {
+    return (bits[position / 64] >> (position % 64)) & 1;
+}
+
+void SetBit(vector<uint64_t>& bits, const uint64_t position) {
+    bits[position / 64] |= uint64_t{1} << (position % 64);
+}
+
+uint32_t GetFingerprint(const uint64_t hash) {
+    return static_cast<uint32_t>(hash >> 32);
+}
+
+}
+
+MinimalPerfectHash::MinimalPerfectHash(vector<uint64_t> hashes) : size_(hashes.size()) {
+    uint32_t placed = 0;
+    for (int level_index = 0; !hashes.empty() && level_index < MAX_LEVEL_COUNT; ++level_index) {
+        Level level;
+        level.bit_count = max<uint64_t>(64, (GAMMA * hashes.size() + 63) / 64 * 64);
+        level.bits.assign(level.bit_count / 64, 0);
+        vector<uint64_t> collided(level.bits.size(), 0);
+        for (const uint64_t hash : hashes) {
+            const uint64_t position = GetPosition(hash, level_index, level.bit_count);
+            if (TestBit(level.bits, position)) {
+                SetBit(collided, position);
+            } else {
+                SetBit(level.bits, position);
+            }
+        }
+
+        level.ranks.resize(level.bits.size());
+        for (size_t i = 0; i < level.bits.size(); ++i) {
+            level.bits[i] &= ~collided[i];
+            level.ranks[i] = placed;
+            placed += CountBits(level.bits[i]);
+        }
+        hashes.erase(remove_if(hashes.begin(), hashes.end(), [&](const uint64_t hash) {
+            return !TestBit(collided, GetPosition(hash, level_index, level.bit_count));
+        }), hashes.end());
+        levels_.push_back(move(level));
+    }
+
+    sort(hashes.begin(), hashes.end());
+    hashes.shrink_to_fit();
+    fallback_ = move(hashes);
+    fallback_base_ = placed;
+}
+
+uint32_t MinimalPerfectHash::Lookup(const uint64_t hash) const {
+    for (size_t level_index = 0; level_index < levels_.size(); ++level_index) {
+        const Level& level = levels_[level_index];
+        const uint64_t position = GetPosition(hash, static_cast<int>(level_index), level.bit_count);
+        const uint64_t word = level.bits[position / 64];
+        const uint64_t bit = position % 64;
+        if ((word >> bit) & 1) {
+            return level.ranks[position / 64] + CountBits(word & ((uint64_t{1} << bit) - 1));
+        }
+    }
+    const auto it = lower_bound(fallback_.begin(), fallback_.end(), hash);
+    if (it == fallback_.end() || *it != hash) {
+        return NOT_FOUND;
+    }
+    return fallback_base_ + static_cast<uint32_t>(it - fallback_.begin());
+}
+
+size_t MinimalPerfectHash::GetMemoryUsage() const {
+    size_t bytes = memory_usage::HeapBytes(levels_) + memory_usage::HeapBytes(fallback_);
+    for (const Level& level : levels_) {
+        bytes += memory_usage::HeapBytes(level.bits) + memory_usage::HeapBytes(level.ranks);
+    }
+    return bytes;
+}
+
+uint64_t MinimalPerfectHash::GetPosition(const uint64_t hash, const int level, const uint64_t bit_count) {
+    //splitmix64 от хеша, своего для каждого уровня
+    uint64_t x = hash + (static_cast<uint64_t>(level) + 1) * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x % bit_count;
+}
+
+FrozenStringSet::FrozenStringSet(const vector<string_view>& strings) {
+    vector<uint64_t> hashes(strings.size());
+    transform(strings.begin(), strings.end(), hashes.begin(), hash<string_view>{});
+
+    //Строки с уже встречавшимся хешем в хеш-функцию не попадают
+    vector<size_t> by_hash(strings.size());
+    iota(by_hash.begin(), by_hash.end(), 0);
+    sort(by_hash.begin(), by_hash.end(), [&hashes](const size_t lhs, const size_t rhs) {
+        return hashes[lhs] < hashes[rhs];
+    });
+    vector<uint64_t> unique_hashes;
+    vector<size_t> colliding;
+    for (size_t i = 0; i < by_hash.size(); ++i) {
+        if (i > 0 && hashes[by_hash[i]] == hashes[by_hash[i - 1]]) {
+            colliding.push_back(by_hash[i]);
+        } else {
+            unique_hashes.push_back(hashes[by_hash[i]]);
+        }
+    }
+    hash_ = MinimalPerfectHash(move(unique_hashes));
+
+    vector<string_view> by_index(strings.size());
+    fingerprints_.resize(strings.size());
+    vector<bool> is_colliding(strings.size(), false);
+    for (size_t i = 0; i < colliding.size(); ++i) {
+        const uint32_t index = static_cast<uint32_t>(hash_.size() + i);
+        by_index[index] = strings[colliding[i]];
+        fingerprints_[index] = GetFingerprint(hashes[colliding[i]]);
+        is_colliding[colliding[i]] = true;
+    }
+    for (size_t i = 0; i < strings.size(); ++i) {
+        if (!is_colliding[i]) {
+            const uint32_t index = hash_.Lookup(hashes[i]);
+            by_index[index] = strings[i];
+            fingerprints_[index] = GetFingerprint(hashes[i]);
+        }
+    }
+
+    offsets_.reserve(strings.size() + 1);
+    for (const string_view str : by_index) {
+        offsets_.push_back(data_.size());
+        data_ += str;
+    }
+    offsets_.push_back(data_.size());
+
+    for (size_t i = 0; i < colliding.size(); ++i) {
+        const uint32_t index = static_cast<uint32_t>(hash_.size() + i);
+        collisions_.emplace_back(Get(index), index);
+    }
+    sort(collisions_.begin(), collisions_.end());
+}
+
+uint32_t FrozenStringSet::Find(const string_view str) const {
+    const uint64_t hash = std::hash<string_view>{}(str);
+    const uint32_t index = hash_.Lookup(hash);
+    if (index != MinimalPerfectHash::NOT_FOUND && fingerprints_[index] == GetFingerprint(hash) && Get(index) == str) {
+        return index;
+    }
+    if (collisions_.empty()) {
+        return NOT_FOUND;
+    }
+    const auto it = lower_bound(collisions_.begin(), collisions_.end(), str,
+                                [](const pair<string_view, uint32_t>& entry, const string_view value) {
+        return entry.first < value;
+    });
+    return it != collisions_.end() && it->first == str ? it->second : NOT_FOUND;
+}
+
+size_t FrozenStringSet::GetMemoryUsage() const {
+    return hash_.GetMemoryUsage() + memory_usage::HeapBytes(fingerprints_) + memory_usage::HeapBytes(data_)
+           + memory_usage::HeapBytes(offsets_) + memory_usage::HeapBytes(collisions_);
+}
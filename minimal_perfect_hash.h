@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+ * Минимальная совершенная хеш-функция над 64-битными хешами ключей, схема BBHash.
+ * На каждом уровне ключ попадает в бит массива размером GAMMA * (число ключей уровня);
+ * ключи, попавшие в бит в одиночку, получают номер по рангу бита, столкнувшиеся уходят
+ * на следующий уровень. Номера ключей образуют ровно [0, size()), на ключ уходит около
+ * пяти бит. Для ключа не из построения Lookup возвращает произвольный номер или NOT_FOUND,
+ * поэтому вызывающий сам проверяет, что по номеру лежит именно его ключ.
+ */
+class MinimalPerfectHash {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    MinimalPerfectHash() = default;
+
+    //Хеши должны быть попарно различны
+    explicit MinimalPerfectHash(std::vector<uint64_t> hashes);
+
+    uint32_t Lookup(uint64_t hash) const;
+
+    size_t size() const {
+        return size_;
+    }
+
+    size_t GetMemoryUsage() const;
+
+private:
+    static constexpr uint64_t GAMMA = 2;
+    static constexpr int MAX_LEVEL_COUNT = 32;
+
+    struct Level {
+        uint64_t bit_count = 0;
+        std::vector<uint64_t> bits;
+        //Число номеров, выданных до каждого слова bits, считая предыдущие уровни
+        std::vector<uint32_t> ranks;
+    };
+
+    std::vector<Level> levels_;
+    //Ключи, не разошедшиеся за MAX_LEVEL_COUNT уровней, по возрастанию; получают номера после уровней
+    std::vector<uint64_t> fallback_;
+    uint32_t fallback_base_ = 0;
+    size_t size_ = 0;
+
+    static uint64_t GetPosition(uint64_t hash, int level, uint64_t bit_count);
+};
+
+/*
+ * Неизменяемое множество строк с поиском через MinimalPerfectHash.
+ * Найденный по хешу номер проверяется сначала по 32-битному отпечатку хеша, и только
+ * при его совпадении - сравнением строк, так что промах обычно не читает строк вовсе.
+ * Строки лежат одной строкой в порядке номеров.
+ */
+class FrozenStringSet {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    FrozenStringSet() = default;
+
+    //Строки должны быть попарно различны
+    explicit FrozenStringSet(const std::vector<std::string_view>& strings);
+
+    //Номер строки из [0, size()) или NOT_FOUND
+    uint32_t Find(std::string_view str) const;
+
+    std::string_view Get(uint32_t index) const {
+        return std::string_view(data_).substr(offsets_[index], offsets_[index + 1] - offsets_[index]);
+    }
+
+    size_t size() const {
+        return fingerprints_.size();
+    }
+
+    size_t GetMemoryUsage() const;
+
+private:
+    MinimalPerfectHash hash_;
+    std::vector<uint32_t> fingerprints_;
+    std::string data_;
+    std::vector<uint32_t> offsets_;
+    //Строки, 64-битный хеш которых совпал с хешем другой строки, по возрастанию, и их номера
+    std::vector<std::pair<std::string_view, uint32_t>> collisions_;
+};
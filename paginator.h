@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <vector>
 
 template <typename Iterator>
@@ -29,34 +32,93 @@ std::ostream& operator<<(std::ostream& os, const IteratorRange<Iterator>& range)
     return os;
 }
 
+/*
+ * Ленивое разбиение диапазона на страницы.
+ * Страницы не хранятся, а вычисляются при обращении: для итераторов произвольного
+ * доступа operator[] работает за O(1), последовательный обход стоит O(N) для любых итераторов.
+ */
 template <typename Iterator>
 class Paginator {
 public:
-    Paginator(Iterator container_begin, Iterator container_end, size_t size) {
-        size_t container_size = std::distance(container_begin, container_end);
-        Iterator current_begin = container_begin;
-        Iterator current_end = container_begin;
-        for (size_t i = 0; i < container_size; i += size) {
-            if (i + size < container_size) {
-                std::advance(current_end, size);
-            } else {
-                current_end = container_end;
-            }
-            pages_.push_back({
-                current_begin,
-                current_end
-            });
-            current_begin = current_end;
+    class PageIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        PageIterator(Iterator current, size_t remaining, size_t page_size)
+            : current_(current), remaining_(remaining), page_size_(page_size) {}
+
+        value_type operator*() const {
+            return {current_, std::next(current_, CurrentPageSize())};
+        }
+
+        PageIterator& operator++() {
+            const size_t page_size = CurrentPageSize();
+            std::advance(current_, page_size);
+            remaining_ -= page_size;
+            return *this;
+        }
+
+        PageIterator operator++(int) {
+            PageIterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return remaining_ == other.remaining_;
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Iterator current_;
+        size_t remaining_ = 0;
+        size_t page_size_ = 0;
+
+        size_t CurrentPageSize() const {
+            return std::min(page_size_, remaining_);
         }
+    };
+
+    Paginator(Iterator container_begin, Iterator container_end, size_t size)
+        : begin_(container_begin),
+          end_(container_end),
+          page_size_(size),
+          container_size_(std::distance(container_begin, container_end)) {
+        if (page_size_ == 0) {
+            throw std::invalid_argument("Page size must be positive!");
+        }
+    }
+
+    IteratorRange<Iterator> operator[](size_t index) const {
+        const size_t offset = std::min(index * page_size_, container_size_);
+        const Iterator page_begin = std::next(begin_, offset);
+        return {page_begin, std::next(page_begin, std::min(page_size_, container_size_ - offset))};
+    }
+
+    size_t size() const {
+        return (container_size_ + page_size_ - 1) / page_size_;
     }
-    auto begin() const {
-        return pages_.begin();
+
+    PageIterator begin() const {
+        return {begin_, container_size_, page_size_};
     }
-    auto end() const {
-        return pages_.end();
+
+    PageIterator end() const {
+        return {end_, 0, page_size_};
     }
+
 private:
-    std::vector<IteratorRange<Iterator>> pages_;
+    Iterator begin_;
+    Iterator end_;
+    size_t page_size_ = 0;
+    size_t container_size_ = 0;
 };
 
 template <typename Container>
@@ -0,0 +1,102 @@
+#include "posting_intersection.h"
+
+#include <algorithm>
+#include <bitset>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace postings {
+
+namespace {
+
+//Окно, которое дешевле просмотреть целиком, чем делить пополам
+constexpr size_t LINEAR_WINDOW = 16;
+
+//Позиция первого элемента не меньше target в отсортированном data[begin, end)
+size_t ScanWindow(const int* data, size_t begin, const size_t end, const int target) {
+#if defined(__SSE2__)
+    const __m128i key = _mm_set1_epi32(target);
+    for (; begin + 4 <= end; begin += 4) {
+        const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + begin));
+        const int less = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(values, key)));
+        //Элементы отсортированы, поэтому меньшие target занимают младшие дорожки
+        if (less != 0xF) {
+            return begin + std::bitset<4>(less).count();
+        }
+    }
+#endif
+    while (begin < end && data[begin] < target) {
+        ++begin;
+    }
+    return begin;
+}
+
+}
+
+size_t Gallop(const int* data, const size_t begin, const size_t size, const int target) {
+    if (begin >= size || data[begin] >= target) {
+        return begin;
+    }
+    //Инвариант: data[low] < target, а data[high] >= target или high == size
+    size_t low = begin;
+    size_t step = 1;
+    size_t high = begin + 1;
+    while (high < size && data[high] < target) {
+        low = high;
+        step *= 2;
+        high = low + step;
+    }
+    high = std::min(high, size);
+    while (high - low > LINEAR_WINDOW) {
+        const size_t middle = low + (high - low) / 2;
+        if (data[middle] < target) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return ScanWindow(data, low + 1, high, target);
+}
+
+void Intersect(std::vector<SortedList> lists, const int min_id, const int max_id, std::vector<int>& out) {
+    out.clear();
+    if (lists.empty() || min_id > max_id) {
+        return;
+    }
+    std::sort(lists.begin(), lists.end(), [](const SortedList& lhs, const SortedList& rhs) {
+        return lhs.size < rhs.size;
+    });
+
+    std::vector<size_t> positions(lists.size(), 0);
+    int candidate = min_id;
+    while (true) {
+        size_t& first = positions[0];
+        first = Gallop(lists[0].data, first, lists[0].size, candidate);
+        if (first == lists[0].size || lists[0].data[first] > max_id) {
+            return;
+        }
+        candidate = lists[0].data[first];
+
+        size_t list = 1;
+        for (; list < lists.size(); ++list) {
+            size_t& position = positions[list];
+            position = Gallop(lists[list].data, position, lists[list].size, candidate);
+            if (position == lists[list].size) {
+                return;
+            }
+            //Документа нет в этом списке: кандидатом становится следующий документ списка
+            if (lists[list].data[position] != candidate) {
+                candidate = lists[list].data[position];
+                break;
+            }
+        }
+        if (list == lists.size()) {
+            out.push_back(candidate);
+            ++first;
+        }
+    }
+}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * Пересечение отсортированных постингов для конъюнктивных запросов.
+ * Списки обходятся от самого короткого: его документ - кандидат, в остальных списках
+ * галопом (шаги 1, 2, 4, ...) ищется первый документ не меньше кандидата. Если он больше,
+ * кандидатом становится он, и короткий список догоняет его тем же галопом. Так стоимость
+ * зависит от длины самого короткого списка и логарифма длин остальных, а не от их суммы.
+ */
+namespace postings {
+
+struct SortedList {
+    const int* data = nullptr;
+    size_t size = 0;
+};
+
+/*
+ * Позиция первого элемента не меньше target в отсортированном data[0, size), поиск начинается с begin.
+ * Последние шаги бинарного поиска по окну до 16 элементов в зависимости от флагов сборки
+ * идут сравнением SSE2 или скалярным циклом.
+ */
+size_t Gallop(const int* data, size_t begin, size_t size, int target);
+
+/*
+ * Документы из [min_id, max_id], которые есть во всех lists. Списки отсортированы и без повторов,
+ * их порядок не важен. Результат по возрастанию записывается в out.
+ */
+void Intersect(std::vector<SortedList> lists, int min_id, int max_id, std::vector<int>& out);
+
+}
@@ -1,11 +1,12 @@
 #include "process_queries.h"
+#include "trace.h"
 #include <algorithm>
 #include <string>
 #include <execution>
 
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
                                                   const std::vector<std::string>& queries) {
-
+    TRACE_SPAN("ProcessQueries");
     std::vector<std::vector<Document>> result(queries.size());
     std::transform(
             std::execution::par,
@@ -19,6 +20,13 @@ std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_ser
 
 }
 
+std::vector<std::vector<Document>> ProcessQueriesBatched(const SearchServer& search_server,
+                                                         const std::vector<std::string>& queries) {
+    TRACE_SPAN("ProcessQueriesBatched");
+    return search_server.FindTopDocumentsBatch(std::execution::par, queries,
+                                               DocumentFilter::ByStatus(DocumentStatus::ACTUAL));
+}
+
 std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server,
                                            const std::vector<std::string>& queries) {
     auto processed = ProcessQueries(search_server, queries);
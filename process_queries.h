@@ -8,3 +8,10 @@ std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_ser
 
 std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server,
                                            const std::vector<std::string>& queries);
+
+/*
+ * То же, что ProcessQueries, но пакетом с общим обходом постингов популярных слов.
+ * Выгоднее ProcessQueries, когда запросы пакета часто содержат одни и те же слова.
+ */
+std::vector<std::vector<Document>> ProcessQueriesBatched(const SearchServer& search_server,
+                                                         const std::vector<std::string>& queries);
@@ -0,0 +1,457 @@
+#include "query_server.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <charconv>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "corpus_loader.h"
+
+using namespace std;
+
+namespace {
+
+const size_t READ_BUFFER_SIZE = 64 * 1024;
+
+string_view GetStatusName(DocumentStatus status) {
+    static const string_view names[] = {"ACTUAL"sv, "IRRELEVANT"sv, "BANNED"sv, "REMOVED"sv};
+    return names[static_cast<int>(status)];
+}
+
+bool ParseDocumentId(string_view text, int& document_id) {
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), document_id);
+    return error == errc() && end == text.data() + text.size();
+}
+
+//Отрезает от line команду до табуляции
+string_view TakeCommand(string_view& line) {
+    const size_t tab = line.find('\t');
+    const string_view command = line.substr(0, tab);
+    line.remove_prefix(tab == line.npos ? line.size() : tab + 1);
+    return command;
+}
+
+template <typename Number>
+void AppendNumber(string& output, Number value) {
+    char buffer[32];
+    const auto [end, _] = to_chars(begin(buffer), std::end(buffer), value);
+    output.append(buffer, end);
+}
+
+void AppendDocuments(string& output, const vector<Document>& documents) {
+    output += "OK"sv;
+    for (const Document& document : documents) {
+        output += '\t';
+        AppendNumber(output, document.id);
+        output += ' ';
+        AppendNumber(output, document.relevance);
+        output += ' ';
+        AppendNumber(output, document.rating);
+    }
+    output += '\n';
+}
+
+void AppendError(string& output, string_view message) {
+    output += "ERROR\t"sv;
+    output += message;
+    output += '\n';
+}
+
+}
+
+QueryServer::QueryServer(SearchServer& search_server, Options options)
+    : search_server_(search_server), options_(options) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw runtime_error("Can't create listening socket"s);
+    }
+    const int enable = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(options_.port);
+    socklen_t address_size = sizeof(address);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listen_fd_, SOMAXCONN) != 0
+        || getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &address_size) != 0) {
+        close(listen_fd_);
+        throw runtime_error("Can't listen on port "s + to_string(options_.port));
+    }
+    port_ = ntohs(address.sin_port);
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event listener_event{EPOLLIN, {.u64 = LISTENER_ID}};
+    epoll_event wakeup_event{EPOLLIN, {.u64 = WAKEUP_ID}};
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &listener_event);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &wakeup_event);
+
+    for (size_t i = 0; i < max<size_t>(1, options_.worker_count); ++i) {
+        workers_.emplace_back([this]() {
+            RunWorker();
+        });
+    }
+}
+
+QueryServer::~QueryServer() {
+    {
+        lock_guard guard(batches_mutex_);
+        stopping_workers_ = true;
+    }
+    batches_cv_.notify_all();
+    for (thread& worker : workers_) {
+        worker.join();
+    }
+    for (const auto& [_, connection] : connections_) {
+        close(connection.fd);
+    }
+    close(wakeup_fd_);
+    close(epoll_fd_);
+    close(listen_fd_);
+}
+
+void QueryServer::Run() {
+    epoll_event events[64];
+    while (true) {
+        const int event_count = epoll_wait(epoll_fd_, events, size(events), -1);
+        if (event_count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw runtime_error("epoll_wait failed"s);
+        }
+        for (int i = 0; i < event_count; ++i) {
+            const uint64_t id = events[i].data.u64;
+            if (id == LISTENER_ID) {
+                AcceptConnections();
+                continue;
+            }
+            if (id == WAKEUP_ID) {
+                uint64_t counter;
+                [[maybe_unused]] const ssize_t read_size = read(wakeup_fd_, &counter, sizeof(counter));
+                ProcessCompletions();
+                lock_guard guard(completions_mutex_);
+                if (stop_requested_) {
+                    return;
+                }
+                continue;
+            }
+            const auto it = connections_.find(id);
+            if (it == connections_.end()) {
+                continue;
+            }
+            Connection& connection = it->second;
+            if ((events[i].events & (EPOLLHUP | EPOLLERR)) != 0) {
+                //Соединение разорвано в обе стороны: ответы пачки в работе будут отброшены
+                connection.broken = true;
+            } else {
+                if ((events[i].events & EPOLLOUT) != 0) {
+                    WriteToConnection(id, connection);
+                }
+                if ((events[i].events & (EPOLLIN | EPOLLRDHUP)) != 0) {
+                    ReadFromConnection(id, connection);
+                }
+            }
+            CloseIfDone(id, connection);
+        }
+    }
+}
+
+void QueryServer::Stop() {
+    {
+        lock_guard guard(completions_mutex_);
+        stop_requested_ = true;
+    }
+    Wake();
+}
+
+void QueryServer::Wake() {
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t written = write(wakeup_fd_, &one, sizeof(one));
+}
+
+void QueryServer::AcceptConnections() {
+    while (true) {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        const uint64_t id = next_connection_id_++;
+        Connection& connection = connections_[id];
+        connection.fd = fd;
+        connection.events = EPOLLIN | EPOLLRDHUP;
+        epoll_event event{connection.events, {.u64 = id}};
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+void QueryServer::ReadFromConnection(const uint64_t connection_id, Connection& connection) {
+    char buffer[READ_BUFFER_SIZE];
+    while (true) {
+        const ssize_t read_size = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (read_size > 0) {
+            if (AppendInput(connection, {buffer, static_cast<size_t>(read_size)})) {
+                continue;
+            }
+            //Дальше соединение не читается, как после закрытия клиентом
+            connection.line_too_long = true;
+            connection.peer_closed = true;
+            break;
+        }
+        if (read_size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read_size == 0) {
+            //Клиент закончил передачу: запросы, пришедшие до этого, выполняются и получают ответы
+            connection.peer_closed = true;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            connection.broken = true;
+        }
+        break;
+    }
+    DispatchRequests(connection_id, connection);
+    UpdateEvents(connection_id, connection);
+}
+
+bool QueryServer::AppendInput(Connection& connection, const string_view data) {
+    string& input = connection.input;
+    size_t line_start = input.size() - connection.partial_line_length;
+    input += data;
+    for (size_t position = input.size() - data.size();;) {
+        const size_t end = input.find('\n', position);
+        if ((end == string::npos ? input.size() : end) - line_start > options_.max_line_length) {
+            input.erase(line_start);
+            connection.partial_line_length = 0;
+            return false;
+        }
+        if (end == string::npos) {
+            break;
+        }
+        line_start = position = end + 1;
+    }
+    connection.partial_line_length = input.size() - line_start;
+    return true;
+}
+
+void QueryServer::UpdateEvents(const uint64_t connection_id, Connection& connection) {
+    if (connection.broken) {
+        return;
+    }
+    const uint32_t read_events = connection.peer_closed ? 0u : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP);
+    const uint32_t write_events = connection.output.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT);
+    const uint32_t events = read_events | write_events;
+    if (events != connection.events) {
+        connection.events = events;
+        epoll_event event{events, {.u64 = connection_id}};
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event);
+    }
+}
+
+void QueryServer::WriteToConnection(const uint64_t connection_id, Connection& connection) {
+    size_t written = 0;
+    while (written < connection.output.size()) {
+        const ssize_t result = send(connection.fd, connection.output.data() + written,
+                                    connection.output.size() - written, MSG_NOSIGNAL);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                connection.broken = true;
+            }
+            break;
+        }
+        written += result;
+    }
+    connection.output.erase(0, written);
+    UpdateEvents(connection_id, connection);
+}
+
+void QueryServer::DispatchRequests(const uint64_t connection_id, Connection& connection) {
+    if (connection.busy) {
+        return;
+    }
+    Batch batch{connection_id, {}};
+    size_t position = 0;
+    while (batch.requests.size() < options_.max_batch_size) {
+        const size_t end = connection.input.find('\n', position);
+        if (end == string::npos) {
+            break;
+        }
+        size_t line_end = end;
+        if (line_end > position && connection.input[line_end - 1] == '\r') {
+            --line_end;
+        }
+        batch.requests.emplace_back(connection.input, position, line_end - position);
+        position = end + 1;
+    }
+    if (batch.requests.empty()) {
+        //Все запросы до слишком длинной строки отвечены, теперь ошибка
+        if (connection.line_too_long) {
+            connection.line_too_long = false;
+            AppendError(connection.output, "line is too long"sv);
+            WriteToConnection(connection_id, connection);
+        }
+        return;
+    }
+    connection.input.erase(0, position);
+    connection.busy = true;
+    {
+        lock_guard guard(batches_mutex_);
+        batches_.push_back(move(batch));
+    }
+    batches_cv_.notify_one();
+}
+
+void QueryServer::CloseIfDone(const uint64_t connection_id, Connection& connection) {
+    //Неполная последняя строка закрытого клиентом соединения ответа не получит
+    if (connection.broken || (connection.peer_closed && !connection.busy && connection.output.empty())) {
+        close(connection.fd);
+        connections_.erase(connection_id);
+    }
+}
+
+void QueryServer::ProcessCompletions() {
+    vector<Completion> completions;
+    {
+        lock_guard guard(completions_mutex_);
+        completions.swap(completions_);
+    }
+    for (Completion& completion : completions) {
+        const auto it = connections_.find(completion.connection_id);
+        if (it == connections_.end()) {
+            continue;
+        }
+        Connection& connection = it->second;
+        connection.busy = false;
+        connection.output += completion.output;
+        WriteToConnection(completion.connection_id, connection);
+        DispatchRequests(completion.connection_id, connection);
+        CloseIfDone(completion.connection_id, connection);
+    }
+}
+
+void QueryServer::RunWorker() {
+    while (true) {
+        Batch batch;
+        {
+            unique_lock lock(batches_mutex_);
+            batches_cv_.wait(lock, [this]() {
+                return stopping_workers_ || !batches_.empty();
+            });
+            if (batches_.empty()) {
+                return;
+            }
+            batch = move(batches_.front());
+            batches_.pop_front();
+        }
+        Completion completion{batch.connection_id, ProcessRequests(batch.requests)};
+        {
+            lock_guard guard(completions_mutex_);
+            completions_.push_back(move(completion));
+        }
+        Wake();
+    }
+}
+
+string QueryServer::ProcessRequests(const vector<string>& requests) {
+    string output;
+    vector<string> queries;
+    for (const string& request : requests) {
+        string_view arguments = request;
+        if (TakeCommand(arguments) == "FIND"sv) {
+            queries.emplace_back(arguments);
+            continue;
+        }
+        AppendFindResults(queries, output);
+        queries.clear();
+        output += ProcessRequest(request);
+    }
+    AppendFindResults(queries, output);
+    return output;
+}
+
+void QueryServer::AppendFindResults(const vector<string>& queries, string& output) {
+    if (queries.empty()) {
+        return;
+    }
+    vector<vector<Document>> results;
+    try {
+        shared_lock lock(index_mutex_);
+        results = search_server_.FindTopDocumentsBatch(queries, DocumentFilter::ByStatus(DocumentStatus::ACTUAL));
+    } catch (const invalid_argument&) {
+        //В пачке есть некорректный запрос: выполняем по одному, чтобы ошибку получил только он
+        for (const string& query : queries) {
+            output += ProcessRequest("FIND\t"s + query);
+        }
+        return;
+    }
+    for (const vector<Document>& documents : results) {
+        AppendDocuments(output, documents);
+    }
+}
+
+string QueryServer::ProcessRequest(const string_view request) {
+    string output;
+    string_view arguments = request;
+    const string_view command = TakeCommand(arguments);
+    try {
+        if (command == "FIND"sv) {
+            vector<Document> documents;
+            {
+                shared_lock lock(index_mutex_);
+                documents = search_server_.FindTopDocuments(arguments);
+            }
+            AppendDocuments(output, documents);
+        } else if (command == "MATCH"sv) {
+            int document_id = 0;
+            if (!ParseDocumentId(TakeCommand(arguments), document_id)) {
+                AppendError(output, "invalid document id"sv);
+                return output;
+            }
+            shared_lock lock(index_mutex_);
+            const auto [words, status] = search_server_.MatchDocument(arguments, document_id);
+            output += "OK\t"sv;
+            output += GetStatusName(status);
+            output += '\t';
+            for (size_t i = 0; i < words.size(); ++i) {
+                if (i > 0) {
+                    output += ' ';
+                }
+                output += words[i];
+            }
+            output += '\n';
+        } else if (command == "ADD"sv) {
+            CorpusRecord record;
+            if (string error = ParseCorpusRecord(arguments, record); !error.empty()) {
+                AppendError(output, error);
+                return output;
+            }
+            unique_lock lock(index_mutex_);
+            search_server_.AddDocument(record.document_id, record.text, record.status, record.ratings);
+            output += "OK\n"sv;
+        } else if (command == "REMOVE"sv) {
+            int document_id = 0;
+            if (!ParseDocumentId(arguments, document_id)) {
+                AppendError(output, "invalid document id"sv);
+                return output;
+            }
+            unique_lock lock(index_mutex_);
+            search_server_.RemoveDocument(document_id);
+            output += "OK\n"sv;
+        } else {
+            AppendError(output, "unknown command '"s + string(command) + "'"s);
+        }
+    } catch (const exception& e) {
+        output.clear();
+        AppendError(output, e.what());
+    }
+    return output;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+/*
+ * Сетевой сервер запросов к SearchServer по TCP.
+ *
+ * Протокол строковый: один запрос на строку, поля разделены табуляцией, ответ - одна строка.
+ *     ADD <TAB> id <TAB> status <TAB> ratings <TAB> text   -> OK
+ *     REMOVE <TAB> id                                     -> OK
+ *     FIND <TAB> query                                    -> OK {<TAB> id relevance rating}
+ *     MATCH <TAB> id <TAB> query                          -> OK <TAB> status <TAB> words через пробел
+ * Запись ADD имеет формат корпуса, см. corpus_loader.h. Ошибка: ERROR <TAB> сообщение.
+ * Строка длиннее Options::max_line_length не выполняется: после ответов на предыдущие
+ * запросы клиент получает ошибку, и соединение закрывается.
+ *
+ * Клиент может посылать запросы конвейером, не дожидаясь ответов: ответы приходят в порядке
+ * запросов. Сеть обслуживает один поток с epoll, запросы выполняет пул рабочих потоков.
+ * Накопившиеся запросы соединения уходят в пул одной пачкой, а подряд идущие FIND
+ * пачки выполняются через FindTopDocumentsBatch с общим обходом постингов.
+ */
+class QueryServer {
+public:
+    struct Options {
+        //0 - любой свободный порт, см. GetPort
+        uint16_t port = 0;
+        size_t worker_count = std::thread::hardware_concurrency();
+        //Наибольшее число запросов соединения в одной пачке
+        size_t max_batch_size = 256;
+        //Наибольшая длина строки запроса без перевода строки, ограничивает буфер соединения
+        size_t max_line_length = 1 << 20;
+    };
+
+    /*
+     * Открывает слушающий сокет на 127.0.0.1 и запускает рабочие потоки.
+     * Бросает runtime_error, если сокет открыть не удалось.
+     */
+    QueryServer(SearchServer& search_server, Options options);
+    explicit QueryServer(SearchServer& search_server) : QueryServer(search_server, Options{}) {}
+
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    uint16_t GetPort() const {
+        return port_;
+    }
+
+    /*
+     * Цикл обработки событий в вызывающем потоке. Возвращается после Stop.
+     */
+    void Run();
+
+    //Можно вызывать из любого потока
+    void Stop();
+
+    /*
+     * Выполняет пачку запросов по порядку и возвращает ответы, по строке с \n на запрос.
+     */
+    std::string ProcessRequests(const std::vector<std::string>& requests);
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::string input;
+        //Длина незавершённой последней строки input
+        size_t partial_line_length = 0;
+        std::string output;
+        //Пачка запросов соединения выполняется в пуле
+        bool busy = false;
+        //Клиент больше ничего не пришлёт, но ещё ждёт ответы
+        bool peer_closed = false;
+        //Клиент прислал слишком длинную строку, и ошибка ещё не добавлена в output
+        bool line_too_long = false;
+        //Соединение разорвано, ответы отправлять некуда
+        bool broken = false;
+        //События, на которые соединение подписано в epoll
+        uint32_t events = 0;
+    };
+
+    struct Batch {
+        uint64_t connection_id = 0;
+        std::vector<std::string> requests;
+    };
+
+    struct Completion {
+        uint64_t connection_id = 0;
+        std::string output;
+    };
+
+    static constexpr uint64_t LISTENER_ID = 0;
+    static constexpr uint64_t WAKEUP_ID = 1;
+
+    SearchServer& search_server_;
+    //Поиск идёт под общей блокировкой, изменения индекса - под исключительной
+    std::shared_mutex index_mutex_;
+    const Options options_;
+
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wakeup_fd_ = -1;
+    uint16_t port_ = 0;
+
+    std::map<uint64_t, Connection> connections_;
+    uint64_t next_connection_id_ = WAKEUP_ID + 1;
+
+    std::mutex batches_mutex_;
+    std::condition_variable batches_cv_;
+    std::deque<Batch> batches_;
+    bool stopping_workers_ = false;
+    std::vector<std::thread> workers_;
+
+    std::mutex completions_mutex_;
+    std::vector<Completion> completions_;
+    bool stop_requested_ = false;
+
+    void Wake();
+
+    void AcceptConnections();
+
+    void ReadFromConnection(uint64_t connection_id, Connection& connection);
+
+    //Дописывает прочитанное в input; на строке длиннее max_line_length отбрасывает её и возвращает false
+    bool AppendInput(Connection& connection, std::string_view data);
+
+    void WriteToConnection(uint64_t connection_id, Connection& connection);
+
+    //Подписывает соединение на чтение, пока клиент пишет, и на запись, пока есть неотправленные ответы
+    void UpdateEvents(uint64_t connection_id, Connection& connection);
+
+    //Отправляет в пул накопившиеся целые строки, если у соединения нет пачки в работе
+    void DispatchRequests(uint64_t connection_id, Connection& connection);
+
+    //Закрывает соединение, если оно разорвано или клиент ушёл и отвечать больше нечего
+    void CloseIfDone(uint64_t connection_id, Connection& connection);
+
+    void ProcessCompletions();
+
+    void RunWorker();
+
+    std::string ProcessRequest(std::string_view request);
+
+    void AppendFindResults(const std::vector<std::string>& queries, std::string& output);
+};
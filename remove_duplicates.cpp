@@ -1,8 +1,9 @@
 #include "remove_duplicates.h"
+#include "trace.h"
 
 using namespace std;
 
-set<string_view> MakeWordsSet(const map<string_view, double>& word_to_freq) {
+set<string_view> MakeWordsSet(const SearchServer::WordFrequencies& word_to_freq) {
     set<string_view> words;
     for (const auto& [word, _] : word_to_freq) {
         words.insert(word);
@@ -11,6 +12,7 @@ set<string_view> MakeWordsSet(const map<string_view, double>& word_to_freq) {
 }
 
 void RemoveDuplicates(SearchServer& search_server) {
+    TRACE_SPAN("RemoveDuplicates");
     auto begin = search_server.begin();
     auto end = search_server.end();
     set<int> documents_to_remove;
@@ -20,7 +22,7 @@ void RemoveDuplicates(SearchServer& search_server) {
         if (documents_to_remove.count(document_id) > 0) {
             continue;
         }
-        const map<string_view, double>& word_to_freq = search_server.GetWordFrequencies(document_id);
+        const SearchServer::WordFrequencies& word_to_freq = search_server.GetWordFrequencies(document_id);
         set<string_view> words = MakeWordsSet(word_to_freq);
         if (existing_sets.count(words) > 0) {
             documents_to_remove.insert(document_id);
@@ -32,4 +34,5 @@ void RemoveDuplicates(SearchServer& search_server) {
         search_server.RemoveDocument(id);
         cout << "Found duplicate document id "s << id << endl;
     }
+    search_server.Compact();
 }
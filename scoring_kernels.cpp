@@ -0,0 +1,52 @@
+#include "scoring_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace scoring {
+
+uint16_t QuantizeTermFrequency(const double term_freq) {
+    const long level = std::lround(term_freq * TERM_FREQ_LEVELS);
+    return static_cast<uint16_t>(std::clamp(level, 1L, static_cast<long>(TERM_FREQ_LEVELS)));
+}
+
+void ScaleTermFrequencies(const uint16_t* term_freqs, const size_t count, const float factor, float* out) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 scale = _mm256_set1_ps(factor);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(term_freqs + i));
+        const __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(packed));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(values, scale));
+    }
+#elif defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(factor);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(term_freqs + i));
+        const __m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, zero));
+        const __m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(packed, zero));
+        _mm_storeu_ps(out + i, _mm_mul_ps(low, scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(high, scale));
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = term_freqs[i] * factor;
+    }
+}
+
+const char* GetKernelName() {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+}
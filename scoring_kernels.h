@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Ядра компактного подсчёта релевантности.
+ * TF хранится рядом с постингами как uint16_t: значение q означает TF = q / TERM_FREQ_LEVELS.
+ * Ошибка квантования одного TF не больше 1 / TERM_FREQ_LEVELS, поэтому вклад слова
+ * отклоняется от точного не больше чем на IDF / TERM_FREQ_LEVELS.
+ */
+namespace scoring {
+
+constexpr uint32_t TERM_FREQ_LEVELS = 65535;
+
+/*
+ * Квантует TF из (0, 1]. Ненулевой TF никогда не превращается в 0.
+ */
+uint16_t QuantizeTermFrequency(double term_freq);
+
+/*
+ * out[i] = term_freqs[i] * factor для i < count.
+ * В зависимости от флагов сборки использует AVX2, SSE2 или скалярный цикл.
+ */
+void ScaleTermFrequencies(const uint16_t* term_freqs, size_t count, float factor, float* out);
+
+//Имя ядра, выбранного при сборке, для вывода в бенчмарках
+const char* GetKernelName();
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+
+/*
+ * Флаг отмены, общий для всех копий токена.
+ */
+class CancellationToken {
+public:
+    CancellationToken() : cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void Cancel() const {
+        cancelled_->store(true, std::memory_order_relaxed);
+    }
+
+    bool IsCancelled() const {
+        return cancelled_->load(std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+/*
+ * Ограничение на время поиска: крайний срок и токен отмены.
+ * Поиск проверяет бюджет раз в CHECK_INTERVAL постингов и, исчерпав его, возвращает
+ * лучшие документы из уже посчитанных. Копии бюджета разделяют отметку об исчерпании,
+ * поэтому один бюджет можно отдать нескольким запросам с общим сроком.
+ */
+class SearchBudget {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t CHECK_INTERVAL = 1024;
+
+    //Бюджет без ограничений
+    SearchBudget() = default;
+
+    explicit SearchBudget(Clock::time_point deadline, CancellationToken token = {})
+        : deadline_(deadline), token_(std::move(token)) {}
+
+    explicit SearchBudget(CancellationToken token) : token_(std::move(token)) {}
+
+    static SearchBudget WithTimeout(Clock::duration timeout, CancellationToken token = {}) {
+        return SearchBudget(Clock::now() + timeout, std::move(token));
+    }
+
+    /*
+     * Проверяет токен и часы. Первая неудачная проверка запоминается.
+     */
+    bool IsExhausted() const {
+        if (exhausted_->load(std::memory_order_relaxed)) {
+            return true;
+        }
+        if ((token_ && token_->IsCancelled()) || (deadline_ && Clock::now() >= *deadline_)) {
+            exhausted_->store(true, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    //Прерывался ли поиск с этим бюджетом, без обращения к часам
+    bool WasExhausted() const {
+        return exhausted_->load(std::memory_order_relaxed);
+    }
+
+private:
+    std::optional<Clock::time_point> deadline_;
+    std::optional<CancellationToken> token_;
+    std::shared_ptr<std::atomic<bool>> exhausted_ = std::make_shared<std::atomic<bool>>(false);
+};
@@ -0,0 +1,47 @@
+#include "search_executor.h"
+
+#include <algorithm>
+
+using namespace std;
+
+SearchExecutor::SearchExecutor(const size_t thread_count) {
+    for (size_t i = 0; i < max<size_t>(1, thread_count); ++i) {
+        threads_.emplace_back([this]() {
+            RunWorker();
+        });
+    }
+}
+
+SearchExecutor::~SearchExecutor() {
+    {
+        lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    tasks_cv_.notify_all();
+    for (thread& worker : threads_) {
+        worker.join();
+    }
+}
+
+SearchExecutor& SearchExecutor::GetShared() {
+    static SearchExecutor executor(thread::hardware_concurrency());
+    return executor;
+}
+
+void SearchExecutor::RunWorker() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock lock(mutex_);
+            tasks_cv_.wait(lock, [this]() {
+                return stopping_ || !tasks_.empty();
+            });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Пул потоков фиксированного размера для асинхронных запросов. Потоки создаются один раз
+ * в конструкторе, поэтому задача платит за очередь, а не за создание потока, и число
+ * одновременно выполняемых задач ограничено размером пула. Задачи выполняются в порядке
+ * поступления; деструктор дожидается всех поставленных задач.
+ */
+class SearchExecutor {
+public:
+    explicit SearchExecutor(size_t thread_count);
+
+    ~SearchExecutor();
+
+    SearchExecutor(const SearchExecutor&) = delete;
+    SearchExecutor& operator=(const SearchExecutor&) = delete;
+
+    /*
+     * Общий пул процесса на std::thread::hardware_concurrency() потоков, создаётся при первом обращении.
+     */
+    static SearchExecutor& GetShared();
+
+    size_t GetThreadCount() const {
+        return threads_.size();
+    }
+
+    /*
+     * Ставит func в очередь и возвращает будущий результат. Исключение func попадает в future.
+     */
+    template <typename Func>
+    std::future<std::invoke_result_t<Func>> Submit(Func func) {
+        using Result = std::invoke_result_t<Func>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(func));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard guard(mutex_);
+            tasks_.push_back([task]() {
+                (*task)();
+            });
+        }
+        tasks_cv_.notify_one();
+        return result;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable tasks_cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    void RunWorker();
+};
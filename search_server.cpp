@@ -1,63 +1,469 @@
 #include "search_server.h"
+#include "memory_usage.h"
+#include <chrono>
 #include <execution>
+#include <limits>
+#include <thread>
 
 using namespace std;
 
 void SearchServer::AddDocument(int document_id, const string_view document, const DocumentStatus status, const vector<int>& ratings) {
+    CheckNewDocumentId(document_id);
+    vector<string_view> words = SplitIntoWordsNoStop(document);
+    for (const string_view word : words) {
+        if (!IsValidWord(word)) {
+            throw invalid_argument("Word in adding document has an invalid entry!"s);
+        }
+    }
+
+    const double inv_word_count = words.empty() ? 0.0 : 1.0 / static_cast<int>(words.size());
+    //Частоты нужны только на время вставки, их узлы берутся из арены
+    QueryArena arena(query_arenas_);
+    WordFrequencies word_freqs(arena.GetResource());
+    for (const string_view word : words) {
+        word_freqs[word] += inv_word_count;
+    }
+    InsertDocument(document_id, word_freqs, {status, ComputeAverageRating(ratings)});
+}
+
+void SearchServer::AddDocumentWithFrequencies(int document_id, const WordFrequencies& word_freqs,
+                                              const DocsParams& params) {
+    CheckNewDocumentId(document_id);
+    for (const auto& [word, _] : word_freqs) {
+        if (!IsValidWord(word)) {
+            throw invalid_argument("Word in adding document has an invalid entry!"s);
+        }
+    }
+    InsertDocument(document_id, word_freqs, params);
+}
+
+void SearchServer::CheckNewDocumentId(int document_id) const {
     if (document_id < 0) {
         throw invalid_argument("Negative document id = "s + to_string(document_id) + "!"s);
     }
     if (document_parameters_.count(document_id) > 0) {
         throw invalid_argument("Document with id = "s + to_string(document_id) + " already exists!"s);
     }
-    vector<string_view> words = SplitIntoWordsNoStop(document);
-    for (const string_view word : words) {
-        if (!IsValidWord(word)) {
-            throw invalid_argument("Word in adding document has an invalid entry!"s);
+}
+
+void SearchServer::InsertDocument(int document_id, const WordFrequencies& word_freqs,
+                                  const DocsParams& params) {
+    impact_index_.reset();
+    //Старые постинги повторно добавляемого документа нужно вычистить до вставки новых
+    if (deleted_.Test(document_id)) {
+        PurgeRemovedDocument(document_id);
+    }
+
+    RegisterDocument(document_id, params);
+    if (word_freqs.empty()) {
+        return;
+    }
+
+    //Добавляем оригиналы слов в словарь terms_
+    WordFrequencies& document_words = id_to_word_freq_[document_id];
+    for (const auto& [word, freq] : word_freqs) {
+        AddPosting(document_id, terms_.Insert(word), freq, document_words);
+    }
+}
+
+void SearchServer::AddDocumentsWithFrequencies(const FrequencyBatch& batch) {
+    for (size_t i = 0; i < batch.words.size(); ++i) {
+        if (!IsValidWord(batch.words[i]) || (i > 0 && batch.words[i - 1] >= batch.words[i])) {
+            throw invalid_argument("Batch words must be valid, sorted and unique!"s);
+        }
+    }
+    set<int> batch_ids;
+    for (const FrequencyBatch::Document& document : batch.documents) {
+        CheckNewDocumentId(document.id);
+        if (!batch_ids.insert(document.id).second) {
+            throw invalid_argument("Document with id = "s + to_string(document.id) + " repeats in batch!"s);
+        }
+        if (document.words_begin > document.words_end || document.words_end > batch.word_freqs.size()) {
+            throw invalid_argument("Words of document with id = "s + to_string(document.id) + " are out of batch!"s);
+        }
+        for (size_t i = document.words_begin; i < document.words_end; ++i) {
+            const uint32_t word = batch.word_freqs[i].first;
+            if (word >= batch.words.size() || (i > document.words_begin && batch.word_freqs[i - 1].first >= word)) {
+                throw invalid_argument("Words of document with id = "s + to_string(document.id)
+                                       + " must be sorted and unique!"s);
+            }
         }
     }
 
-    const double inv_word_count = words.empty() ? 0.0 : 1.0 / static_cast<int>(words.size());
-    //Добавляем оригиналы слов в word_to_documents_
-    for (std::string_view word : words) {
-        auto [it, suc] = word_to_documents_.insert({std::string(word), {}});
-        it->second.insert(document_id);
-        id_to_word_freq_[document_id][it->first] += inv_word_count;
+    impact_index_.reset();
+    //Старые постинги повторно добавляемых документов вычищаются до поиска терминов:
+    //при этом из словаря уходят термины без документов
+    for (const int document_id : batch_ids) {
+        if (deleted_.Test(document_id)) {
+            PurgeRemovedDocument(document_id);
+        }
     }
 
-    DocsParams params = {
-            status,
-            ComputeAverageRating(ratings),
-    };
+    vector<uint32_t> terms(batch.words.size(), TermDictionary::NO_TERM);
+    for (const FrequencyBatch::Document& document : batch.documents) {
+        RegisterDocument(document.id, document.params);
+        if (document.words_begin == document.words_end) {
+            continue;
+        }
+        WordFrequencies& document_words = id_to_word_freq_[document.id];
+        for (size_t i = document.words_begin; i < document.words_end; ++i) {
+            const auto [word, freq] = batch.word_freqs[i];
+            if (terms[word] == TermDictionary::NO_TERM) {
+                terms[word] = terms_.Insert(batch.words[word]);
+            }
+            AddPosting(document.id, terms[word], freq, document_words);
+        }
+    }
+}
+
+void SearchServer::PurgeRemovedDocument(int document_id) {
+    deleted_.Reset(document_id);
+    auto node = removed_word_freq_.extract(document_id);
+    if (node.empty()) {
+        return;
+    }
+    vector<uint32_t> dead_terms;
+    for (const auto& [word, _] : node.mapped()) {
+        const uint32_t term = terms_.Find(word);
+        PostingList& postings = word_to_documents_[term];
+        const auto it = lower_bound(postings.documents.begin(), postings.documents.end(), document_id);
+        postings.term_freqs.erase(postings.term_freqs.begin() + (it - postings.documents.begin()));
+        postings.documents.erase(it);
+        --postings.removed;
+        if (postings.documents.empty()) {
+            postings.documents.shrink_to_fit();
+            postings.term_freqs.shrink_to_fit();
+            dead_terms.push_back(term);
+        }
+    }
+    for (const uint32_t term : dead_terms) {
+        spelling_index_.RemoveTerm(term, terms_.GetTerm(term));
+    }
+    terms_.Erase(dead_terms);
+}
+
+void SearchServer::RegisterDocument(int document_id, const DocsParams& params) {
     document_parameters_.emplace(document_id, params);
+    status_documents_[static_cast<int>(params.status)].Set(document_id);
     ids_.insert(document_id);
 }
 
+void SearchServer::AddPosting(int document_id, uint32_t term, double freq, WordFrequencies& document_words) {
+    if (term == word_to_documents_.size()) {
+        word_to_documents_.emplace_back();
+    }
+    PostingList& postings = word_to_documents_[term];
+    //Пустой постинг бывает только у термина, которого до этого документа в словаре не было
+    if (postings.documents.empty()) {
+        spelling_index_.AddTerm(term, terms_.GetTerm(term));
+    }
+    const uint16_t term_freq = scoring::QuantizeTermFrequency(freq);
+    if (postings.documents.empty() || postings.documents.back() < document_id) {
+        postings.documents.push_back(document_id);
+        postings.term_freqs.push_back(term_freq);
+    } else {
+        const auto it = lower_bound(postings.documents.begin(), postings.documents.end(), document_id);
+        postings.term_freqs.insert(postings.term_freqs.begin() + (it - postings.documents.begin()), term_freq);
+        postings.documents.insert(it, document_id);
+    }
+    document_words.emplace_hint(document_words.end(), terms_.GetTerm(term), freq);
+}
+
 vector<Document> SearchServer::FindTopDocuments(const string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(execution::seq,raw_query,
-                            [status](const int doc_id, const DocumentStatus doc_status, const int rating) {
-        return doc_status == status;
+    return FindTopDocuments(execution::seq, raw_query, DocumentFilter::ByStatus(status));
+}
+
+vector<Document> SearchServer::FindTopDocuments(const string_view raw_query, const DocumentFilter& filter) const {
+    return FindTopDocuments(execution::seq, raw_query, filter);
+}
+
+vector<Document> SearchServer::FindTopDocumentsConjunctive(const string_view raw_query, const DocumentFilter& filter) const {
+    return FindTopDocumentsConjunctive(raw_query, filter, AnyDocument());
+}
+
+vector<Document> SearchServer::FindTopDocumentsConjunctive(const string_view raw_query, DocumentStatus status) const {
+    return FindTopDocumentsConjunctive(raw_query, DocumentFilter::ByStatus(status));
+}
+
+SearchResult SearchServer::FindTopDocumentsWithin(const string_view raw_query, const DocumentFilter& filter,
+                                                  const SearchBudget& budget) const {
+    return FindTopDocumentsWithin(execution::seq, raw_query, filter, budget);
+}
+
+future<SearchResult> SearchServer::FindTopDocumentsAsync(const string_view raw_query, const DocumentFilter& filter,
+                                                         const SearchBudget& budget) const {
+    return FindTopDocumentsAsync(SearchExecutor::GetShared(), raw_query, filter, budget);
+}
+
+future<SearchResult> SearchServer::FindTopDocumentsAsync(SearchExecutor& executor, const string_view raw_query,
+                                                         const DocumentFilter& filter, const SearchBudget& budget) const {
+    return executor.Submit([this, query = string(raw_query), filter, budget]() {
+        return FindTopDocumentsWithin(execution::seq, query, filter, budget);
     });
 }
 
+vector<vector<Document>> SearchServer::FindTopDocumentsBatch(const vector<string>& raw_queries,
+                                                           const DocumentFilter& filter) const {
+    return FindTopDocumentsBatch(execution::seq, raw_queries, filter);
+}
+
+SearchPage SearchServer::FindTopDocumentsPage(const string_view raw_query, const PageRequest& request,
+                                              DocumentStatus status) const {
+    return FindTopDocumentsPage(execution::seq, raw_query, request, status);
+}
+
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const string_view raw_query, int document_id) const {
     return MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(AdaptiveExecution, const string_view raw_query,
+                                                                       int document_id) const {
+    const ExecutionDecision decision = planner_.Plan(ExecutionOperation::MATCH, CountWords(raw_query));
+    return decision.parallel ? MatchDocument(execution::par, raw_query, document_id)
+                             : MatchDocument(execution::seq, raw_query, document_id);
+}
+
+MatchedDocuments SearchServer::MatchDocuments(const string_view raw_query, const vector<int>& document_ids) const {
+    return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
 int SearchServer::GetDocumentCount() const {
     return ids_.size();
 }
 
-std::set<int>::iterator SearchServer::begin() {
+void SearchServer::SetScoringMode(const ScoringMode mode) {
+    scoring_mode_ = mode;
+}
+
+ScoringMode SearchServer::GetScoringMode() const {
+    return scoring_mode_;
+}
+
+void SearchServer::BuildImpactIndex() {
+    vector<double> inverse_document_freqs(word_to_documents_.size(), 0.0);
+    for (uint32_t term = 0; term < word_to_documents_.size(); ++term) {
+        const int word_count = word_to_documents_[term].GetDocumentCount();
+        if (word_count > 0) {
+            inverse_document_freqs[term] = log(GetDocumentCount() * 1.0 / static_cast<double>(word_count));
+        }
+    }
+
+    //Прямой индекс содержит только живые документы и точные TF, а обход по возрастанию id
+    //сразу даёт постинги, упорядоченные по id
+    ImpactIndex::TermImpacts term_impacts(word_to_documents_.size());
+    for (const auto& [document_id, word_freqs] : id_to_word_freq_) {
+        for (const auto& [word, term_freq] : word_freqs) {
+            const uint32_t term = terms_.Find(word);
+            term_impacts[term].emplace_back(document_id, term_freq * inverse_document_freqs[term]);
+        }
+    }
+    impact_index_.emplace(term_impacts);
+}
+
+bool SearchServer::HasImpactIndex() const {
+    return impact_index_.has_value();
+}
+
+namespace {
+
+//Лучшее из нескольких измерений: помехи только добавляют времени
+template <typename Func>
+double MeasureNanoseconds(Func func, int repeat_count) {
+    double best = numeric_limits<double>::max();
+    for (int i = 0; i < repeat_count; ++i) {
+        const auto start = chrono::steady_clock::now();
+        func();
+        best = min(best, chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+}
+
+ExecutionCostModel SearchServer::CalibrateExecution() {
+    static constexpr int REPEAT_COUNT = 5;
+    static constexpr size_t CALIBRATION_TERM_COUNT = 8;
+    static constexpr size_t CALIBRATION_WORD_COUNT = 64;
+
+    ExecutionCostModel model = ExecutionCostModel::Default();
+    //Задачи почти пустые, так что замер - чистые накладные расходы параллельного алгоритма
+    vector<atomic<int>> tasks(model.thread_count * 4);
+    model.parallel_overhead_ns = MeasureNanoseconds([&tasks]() {
+        for_each(execution::par, tasks.begin(), tasks.end(), [](atomic<int>& task) {
+            task.fetch_add(1, memory_order_relaxed);
+        });
+    }, REPEAT_COUNT * 4);
+
+    if (!ids_.empty()) {
+        //Самые длинные постинги: на коротких замер тонет в погрешности часов
+        vector<uint32_t> terms(word_to_documents_.size());
+        iota(terms.begin(), terms.end(), 0);
+        const size_t term_count = min(CALIBRATION_TERM_COUNT, terms.size());
+        partial_sort(terms.begin(), terms.begin() + term_count, terms.end(), [this](uint32_t lhs, uint32_t rhs) {
+            return word_to_documents_[lhs].documents.size() > word_to_documents_[rhs].documents.size();
+        });
+        double search_ns = 0.0;
+        size_t search_work = 0;
+        for (size_t i = 0; i < term_count; ++i) {
+            Query query;
+            query.plus_words.insert(terms_.GetTerm(terms[i]));
+            search_ns += MeasureNanoseconds([this, &query]() {
+                FindAllDocuments(execution::seq, query, DocumentFilter(), AnyDocument());
+            }, REPEAT_COUNT);
+            search_work += word_to_documents_[terms[i]].documents.size();
+        }
+        if (search_work > 0) {
+            model.unit_cost_ns[static_cast<int>(ExecutionOperation::SEARCH)] = search_ns / search_work;
+        }
+    }
+
+    //Документы из одних стоп-слов есть в ids_, но не в прямом индексе
+    if (!id_to_word_freq_.empty()) {
+        //Запрос из слов самого длинного документа: каждое слово находится, как в худшем случае
+        const auto longest = max_element(id_to_word_freq_.begin(), id_to_word_freq_.end(),
+                                         [](const auto& lhs, const auto& rhs) {
+            return lhs.second.size() < rhs.second.size();
+        });
+        string query;
+        size_t word_count = 0;
+        for (const auto& [word, _] : longest->second) {
+            if (word_count == CALIBRATION_WORD_COUNT) {
+                break;
+            }
+            ++word_count;
+            query += " "s + string(word);
+        }
+        const int document_id = longest->first;
+        model.unit_cost_ns[static_cast<int>(ExecutionOperation::MATCH)] = MeasureNanoseconds([&]() {
+            MatchDocument(execution::seq, query, document_id);
+        }, REPEAT_COUNT) / word_count;
+    }
+
+    planner_.SetCostModel(model);
+    return model;
+}
+
+void SearchServer::SetExecutionCostModel(const ExecutionCostModel& model) {
+    planner_.SetCostModel(model);
+}
+
+const ExecutionCostModel& SearchServer::GetExecutionCostModel() const {
+    return planner_.GetCostModel();
+}
+
+ExecutionMetrics SearchServer::GetExecutionMetrics() const {
+    return planner_.GetMetrics();
+}
+
+void SearchServer::ResetExecutionMetrics() {
+    planner_.ResetMetrics();
+}
+
+vector<WordSuggestion> SearchServer::SuggestCorrections(const string_view word, const size_t count) const {
+    vector<WordSuggestion> suggestions;
+    for (const auto& [term, distance] : spelling_index_.FindCandidates(word, terms_)) {
+        //Термин, все документы которого удалены, но ещё не вычищены Compact, не предлагаем
+        const int document_count = word_to_documents_[term].GetDocumentCount();
+        if (document_count > 0) {
+            suggestions.push_back({terms_.GetTerm(term), distance, document_count});
+        }
+    }
+    const auto is_better = [](const WordSuggestion& lhs, const WordSuggestion& rhs) {
+        return tie(lhs.distance, rhs.document_count, lhs.word) < tie(rhs.distance, lhs.document_count, rhs.word);
+    };
+    const size_t result_count = min(count, suggestions.size());
+    partial_sort(suggestions.begin(), suggestions.begin() + result_count, suggestions.end(), is_better);
+    suggestions.resize(result_count);
+    return suggestions;
+}
+
+optional<string> SearchServer::SuggestQuery(const string_view raw_query) const {
+    string corrected;
+    bool changed = false;
+    for (const string_view word : SplitIntoWords(raw_query)) {
+        if (!corrected.empty()) {
+            corrected.push_back(' ');
+        }
+        const uint32_t term = terms_.Find(word);
+        const bool keep = word.empty() || word[0] == '-' || word.back() == '*' || !IsValidWord(word)
+                          || stop_words_.count(word) > 0
+                          || (term != TermDictionary::NO_TERM && word_to_documents_[term].GetDocumentCount() > 0);
+        const vector<WordSuggestion> suggestions = keep ? vector<WordSuggestion>() : SuggestCorrections(word, 1);
+        if (suggestions.empty()) {
+            corrected += word;
+        } else {
+            corrected += suggestions.front().word;
+            changed = true;
+        }
+    }
+    if (!changed) {
+        return nullopt;
+    }
+    return corrected;
+}
+
+optional<SearchServer::DocsParams> SearchServer::GetDocumentParams(int document_id) const {
+    const auto params = document_parameters_.find(document_id);
+    if (params == document_parameters_.end()) {
+        return nullopt;
+    }
+    return params->second;
+}
+
+const set<string, less<>>& SearchServer::GetStopWords() const {
+    return stop_words_;
+}
+
+IndexMemoryStats SearchServer::GetMemoryStats() const {
+    using memory_usage::HeapBytes;
+    IndexMemoryStats stats;
+    stats.term_dictionary = terms_.GetMemoryUsage();
+
+    stats.postings = HeapBytes(word_to_documents_);
+    for (const PostingList& postings : word_to_documents_) {
+        stats.postings += HeapBytes(postings.documents);
+        stats.term_frequencies += HeapBytes(postings.term_freqs);
+        stats.posting_count += postings.documents.size();
+    }
+
+    stats.forward_index = HeapBytes(id_to_word_freq_) + HeapBytes(removed_word_freq_);
+    for (const auto& [_, word_to_freq] : id_to_word_freq_) {
+        stats.forward_index += HeapBytes(word_to_freq);
+    }
+    for (const auto& [_, word_to_freq] : removed_word_freq_) {
+        stats.forward_index += HeapBytes(word_to_freq);
+    }
+
+    stats.document_attributes = HeapBytes(document_parameters_);
+    for (const DocumentBitmap& documents : status_documents_) {
+        stats.document_attributes += documents.GetMemoryUsage();
+    }
+    stats.stop_words = HeapBytes(stop_words_);
+    stats.document_ids = HeapBytes(ids_);
+    stats.tombstones = deleted_.GetMemoryUsage();
+    stats.impact_index = impact_index_ ? impact_index_->GetMemoryUsage() : 0;
+    stats.spelling_index = spelling_index_.GetMemoryUsage();
+    return stats;
+}
+
+pmr::set<int>::iterator SearchServer::begin() {
     return ids_.begin();
 }
 
-std::set<int>::iterator SearchServer::end() {
+pmr::set<int>::iterator SearchServer::end() {
     return ids_.end();
 }
 
-const map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static map <std::string_view, double> empty_map;
+pmr::set<int>::const_iterator SearchServer::begin() const {
+    return ids_.begin();
+}
+
+pmr::set<int>::const_iterator SearchServer::end() const {
+    return ids_.end();
+}
+
+const SearchServer::WordFrequencies& SearchServer::GetWordFrequencies(int document_id) const {
+    static const WordFrequencies empty_map;
     return id_to_word_freq_.count(document_id) > 0 ? id_to_word_freq_.at(document_id) : empty_map;
 }
 
@@ -65,6 +471,36 @@ void SearchServer::RemoveDocument(int document_id) {
     RemoveDocument(std::execution::seq, document_id);
 }
 
+void SearchServer::RemoveDocument(AdaptiveExecution, int document_id) {
+    if (ids_.count(document_id) == 0) {
+        return;
+    }
+    //У документа из одних стоп-слов нет записи в прямом индексе, но удалять его всё равно нужно
+    const auto it = id_to_word_freq_.find(document_id);
+    const size_t word_count = it == id_to_word_freq_.end() ? 0 : it->second.size();
+    if (planner_.Plan(ExecutionOperation::REMOVE, word_count).parallel) {
+        RemoveDocument(execution::par, document_id);
+    } else {
+        RemoveDocument(execution::seq, document_id);
+    }
+}
+
+void SearchServer::Compact() {
+    Compact(std::execution::seq);
+}
+
+void SearchServer::ShrinkTermStorage() {
+    //Старые блоки живы до конца функции, пока ключи прямого индекса ссылаются на них
+    const auto old_blocks = terms_.ShrinkStorage();
+    for (auto& [_, word_to_freq] : id_to_word_freq_) {
+        WordFrequencies moved(word_to_freq.get_allocator());
+        for (const auto& [word, freq] : word_to_freq) {
+            moved.emplace_hint(moved.end(), terms_.GetTerm(terms_.Find(word)), freq);
+        }
+        word_to_freq = move(moved);
+    }
+}
+
 bool SearchServer::IsWordInDocument(const string_view word, const int document_id) const {
     if (id_to_word_freq_.count(document_id) == 0 || id_to_word_freq_.at(document_id).count(word) == 0) {
         return false;
@@ -91,6 +527,16 @@ bool SearchServer::IsDoubleEqual(const double first, const double second) {
     return abs(first - second) < EPSILON;
 }
 
+bool SearchServer::IsDocumentBefore(const Document& lhs, const Document& rhs) {
+    if (!IsDoubleEqual(lhs.relevance, rhs.relevance)) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
 int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     if (ratings.empty()) {
         return 0;
@@ -108,31 +554,115 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string_view word) const {
         is_minus = true;
         word = word.substr(1);
     }
+    bool is_prefix = false;
+    if (word.size() > 1 && word.back() == '*') {
+        is_prefix = true;
+        word.remove_suffix(1);
+    }
     return {
         word,
         is_minus,
-        IsStopWord(word)
+        !is_prefix && IsStopWord(word),
+        is_prefix
     };
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const {
-    return ParseQuery(std::execution::seq, text);
+SearchServer::Query SearchServer::ParseQuery(const std::string_view text, pmr::memory_resource* resource) const {
+    return ParseQuery(std::execution::seq, text, resource);
+}
+
+size_t SearchServer::ComputeDocumentRangeCount(const Query& query) const {
+    //Меньше постингов на диапазон не окупает запуск задачи
+    static constexpr size_t MIN_POSTINGS_PER_RANGE = 16384;
+    if (ids_.empty()) {
+        return 1;
+    }
+    size_t posting_count = 0;
+    for (const string_view word : query.plus_words) {
+        posting_count += DocumentsWithWord(word).size();
+    }
+    const size_t max_range_count = max(1u, thread::hardware_concurrency()) * 4;
+    return clamp<size_t>(posting_count / MIN_POSTINGS_PER_RANGE, 1, max_range_count);
+}
+
+bool SearchServer::HasDenseDocumentIds() const {
+    return ids_.empty() || static_cast<size_t>(*ids_.rbegin()) < 4 * ids_.size() + 1024;
+}
+
+bool SearchServer::IsCompactScoring() const {
+    return scoring_mode_ == ScoringMode::COMPACT && HasDenseDocumentIds();
 }
 
 double SearchServer::ComputeWordInverseDocumentFreq(const string_view word) const {
-    int word_count = DocumentsWithWord(word).size();
+    const uint32_t term = terms_.Find(word);
+    const int word_count = term == TermDictionary::NO_TERM ? 0 : word_to_documents_[term].GetDocumentCount();
     if (word_count > 0) {
         return log(GetDocumentCount() * 1.0 / static_cast<double>(word_count));
     }
     return 0.0;
 }
 
-const set<int>& SearchServer::DocumentsWithWord(const string_view word) const {
-    static set<int> empty;
-    return word_to_documents_.count(word) > 0 ? word_to_documents_.find(word)->second : empty;
+bool SearchServer::IsDocumentInFilter(const int document_id, const DocumentFilter& filter) const {
+    if (document_id < filter.min_id || document_id > filter.max_id || deleted_.Test(document_id)) {
+        return false;
+    }
+    if (!filter.HasAllStatuses() && !filter.HasStatus(document_parameters_.at(document_id).status)) {
+        return false;
+    }
+    return !filter.HasRatingRange() || IsRatingInRange(document_id, filter);
+}
+
+bool SearchServer::CollectRequiredPostings(const string_view raw_query, vector<vector<int>>& prefix_documents,
+                                           vector<postings::SortedList>& lists) const {
+    const vector<string_view> words = SplitIntoWords(raw_query);
+    //Списки ссылаются на объединения, поэтому prefix_documents не должен перераспределяться
+    prefix_documents.reserve(words.size());
+    for (const string_view word : words) {
+        const QueryWord query_word = ParseQueryWord(word);
+        if (query_word.is_minus || query_word.is_stop) {
+            continue;
+        }
+        if (!query_word.is_prefix) {
+            const vector<int>& documents = DocumentsWithWord(query_word.word);
+            lists.push_back({documents.data(), documents.size()});
+        } else {
+            vector<int>& documents = prefix_documents.emplace_back();
+            vector<int> merged;
+            ForEachLiveTermWithPrefix(query_word.word, [&](const uint32_t term) {
+                const vector<int>& term_documents = word_to_documents_[term].documents;
+                merged.clear();
+                set_union(documents.begin(), documents.end(), term_documents.begin(), term_documents.end(),
+                          back_inserter(merged));
+                documents.swap(merged);
+            });
+            lists.push_back({documents.data(), documents.size()});
+        }
+        if (lists.back().size == 0) {
+            return false;
+        }
+    }
+    return !lists.empty();
+}
+
+tracing::QueryCounters SearchServer::CountQueryWork(const Query& query, const size_t candidate_count,
+                                                   const size_t result_count) const {
+    tracing::QueryCounters counters;
+    for (const string_view word : query.plus_words) {
+        counters.postings += DocumentsWithWord(word).size();
+    }
+    counters.minus_words = query.minus_words.size();
+    counters.candidates = candidate_count;
+    counters.results = result_count;
+    return counters;
+}
+
+const vector<int>& SearchServer::DocumentsWithWord(const string_view word) const {
+    static vector<int> empty;
+    const uint32_t term = terms_.Find(word);
+    return term == TermDictionary::NO_TERM ? empty : word_to_documents_[term].documents;
 }
 
-bool SearchServer::HasMinusWord(const int document_id, const set<string_view>& minus_words) const {
+bool SearchServer::HasMinusWord(const int document_id, const pmr::set<string_view>& minus_words) const {
     //Проходимся по минус словам
     for (const string_view word : minus_words) {
         //Если в словаре с этим словом находим document_id, возвращаем true
@@ -156,8 +686,9 @@ bool SearchServer::IsValidWord(const string_view word) {
 
 //Возвращает string_view именно из хранилища самого сервера
 std::string_view SearchServer::GetSourceView(const string_view word) const {
-    if (word_to_documents_.count(word) == 0) {
+    const uint32_t term = terms_.Find(word);
+    if (term == TermDictionary::NO_TERM) {
         return {};
     }
-    return word_to_documents_.find(word)->first;
+    return terms_.GetTerm(term);
 }
@@ -11,31 +11,193 @@
 #include <exception>
 #include <string_view>
 #include <mutex>
+#include <optional>
+#include <future>
+#include <array>
 #include <type_traits>
+#include <numeric>
+#include <unordered_map>
+#include <memory_resource>
+#include <cstddef>
+#include <bitset>
 
+#include "adaptive_execution.h"
 #include "string_processing.h"
 #include "document.h"
-#include "concurrent_map.h"
+#include "paginator.h"
+#include "posting_intersection.h"
+#include "term_dictionary.h"
+#include "document_bitmap.h"
+#include "document_filter.h"
+#include "document_scratch.h"
+#include "scoring_kernels.h"
+#include "search_budget.h"
+#include "search_executor.h"
+#include "impact_index.h"
+#include "spelling_index.h"
+#include "trace.h"
 
-enum class DocumentStatus {
-    ACTUAL,
-    IRRELEVANT,
-    BANNED,
-    REMOVED
+const int MAX_RESULT_DOCUMENT_COUNT = 5;
+
+//Число исправлений слова, которое по умолчанию возвращает SearchServer::SuggestCorrections
+const size_t MAX_SUGGESTION_COUNT = 5;
+
+//Наибольшее число терминов, в которое раскрывается префиксное слово запроса вида cat*
+const size_t MAX_PREFIX_EXPANSION = 64;
+
+/*
+ * Источники памяти поискового сервера.
+ * index_resource выделяет узлы долгоживущих контейнеров: множества id, атрибутов документов
+ * и прямого индекса. Ресурс должен пережить сервер; запросы память из него не берут,
+ * так что однопоточный пул подходит, если сервер изменяется из одного потока.
+ * query_arenas включает монотонные арены для временных структур запроса:
+ * разобранный запрос собирается в буфере на стеке и освобождается разом.
+ */
+struct MemoryOptions {
+    std::pmr::memory_resource* index_resource = std::pmr::get_default_resource();
+    bool query_arenas = true;
+};
+/*
+ * Способ подсчёта релевантности.
+ * EXACT - TF из прямого индекса в double.
+ * COMPACT - квантованный TF из постингов и накопление во float векторными ядрами.
+ * Релевантность в режиме COMPACT отличается от точной не больше чем на
+ * сумму IDF слов запроса / scoring::TERM_FREQ_LEVELS плюс относительную ошибку float
+ * порядка числа слов запроса * 2^-23. Эта разница намного больше допуска сравнения
+ * релевантностей (1e-6), поэтому документы, чьи точные релевантности отличаются меньше
+ * этой границы, могут идти не в том порядке, что в EXACT, а равные в EXACT документы -
+ * упорядочиться по релевантности вместо рейтинга и id. Одинаковыми остаются только
+ * релевантности документов с одинаковыми TF слов запроса: квантование и порядок сложения
+ * детерминированы.
+ * IMPACT - FindTopDocuments обходит постинги, упорядоченные по вкладу, и останавливается,
+ * как только выдача определена, см. SearchServer::BuildImpactIndex. Выдача и релевантности
+ * совпадают с EXACT. Пока индекс вкладов не построен, поиск идёт как в EXACT.
+ */
+enum class ScoringMode {
+    EXACT,
+    COMPACT,
+    IMPACT
 };
 
-const int MAX_RESULT_DOCUMENT_COUNT = 5;
+/*
+ * Память, занятая структурами индекса, в байтах.
+ */
+struct IndexMemoryStats {
+    size_t term_dictionary = 0;
+    size_t postings = 0;
+    //Квантованные TF в постингах, по 2 байта на пару; хранятся в любом режиме подсчёта
+    size_t term_frequencies = 0;
+    size_t forward_index = 0;
+    size_t document_attributes = 0;
+    size_t stop_words = 0;
+    size_t document_ids = 0;
+    size_t tombstones = 0;
+    size_t impact_index = 0;
+    size_t spelling_index = 0;
+
+    //Число пар (термин, документ) в постингах
+    size_t posting_count = 0;
+
+    size_t Total() const {
+        return term_dictionary + postings + term_frequencies + forward_index + document_attributes + stop_words
+               + document_ids + tombstones + impact_index + spelling_index;
+    }
+};
+
+/*
+ * Непрозрачная позиция в выдаче: последний документ предыдущей страницы.
+ * Следующая страница начинается строго после этого документа в порядке ранжирования.
+ */
+class SearchCursor {
+private:
+    friend class SearchServer;
+
+    explicit SearchCursor(const Document& last) : last_(last) {}
+
+    Document last_;
+};
+
+/*
+ * Параметры запроса страницы: размер страницы и либо смещение от начала выдачи,
+ * либо курсор, полученный с предыдущей страницы. При наличии курсора смещение
+ * отсчитывается от него.
+ */
+struct PageRequest {
+    size_t page_size = MAX_RESULT_DOCUMENT_COUNT;
+    size_t offset = 0;
+    std::optional<SearchCursor> after;
+};
+
+struct SearchPage {
+    std::vector<Document> documents;
+    //Курсор на следующую страницу, пусто если выдача закончилась
+    std::optional<SearchCursor> next;
+};
+
+/*
+ * Выдача поиска с бюджетом. Если бюджет кончился до конца подсчёта, complete == false,
+ * а documents - лучшие из частично посчитанных документов.
+ */
+struct SearchResult {
+    std::vector<Document> documents;
+    bool complete = true;
+};
+
+/*
+ * Исправление слова запроса: термин словаря, расстояние редактирования до исходного слова
+ * и число документов с термином.
+ */
+struct WordSuggestion {
+    std::string_view word;
+    int distance = 0;
+    int document_count = 0;
+};
+
+/*
+ * Результат пакетного сопоставления запроса с документами.
+ * Совпавшие слова всех документов лежат в одном буфере words, слова i-го документа
+ * занимают диапазон [offsets[i], offsets[i + 1]). Слова ссылаются на словарь сервера.
+ */
+struct MatchedDocuments {
+    std::vector<std::string_view> words;
+    std::vector<size_t> offsets;
+    std::vector<DocumentStatus> statuses;
+
+    size_t size() const {
+        return statuses.size();
+    }
+
+    IteratorRange<std::vector<std::string_view>::const_iterator> GetWords(size_t index) const {
+        return {words.begin() + offsets[index], words.begin() + offsets[index + 1]};
+    }
+};
 
 class SearchServer {
 public:
+    struct DocsParams {
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        int rating = 0;
+    };
+
+    //Частоты слов документа в прямом индексе
+    using WordFrequencies = std::pmr::map<std::string_view, double>;
 
     SearchServer() = default;
 
-    explicit SearchServer(const std::string_view stop_text) : SearchServer(SplitIntoWords(stop_text)) {}
-    explicit SearchServer(const std::string& stop_text) : SearchServer(SplitIntoWords(stop_text)) {}
+    explicit SearchServer(const MemoryOptions& memory) : SearchServer(std::vector<std::string_view>(), memory) {}
+
+    explicit SearchServer(const std::string_view stop_text, const MemoryOptions& memory = {})
+        : SearchServer(SplitIntoWords(stop_text), memory) {}
+    explicit SearchServer(const std::string& stop_text, const MemoryOptions& memory = {})
+        : SearchServer(SplitIntoWords(stop_text), memory) {}
 
     template <typename Container>
-    explicit SearchServer(const Container& stop_words) {
+    explicit SearchServer(const Container& stop_words, const MemoryOptions& memory = {})
+        : ids_(memory.index_resource),
+          document_parameters_(memory.index_resource),
+          id_to_word_freq_(memory.index_resource),
+          removed_word_freq_(memory.index_resource),
+          query_arenas_(memory.query_arenas) {
         using namespace std::literals;
         for(const std::string_view word : stop_words) {
             if (!IsValidWord(word)) {
@@ -49,31 +211,118 @@ public:
 
     void AddDocument(int document_id, const std::string_view document, const DocumentStatus status, const std::vector<int>& ratings);
 
+    /*
+     * Добавление документа с уже посчитанными частотами слов, минуя разбор текста.
+     * Используется при восстановлении индекса из снимка.
+     */
+    void AddDocumentWithFrequencies(int document_id, const WordFrequencies& word_freqs,
+                                    const DocsParams& params);
+
+    /*
+     * Пакет документов с уже посчитанными частотами. Слова пакета words отсортированы и
+     * не повторяются; документ ссылается на свои слова отрезком [words_begin, words_end)
+     * в word_freqs, где слова заданы номерами в words по возрастанию.
+     */
+    struct FrequencyBatch {
+        struct Document {
+            int id = 0;
+            DocsParams params;
+            size_t words_begin = 0;
+            size_t words_end = 0;
+        };
+
+        std::vector<std::string_view> words;
+        std::vector<Document> documents;
+        std::vector<std::pair<uint32_t, double>> word_freqs;
+    };
+
+    /*
+     * Пакетное добавление документов с посчитанными частотами: каждое слово пакета проверяется
+     * и ищется в словаре один раз, а не в каждом документе. Пакет проверяется целиком
+     * до вставки, при ошибке бросается invalid_argument и индекс не меняется.
+     * Используется при применении дельт индекса.
+     */
+    void AddDocumentsWithFrequencies(const FrequencyBatch& batch);
+
     /*
      * Основная функция поиска самых подходящих документов по запросу.
-     * Для уточнения поиска используется функция предикат.
+     * Для уточнения поиска используется фильтр, который сервер проверяет по своим структурам,
+     * и функция предикат для условий, которые фильтром не выразить.
      */
     template <typename ExPo, typename Predicate>
-    std::vector<Document> FindTopDocuments(ExPo&& policy, const std::string_view raw_query, const Predicate predicate) const {
-        Query query = ParseQuery(raw_query);
-        std::vector<Document> matched_documents = FindAllDocuments(policy, query, predicate);
-        std::sort(policy, matched_documents.begin(), matched_documents.end(),
-                  [](const Document& lhs, const Document& rhs) {
-            return (!IsDoubleEqual(lhs.relevance, rhs.relevance) && lhs.relevance > rhs.relevance)
-                   || (lhs.rating > rhs.rating && IsDoubleEqual(lhs.relevance, rhs.relevance));
-        });
-        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    std::vector<Document> FindTopDocuments(ExPo&& policy, const std::string_view raw_query,
+                                           const DocumentFilter& filter, const Predicate predicate) const {
+        tracing::QueryTrace trace("FindTopDocuments", raw_query);
+        QueryArena arena(query_arenas_);
+        Query query = ParseQuery(raw_query, arena.GetResource());
+        std::vector<Document> matched_documents = scoring_mode_ == ScoringMode::IMPACT && impact_index_
+                                                  ? FindImpactCandidates(query, filter, predicate)
+                                                  : FindAllDocuments(policy, query, filter, predicate);
+        const size_t candidate_count = matched_documents.size();
+        {
+            TRACE_SPAN("SelectTopDocuments");
+            SelectTopDocuments(policy, matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+        }
+        if (trace.IsActive()) {
+            trace.SetCounters(CountQueryWork(query, candidate_count, matched_documents.size()));
+        }
+        return matched_documents;
+    }
+
+    /*
+     * Поиск с политикой adaptive_execution: работа запроса оценивается по длинам постингов
+     * и числу минус-слов, и планировщик сервера выбирает последовательный поиск или поиск
+     * по диапазонам id и их число. Остальные перегрузки FindTopDocuments приходят сюда же.
+     */
+    template <typename Predicate>
+    std::vector<Document> FindTopDocuments(AdaptiveExecution, const std::string_view raw_query,
+                                           const DocumentFilter& filter, const Predicate predicate) const {
+        tracing::QueryTrace trace("FindTopDocuments", raw_query);
+        QueryArena arena(query_arenas_);
+        Query query = ParseQuery(raw_query, arena.GetResource());
+        size_t posting_count = 0;
+        for (const std::string_view word : query.plus_words) {
+            posting_count += DocumentsWithWord(word).size();
+        }
+        const ExecutionDecision decision = planner_.Plan(ExecutionOperation::SEARCH,
+                                                         posting_count * (1 + query.minus_words.size()));
+        std::vector<Document> matched_documents;
+        if (scoring_mode_ == ScoringMode::IMPACT && impact_index_) {
+            matched_documents = FindImpactCandidates(query, filter, predicate);
+        } else if (decision.parallel && !ids_.empty()) {
+            matched_documents = FindAllDocumentsByRanges(query, filter, predicate, decision.task_count, nullptr);
+        } else {
+            matched_documents = FindAllDocuments(std::execution::seq, query, filter, predicate);
+        }
+        const size_t candidate_count = matched_documents.size();
+        {
+            TRACE_SPAN("SelectTopDocuments");
+            if (decision.parallel) {
+                SelectTopDocuments(std::execution::par, matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+            } else {
+                SelectTopDocuments(std::execution::seq, matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+            }
+        }
+        if (trace.IsActive()) {
+            trace.SetCounters(CountQueryWork(query, candidate_count, matched_documents.size()));
         }
         return matched_documents;
     }
 
+    template <typename ExPo, typename Predicate>
+    std::vector<Document> FindTopDocuments(ExPo&& policy, const std::string_view raw_query, const Predicate predicate) const {
+        return FindTopDocuments(policy, raw_query, DocumentFilter(), predicate);
+    }
+
+    template <typename ExPo>
+    std::vector<Document> FindTopDocuments(ExPo&& policy, const std::string_view raw_query,
+                                           const DocumentFilter& filter) const {
+        return FindTopDocuments(policy, raw_query, filter, AnyDocument());
+    }
+
     template <typename ExPo>
     std::vector<Document> FindTopDocuments(ExPo&& policy, const std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const {
-        return FindTopDocuments(policy, raw_query,
-                                [status](const int doc_id, const DocumentStatus doc_status, const int rating) {
-            return doc_status == status;
-        });
+        return FindTopDocuments(policy, raw_query, DocumentFilter::ByStatus(status));
     }
 
     template <typename Predicate>
@@ -83,17 +332,255 @@ public:
 
     std::vector<Document>  FindTopDocuments(const std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
 
+    std::vector<Document>  FindTopDocuments(const std::string_view raw_query, const DocumentFilter& filter) const;
+
+    /*
+     * Поиск с ограничением по времени и отменой. Подсчёт останавливается, как только
+     * бюджет исчерпан, и возвращает лучшие из уже найденных документов.
+     */
+    template <typename ExPo>
+    SearchResult FindTopDocumentsWithin(ExPo&& policy, const std::string_view raw_query, const DocumentFilter& filter,
+                                        const SearchBudget& budget) const {
+        tracing::QueryTrace trace("FindTopDocumentsWithin", raw_query);
+        SearchResult result;
+        if (budget.IsExhausted()) {
+            result.complete = false;
+            return result;
+        }
+        QueryArena arena(query_arenas_);
+        Query query = ParseQuery(raw_query, arena.GetResource());
+        result.documents = FindAllDocuments(policy, query, filter, AnyDocument(), &budget);
+        const size_t candidate_count = result.documents.size();
+        {
+            TRACE_SPAN("SelectTopDocuments");
+            SelectTopDocuments(policy, result.documents, MAX_RESULT_DOCUMENT_COUNT);
+        }
+        result.complete = !budget.WasExhausted();
+        if (trace.IsActive()) {
+            trace.SetCounters(CountQueryWork(query, candidate_count, result.documents.size()));
+        }
+        return result;
+    }
+
+    SearchResult FindTopDocumentsWithin(const std::string_view raw_query, const DocumentFilter& filter,
+                                        const SearchBudget& budget) const;
+
+    /*
+     * Конъюнктивный поиск: документ находится, только если в нём есть все плюс-слова запроса,
+     * а префиксное слово - хотя бы одним своим продолжением. Постинги слов пересекаются
+     * от самого короткого галопом, см. postings::Intersect, и релевантность считается только
+     * у документов из пересечения. Она та же, что у FindTopDocuments в режиме EXACT.
+     */
+    template <typename Predicate>
+    std::vector<Document> FindTopDocumentsConjunctive(const std::string_view raw_query, const DocumentFilter& filter,
+                                                      const Predicate predicate) const {
+        tracing::QueryTrace trace("FindTopDocumentsConjunctive", raw_query);
+        QueryArena arena(query_arenas_);
+        const Query query = ParseQuery(raw_query, arena.GetResource());
+        std::vector<std::vector<int>> prefix_documents;
+        std::vector<postings::SortedList> lists;
+        if (!CollectRequiredPostings(raw_query, prefix_documents, lists)) {
+            return {};
+        }
+        std::vector<int> candidates;
+        {
+            TRACE_SPAN("IntersectPostings");
+            postings::Intersect(std::move(lists), filter.min_id, filter.max_id, candidates);
+        }
+
+        std::vector<std::pair<std::string_view, double>> word_idfs;
+        for (const std::string_view word : query.plus_words) {
+            word_idfs.emplace_back(word, ComputeWordInverseDocumentFreq(word));
+        }
+        std::vector<Document> matched_documents;
+        for (const int document_id : candidates) {
+            if (!IsDocumentInFilter(document_id, filter) || !IsDocumentAllowed(document_id, query.minus_words, predicate)) {
+                continue;
+            }
+            //Слова суммируются в том же порядке, что и в FindAllDocuments, поэтому сумма совпадает до бита
+            const WordFrequencies& word_freqs = id_to_word_freq_.at(document_id);
+            double relevance = 0.0;
+            for (const auto& [word, inverse_document_freq] : word_idfs) {
+                const auto it = word_freqs.find(word);
+                if (it != word_freqs.end()) {
+                    relevance += it->second * inverse_document_freq;
+                }
+            }
+            matched_documents.emplace_back(document_id, relevance, document_parameters_.at(document_id).rating);
+        }
+        SelectTopDocuments(std::execution::seq, matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+        if (trace.IsActive()) {
+            trace.SetCounters(CountQueryWork(query, candidates.size(), matched_documents.size()));
+        }
+        return matched_documents;
+    }
+
+    std::vector<Document> FindTopDocumentsConjunctive(const std::string_view raw_query, const DocumentFilter& filter) const;
+
+    std::vector<Document> FindTopDocumentsConjunctive(const std::string_view raw_query,
+                                                      DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    /*
+     * Асинхронный поиск с бюджетом в пуле потоков executor, по умолчанию в общем пуле
+     * SearchExecutor::GetShared(). Сервер не должен изменяться и разрушаться, пока результат
+     * не получен. Бюджет отсчитывается и в очереди пула: запрос, дождавшийся потока
+     * после срока, сразу возвращается неполным.
+     */
+    std::future<SearchResult> FindTopDocumentsAsync(const std::string_view raw_query, const DocumentFilter& filter,
+                                                    const SearchBudget& budget) const;
+
+    std::future<SearchResult> FindTopDocumentsAsync(SearchExecutor& executor, const std::string_view raw_query,
+                                                    const DocumentFilter& filter, const SearchBudget& budget) const;
+
+    /*
+     * Пакетный поиск с общей работой. Все запросы разбираются заранее, постинг каждого
+     * различного слова обходится один раз на пакет, и вклады (id, TF * IDF) слова делятся
+     * между всеми запросами с этим словом. Затем каждый запрос сливает вклады своих слов
+     * и отбирает лучшие документы. Выдача совпадает с FindTopDocuments для каждого запроса
+     * в любом режиме подсчёта: в IMPACT вклады точные, как и выдача FindTopDocuments.
+     */
+    template <typename ExPo>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(ExPo&& policy, const std::vector<std::string>& raw_queries,
+                                                             const DocumentFilter& filter) const {
+        //Разбор без политики: исключение о некорректном запросе из параллельного алгоритма вызвало бы terminate.
+        //Запросы пакета живут в одной арене и создаются перемещением, чтобы не копироваться в кучу
+        QueryArena arena(query_arenas_);
+        std::vector<Query> queries;
+        queries.reserve(raw_queries.size());
+        for (const std::string& raw_query : raw_queries) {
+            queries.push_back(ParseQuery(raw_query, arena.GetResource()));
+        }
+
+        std::vector<std::string_view> terms;
+        for (const Query& query : queries) {
+            std::copy_if(query.plus_words.begin(), query.plus_words.end(), std::back_inserter(terms),
+                         [&query](const std::string_view word) {
+                return query.minus_words.count(word) == 0;
+            });
+        }
+        std::sort(policy, terms.begin(), terms.end());
+        terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+        //Один обход постинга на каждое различное слово пакета. Вклады считаются так же,
+        //как в поиске текущего режима: в COMPACT это квантованный TF во float
+        const bool compact = IsCompactScoring();
+        std::vector<std::vector<std::pair<int, double>>> term_contributions(terms.size());
+        std::transform(policy, terms.begin(), terms.end(), term_contributions.begin(),
+                       [this, &filter, compact](const std::string_view word) {
+            std::vector<std::pair<int, double>> contributions;
+            const uint32_t term = terms_.Find(word);
+            if (term == TermDictionary::NO_TERM || word_to_documents_[term].documents.empty()) {
+                return contributions;
+            }
+            const PostingList& postings = word_to_documents_[term];
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+            if (compact) {
+                std::vector<float> scaled(postings.term_freqs.size());
+                scoring::ScaleTermFrequencies(postings.term_freqs.data(), postings.term_freqs.size(),
+                                              static_cast<float>(inverse_document_freq / scoring::TERM_FREQ_LEVELS),
+                                              scaled.data());
+                ForEachFilteredDocument(postings.documents, filter, nullptr,
+                                        [&](const int document_id, const size_t position) {
+                    contributions.emplace_back(document_id, scaled[position]);
+                });
+            } else {
+                ForEachFilteredDocument(postings.documents, filter, nullptr, [&](const int document_id, size_t) {
+                    contributions.emplace_back(document_id,
+                                               id_to_word_freq_.at(document_id).at(word) * inverse_document_freq);
+                });
+            }
+            return contributions;
+        });
+
+        std::vector<std::vector<Document>> result(queries.size());
+        std::transform(policy, queries.begin(), queries.end(), result.begin(),
+                       [this, &terms, &term_contributions, compact](const Query& query) {
+            //Вклады сливаются устойчиво в порядке слов, как суммирует FindAllDocuments
+            std::vector<std::pair<int, double>> contributions;
+            for (const std::string_view word : query.plus_words) {
+                if (query.minus_words.count(word) > 0) {
+                    continue;
+                }
+                const auto& word_contributions =
+                        term_contributions[std::lower_bound(terms.begin(), terms.end(), word) - terms.begin()];
+                const size_t middle = contributions.size();
+                contributions.insert(contributions.end(), word_contributions.begin(), word_contributions.end());
+                std::inplace_merge(contributions.begin(), contributions.begin() + middle, contributions.end(),
+                                   [](const auto& lhs, const auto& rhs) {
+                    return lhs.first < rhs.first;
+                });
+            }
+
+            std::vector<Document> matched_documents;
+            for (size_t i = 0; i < contributions.size();) {
+                const int document_id = contributions[i].first;
+                double relevance = 0.0;
+                float compact_relevance = 0.0f;
+                for (; i < contributions.size() && contributions[i].first == document_id; ++i) {
+                    relevance += contributions[i].second;
+                    compact_relevance += static_cast<float>(contributions[i].second);
+                }
+                if (compact) {
+                    relevance = compact_relevance;
+                }
+                if (!HasMinusWord(document_id, query.minus_words)) {
+                    matched_documents.emplace_back(document_id, relevance, document_parameters_.at(document_id).rating);
+                }
+            }
+            SelectTopDocuments(std::execution::seq, matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+            return matched_documents;
+        });
+        return result;
+    }
+
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                                             const DocumentFilter& filter) const;
+
+    /*
+     * Постраничный поиск. Возвращает ровно одну страницу выдачи в порядке FindTopDocuments,
+     * отбирая её ограниченной кучей без полной сортировки всех найденных документов.
+     */
+    template <typename ExPo, typename Predicate>
+    SearchPage FindTopDocumentsPage(ExPo&& policy, const std::string_view raw_query, const Predicate predicate,
+                                    const PageRequest& request) const {
+        return FindPage(policy, raw_query, DocumentFilter(), predicate, request);
+    }
+
+    template <typename ExPo>
+    SearchPage FindTopDocumentsPage(ExPo&& policy, const std::string_view raw_query, const DocumentFilter& filter,
+                                    const PageRequest& request) const {
+        return FindPage(policy, raw_query, filter, AnyDocument(), request);
+    }
+
+    template <typename ExPo>
+    SearchPage FindTopDocumentsPage(ExPo&& policy, const std::string_view raw_query, const PageRequest& request,
+                                    DocumentStatus status = DocumentStatus::ACTUAL) const {
+        return FindPage(policy, raw_query, DocumentFilter::ByStatus(status), AnyDocument(), request);
+    }
+
+    SearchPage FindTopDocumentsPage(const std::string_view raw_query, const PageRequest& request,
+                                    DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+
     /*
      * Функция, которая возвращает кортеж из вектора совпавших слов из raw_query в документе document_id.
      * Если таких нет или совпало хоть одно минус слово, кортеж возвращается с пустым вектором слов
-     * и статусом документа.
+     * и статусом документа. Слова запроса указывают в raw_query, а слова, раскрытые из префикса,
+     * - в хранилище терминов индекса. Последние действительны, пока термин есть в индексе
+     * и не вызван ShrinkTermStorage.
      */
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
 
+    //Работа оценивается по числу слов запроса до разбора: сам разбор тоже идёт с выбранной политикой
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(AdaptiveExecution, const std::string_view raw_query,
+                                                                            int document_id) const;
+
     template<typename ExPo>
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExPo&& policy, const std::string_view raw_query, int document_id) const {
         using namespace std::string_literals;
-        Query query = ParseQuery(policy, raw_query);
+        TRACE_SPAN("MatchDocument");
+        QueryArena arena(query_arenas_);
+        Query query = ParseQuery(policy, raw_query, arena.GetResource());
         std::vector<std::string_view> matched_words;
 
         if (document_parameters_.count(document_id) == 0) {
@@ -123,49 +610,391 @@ public:
         );
     }
 
+    /*
+     * Пакетный вариант MatchDocument: запрос разбирается один раз и сопоставляется
+     * со всеми документами document_ids. Для отсутствующих документов возвращается
+     * статус REMOVED и пустой список слов. Все слова указывают в хранилище терминов индекса
+     * и действительны столько же, сколько раскрытые из префикса слова MatchDocument.
+     */
+    MatchedDocuments MatchDocuments(const std::string_view raw_query, const std::vector<int>& document_ids) const;
+
+    template<typename ExPo>
+    MatchedDocuments MatchDocuments(ExPo&& policy, const std::string_view raw_query,
+                                    const std::vector<int>& document_ids) const {
+        QueryArena arena(query_arenas_);
+        const Query query = ParseQuery(policy, raw_query, arena.GetResource());
+
+        //Слова, которых нет в индексе, не могут совпасть ни с одним документом
+        std::vector<std::string_view> plus_words;
+        for (const std::string_view word : query.plus_words) {
+            const std::string_view source = GetSourceView(word);
+            if (!source.empty() && query.minus_words.count(word) == 0) {
+                plus_words.push_back(source);
+            }
+        }
+        std::vector<std::string_view> minus_words;
+        for (const std::string_view word : query.minus_words) {
+            const std::string_view source = GetSourceView(word);
+            if (!source.empty()) {
+                minus_words.push_back(source);
+            }
+        }
+
+        const size_t count = document_ids.size();
+        MatchedDocuments result;
+        result.statuses.resize(count, DocumentStatus::REMOVED);
+        result.offsets.assign(count + 1, 0);
+
+        //Первый проход: статусы и число совпавших слов каждого документа.
+        //Алгоритмы передают ссылки на элементы document_ids, позиция документа - смещение ссылки
+        std::for_each(policy, document_ids.begin(), document_ids.end(),
+                      [this, &document_ids, &plus_words, &minus_words, &result](const int& document_id) {
+            const size_t i = &document_id - document_ids.data();
+            const auto params = document_parameters_.find(document_id);
+            if (params == document_parameters_.end()) {
+                return;
+            }
+            result.statuses[i] = params->second.status;
+
+            const auto words = id_to_word_freq_.find(document_id);
+            if (words == id_to_word_freq_.end()) {
+                return;
+            }
+            const auto& word_to_freq = words->second;
+            if (std::any_of(minus_words.begin(), minus_words.end(), [&word_to_freq](const std::string_view word) {
+                return word_to_freq.count(word) > 0;
+            })) {
+                return;
+            }
+            result.offsets[i + 1] = std::count_if(plus_words.begin(), plus_words.end(),
+                                                  [&word_to_freq](const std::string_view word) {
+                return word_to_freq.count(word) > 0;
+            });
+        });
+
+        for (size_t i = 0; i < count; ++i) {
+            result.offsets[i + 1] += result.offsets[i];
+        }
+        result.words.resize(result.offsets[count]);
+
+        //Второй проход: каждый документ пишет слова в свой диапазон общего буфера
+        std::for_each(policy, document_ids.begin(), document_ids.end(),
+                      [this, &document_ids, &plus_words, &result](const int& document_id) {
+            const size_t i = &document_id - document_ids.data();
+            size_t pos = result.offsets[i];
+            if (pos == result.offsets[i + 1]) {
+                return;
+            }
+            const auto& word_to_freq = id_to_word_freq_.at(document_id);
+            for (const std::string_view word : plus_words) {
+                if (word_to_freq.count(word) > 0) {
+                    result.words[pos++] = word;
+                }
+            }
+        });
+
+        return result;
+    }
+
     int GetDocumentCount() const;
 
-    std::set<int>::iterator begin();
+    void SetScoringMode(ScoringMode mode);
+
+    ScoringMode GetScoringMode() const;
+
+    /*
+     * Строит индекс вкладов для режима ScoringMode::IMPACT. Индекс рассчитан на редко
+     * изменяемый сервер: любое добавление или удаление документа сбрасывает его,
+     * и до следующего вызова BuildImpactIndex поиск идёт обычным путём.
+     */
+    void BuildImpactIndex();
+
+    bool HasImpactIndex() const;
+
+    /*
+     * Самонастройка модели стоимости для adaptive_execution замерами на собственном индексе:
+     * цена постинга поиска, слова сопоставления и накладные расходы запуска параллельных задач.
+     * Цена слова удаления остаётся из модели по умолчанию: её не замерить, не меняя индекс,
+     * а индекс калибровка не меняет. Занимает десятки миллисекунд;
+     * как и изменение индекса, не должна идти одновременно с запросами.
+     */
+    ExecutionCostModel CalibrateExecution();
+
+    void SetExecutionCostModel(const ExecutionCostModel& model);
 
-    std::set<int>::iterator end();
+    const ExecutionCostModel& GetExecutionCostModel() const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    /*
+     * Решения adaptive_execution, принятые с создания сервера или ResetExecutionMetrics.
+     */
+    ExecutionMetrics GetExecutionMetrics() const;
 
+    void ResetExecutionMetrics();
+
+    /*
+     * Исправления слова word из словаря сервера на расстоянии редактирования от 1 до
+     * SpellingIndex::MAX_EDIT_DISTANCE, не больше count штук: по возрастанию расстояния,
+     * затем по убыванию числа документов. Слова ссылаются на словарь сервера.
+     */
+    std::vector<WordSuggestion> SuggestCorrections(std::string_view word, size_t count = MAX_SUGGESTION_COUNT) const;
+
+    /*
+     * "Возможно, вы имели в виду": запрос, в котором каждое плюс-слово без документов
+     * заменено лучшим исправлением. Минус-слова, префиксные и стоп-слова не меняются.
+     * Пусто, если исправить нечего.
+     */
+    std::optional<std::string> SuggestQuery(std::string_view raw_query) const;
+
+    /*
+     * Точный подсчёт памяти индекса по структурам.
+     */
+    IndexMemoryStats GetMemoryStats() const;
+
+    std::pmr::set<int>::iterator begin();
+
+    std::pmr::set<int>::iterator end();
+
+    std::pmr::set<int>::const_iterator begin() const;
+
+    std::pmr::set<int>::const_iterator end() const;
+
+    const WordFrequencies& GetWordFrequencies(int document_id) const;
+
+    /*
+     * Статус и рейтинг документа, пусто если документа нет.
+     */
+    std::optional<DocsParams> GetDocumentParams(int document_id) const;
+
+    const std::set<std::string, std::less<>>& GetStopWords() const;
+
+    /*
+     * Удаление документа. Документ помечается в карте удалённых и сразу перестаёт
+     * находиться, а его постинги переписываются позже, в Compact.
+     */
     void RemoveDocument(int document_id);
 
+    //Работа оценивается по числу слов документа
+    void RemoveDocument(AdaptiveExecution, int document_id);
+
     template<typename ExPo>
     void RemoveDocument(ExPo&& policy, const int document_id) {
         if (ids_.count(document_id) == 0) {
             return;
         }
 
-        auto& words = id_to_word_freq_[document_id];
-        std::for_each(policy, words.begin(), words.end(),
-                      [this, document_id](const std::pair<std::string_view, double>& word_to_freq) {
-            std::string_view word = word_to_freq.first;
-            word_to_documents_.find(word)->second.erase(document_id);
-        });
+        impact_index_.reset();
+        deleted_.Set(document_id);
+        status_documents_[static_cast<int>(document_parameters_.at(document_id).status)].Reset(document_id);
+        auto node = id_to_word_freq_.extract(document_id);
+        if (!node.empty()) {
+            //Учитываем удаление в числе документов со словом, чтобы IDF оставался точным
+            auto& words = node.mapped();
+            std::for_each(policy, words.begin(), words.end(),
+                          [this](const std::pair<std::string_view, double>& word_to_freq) {
+                ++word_to_documents_[terms_.Find(word_to_freq.first)].removed;
+            });
+            removed_word_freq_.insert(std::move(node));
+        }
 
         ids_.erase(document_id);
         document_parameters_.erase(document_id);
-        id_to_word_freq_.erase(document_id);
+
+        if (deleted_.count() > std::max(MIN_COMPACTION_SIZE, ids_.size() / 4)) {
+            Compact(policy);
+        }
+    }
+
+    /*
+     * Уплотнение индекса: из постингов затронутых удалением слов разом вычищаются
+     * удалённые документы, слова без документов убираются из словаря. Строки живых
+     * терминов остаются на месте.
+     */
+    void Compact();
+
+    /*
+     * Переносит строки словаря в новые блоки, возвращая память удалённых терминов, которую
+     * не заняли новые. Слова, полученные ранее из MatchDocument, MatchDocuments
+     * и GetWordFrequencies, после этого недействительны, поэтому индекс не вызывает
+     * перенос сам.
+     */
+    void ShrinkTermStorage();
+
+    template<typename ExPo>
+    void Compact(ExPo&& policy) {
+        if (deleted_.empty()) {
+            return;
+        }
+
+        std::vector<uint32_t> dirty_terms;
+        for (const auto& removed : removed_word_freq_) {
+            for (const auto& [word, _] : removed.second) {
+                dirty_terms.push_back(terms_.Find(word));
+            }
+        }
+        std::sort(policy, dirty_terms.begin(), dirty_terms.end());
+        dirty_terms.erase(std::unique(dirty_terms.begin(), dirty_terms.end()), dirty_terms.end());
+
+        std::for_each(policy, dirty_terms.begin(), dirty_terms.end(), [this](const uint32_t term) {
+            PostingList& postings = word_to_documents_[term];
+            size_t kept = 0;
+            for (size_t i = 0; i < postings.documents.size(); ++i) {
+                if (!deleted_.Test(postings.documents[i])) {
+                    postings.documents[kept] = postings.documents[i];
+                    postings.term_freqs[kept] = postings.term_freqs[i];
+                    ++kept;
+                }
+            }
+            postings.documents.resize(kept);
+            postings.term_freqs.resize(kept);
+            postings.removed = 0;
+            if (postings.documents.empty()) {
+                postings.documents.shrink_to_fit();
+                postings.term_freqs.shrink_to_fit();
+            }
+        });
+
+        std::vector<uint32_t> dead_terms;
+        std::copy_if(dirty_terms.begin(), dirty_terms.end(), std::back_inserter(dead_terms),
+                     [this](const uint32_t term) {
+            return word_to_documents_[term].documents.empty();
+        });
+        for (const uint32_t term : dead_terms) {
+            spelling_index_.RemoveTerm(term, terms_.GetTerm(term));
+        }
+        terms_.Erase(dead_terms);
+
+        removed_word_freq_.clear();
+        deleted_.Clear();
+    }
+
+    /*
+     * Не более MAX_PREFIX_EXPANSION терминов с префиксом, у которых есть живые документы.
+     * Термины, все документы которых удалены, но ещё не вычищены Compact, не занимают места в лимите.
+     */
+    template <typename Func>
+    void ForEachLiveTermWithPrefix(const std::string_view prefix, Func func) const {
+        terms_.ForEachWithPrefix(prefix, MAX_PREFIX_EXPANSION, [this](const uint32_t term) {
+            return word_to_documents_[term].GetDocumentCount() == 0;
+        }, func);
     }
 
     bool IsWordInDocument(const std::string_view word, const int document_id) const;
 
-    const std::set<int>& DocumentsWithWord(const std::string_view word) const;
+    /*
+     * Отсортированные id документов со словом word.
+     * До вызова Compact может содержать удалённые документы.
+     */
+    const std::vector<int>& DocumentsWithWord(const std::string_view word) const;
+
+    /*
+     * Порядок ранжирования: по убыванию релевантности, затем рейтинга, затем по возрастанию id.
+     */
+    [[nodiscard]] static bool IsDocumentBefore(const Document& lhs, const Document& rhs);
+
+    /*
+     * Оставляет в documents первые count документов в порядке ранжирования.
+     */
+    template <typename ExPo>
+    static void SelectTopDocuments(ExPo&& policy, std::vector<Document>& documents, size_t count) {
+        count = std::min(count, documents.size());
+        std::partial_sort(policy, documents.begin(), documents.begin() + count, documents.end(), IsDocumentBefore);
+        documents.resize(count);
+    }
+
+    static int ComputeAverageRating(const std::vector<int>& ratings);
+
+    [[nodiscard]] static bool IsValidWord(const std::string_view word);
 
 private:
-    struct DocsParams {
-        DocumentStatus status = DocumentStatus::ACTUAL;
-        int rating = 0;
-    };
-    std::set<int> ids_;
-    std::map<int, DocsParams> document_parameters_;
+    std::pmr::set<int> ids_;
+    std::pmr::map<int, DocsParams> document_parameters_;
     std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string, std::set<int>, std::less<>> word_to_documents_;
+    static constexpr size_t MIN_COMPACTION_SIZE = 1024;
+    //Сколько претендентов режим IMPACT готов пересчитать точно, прежде чем остановить обход
+    static constexpr size_t MAX_IMPACT_CANDIDATE_COUNT = 64;
 
-    std::map<int, std::map<std::string_view, double>> id_to_word_freq_;
+    struct PostingList {
+        std::vector<int> documents;
+        //Квантованные TF, параллельно documents
+        std::vector<uint16_t> term_freqs;
+        //Сколько документов из documents помечено удалёнными
+        int removed = 0;
+
+        int GetDocumentCount() const {
+            return static_cast<int>(documents.size()) - removed;
+        }
+    };
+
+    TermDictionary terms_;
+    //Постинги, индекс вектора - номер термина в terms_
+    std::vector<PostingList> word_to_documents_;
+
+    //Постинги остаются в куче: это непрерывные растущие массивы, пулу узлов от них нет выгоды
+    std::pmr::map<int, WordFrequencies> id_to_word_freq_;
+
+    //Удалённые документы, ещё не вычищенные из постингов, и их слова
+    DocumentBitmap deleted_;
+    std::pmr::map<int, WordFrequencies> removed_word_freq_;
+
+    //Живые документы каждого статуса, индекс массива - значение DocumentStatus
+    std::array<DocumentBitmap, DOCUMENT_STATUS_COUNT> status_documents_;
+
+    ScoringMode scoring_mode_ = ScoringMode::EXACT;
+    std::optional<ImpactIndex> impact_index_;
+    //Пополняется новыми терминами в InsertDocument и очищается от мёртвых в Compact
+    SpellingIndex spelling_index_;
+    bool query_arenas_ = true;
+    ExecutionPlanner planner_;
+
+    /*
+     * Монотонная арена для временных структур одного запроса. Первые килобайты берутся
+     * из буфера на стеке, остальное - из ресурса по умолчанию; всё освобождается разом
+     * при выходе из запроса. Выключенная арена отдаёт ресурс по умолчанию.
+     */
+    class QueryArena {
+    public:
+        explicit QueryArena(bool enabled) : enabled_(enabled) {}
+
+        std::pmr::memory_resource* GetResource() {
+            return enabled_ ? &resource_ : std::pmr::get_default_resource();
+        }
+
+    private:
+        static constexpr size_t BUFFER_SIZE = 4096;
+
+        bool enabled_;
+        alignas(std::max_align_t) std::array<std::byte, BUFFER_SIZE> buffer_;
+        std::pmr::monotonic_buffer_resource resource_{buffer_.data(), buffer_.size()};
+    };
+
+    //Предикат-заглушка: с ним поиск не обращается к атрибутам документа
+    struct AnyDocument {
+        bool operator()(int, DocumentStatus, int) const {
+            return true;
+        }
+    };
+
+    /*
+     * Проверка id нового документа. Бросает invalid_argument для отрицательных и занятых id.
+     */
+    void CheckNewDocumentId(int document_id) const;
+
+    /*
+     * Вставка проверенного документа в индекс.
+     */
+    void InsertDocument(int document_id, const WordFrequencies& word_freqs, const DocsParams& params);
+
+    //Атрибуты нового документа, без слов
+    void RegisterDocument(int document_id, const DocsParams& params);
+
+    //Документ в постингах термина term и в прямом индексе; термины документа идут по возрастанию слов
+    void AddPosting(int document_id, uint32_t term, double freq, WordFrequencies& document_words);
+
+    /*
+     * Вычищает из постингов один удалённый документ перед его повторным добавлением,
+     * не дожидаясь Compact.
+     */
+    void PurgeRemovedDocument(int document_id);
 
     [[nodiscard]] bool IsStopWord(const std::string_view word) const;
 
@@ -176,38 +1005,51 @@ private:
      */
     [[nodiscard]] static bool IsDoubleEqual(const double first, const double second);
 
-    static int ComputeAverageRating(const std::vector<int>& ratings);
+    //Номер младшего установленного бита ненулевого слова, без встроенных функций компилятора
+    static size_t CountTrailingZeros(const uint64_t word) {
+        return std::bitset<64>((word & (~word + 1)) - 1).count();
+    }
+
 
     struct QueryWord {
         std::string_view word;
         bool is_minus = false;
         bool is_stop = false;
+        bool is_prefix = false;
     };
 
     /*
      * Анализ слова.
      * Возвращает структуру со свойствами слова word.
+     * Слово со звёздочкой на конце (cat*) считается префиксом и раскрывается в термины словаря.
      */
     QueryWord ParseQueryWord(std::string_view word) const;
 
     struct Query {
-        std::set<std::string_view> plus_words;
-        std::set<std::string_view> minus_words;
+        Query() = default;
+
+        explicit Query(std::pmr::memory_resource* resource) : plus_words(resource), minus_words(resource) {}
+
+        std::pmr::set<std::string_view> plus_words;
+        std::pmr::set<std::string_view> minus_words;
     };
 
     /*
      * Разбивает строку-запрос на плюс и минус слова, исключая стоп слова.
-     * Возвращает структуру с двумя множествами этих слов.
+     * Возвращает структуру с двумя множествами этих слов, выделенными из resource.
      */
-    Query ParseQuery(const std::string_view text) const;
+    Query ParseQuery(const std::string_view text,
+                     std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
 
     template<typename ExPo>
-    Query ParseQuery(ExPo&& policy, const std::string_view text) const {
+    Query ParseQuery(ExPo&& policy, const std::string_view text,
+                     std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const {
         using namespace std::literals;
-        Query query;
+        TRACE_SPAN("ParseQuery");
+        Query query(resource);
         std::vector<std::string_view> words = SplitIntoWords(text);
 
-        std::vector<QueryWord> query_words(words.size());
+        std::pmr::vector<QueryWord> query_words(words.size(), resource);
 
         //Сначала парсим слова и записываем в новый вектор
         std::transform(policy, words.begin(), words.end(), query_words.begin(),
@@ -228,6 +1070,14 @@ private:
                 return;
             }
 
+            if (query_word.is_prefix) {
+                auto& words = query_word.is_minus ? query.minus_words : query.plus_words;
+                ForEachLiveTermWithPrefix(query_word.word, [this, &words](const uint32_t term) {
+                    words.insert(terms_.GetTerm(term));
+                });
+                return;
+            }
+
             if (query_word.is_minus) {
                 query.minus_words.insert(query_word.word);
             } else {
@@ -238,6 +1088,19 @@ private:
         return query;
     }
 
+    /*
+     * Постинги, которые должны пересечься в конъюнктивном поиске: по списку на плюс-слово,
+     * для префиксного слова - объединение постингов его продолжений, которое сохраняется
+     * в prefix_documents. false, если пересечение заведомо пусто.
+     */
+    bool CollectRequiredPostings(std::string_view raw_query, std::vector<std::vector<int>>& prefix_documents,
+                                 std::vector<postings::SortedList>& lists) const;
+
+    /*
+     * Счётчики работы запроса для журнала медленных запросов.
+     */
+    tracing::QueryCounters CountQueryWork(const Query& query, size_t candidate_count, size_t result_count) const;
+
     /*
      * Вычисление IDF слова.
      */
@@ -246,63 +1109,429 @@ private:
     /*
      * Проверяет, есть ли в документе с id = document_id минус слово.
      */
-    bool HasMinusWord(const int document_id, const std::set<std::string_view>& minus_words) const;
+    bool HasMinusWord(const int document_id, const std::pmr::set<std::string_view>& minus_words) const;
 
     /*
      * Проверяет, удовлетворяет ли документ требованиям запроса.
      * Сначала идёт проверка через функцию предикат, а потом проверка на минус слово.
      */
     template <typename Predicate>
-    [[nodiscard]] bool IsDocumentAllowed(const int document_id, const std::set<std::string_view>& minus_words,
+    [[nodiscard]] bool IsDocumentAllowed(const int document_id, const std::pmr::set<std::string_view>& minus_words,
             const Predicate predicate) const {
-        return predicate(
-                document_id,
-                document_parameters_.at(document_id).status,
-                document_parameters_.at(document_id).rating
-        ) && !HasMinusWord(document_id, minus_words);
+        if constexpr (!std::is_same_v<Predicate, AnyDocument>) {
+            const DocsParams& params = document_parameters_.at(document_id);
+            if (!predicate(document_id, params.status, params.rating)) {
+                return false;
+            }
+        }
+        return !HasMinusWord(document_id, minus_words);
+    }
+
+    /*
+     * Вызывает func(document_id, position) для живых документов из отсортированного постинга, подходящих под фильтр.
+     * Обход прерывается, когда исчерпан budget, если он задан.
+     * Диапазон id отсекается бинарным поиском, статусы проверяются по битовым картам словами
+     * по 64 документа: блок без единого документа нужных статусов пропускается целиком.
+     */
+    template <typename Func>
+    void ForEachFilteredDocument(const std::vector<int>& documents, const DocumentFilter& filter,
+                                 const SearchBudget* budget, Func func) const {
+        auto it = std::lower_bound(documents.begin(), documents.end(), filter.min_id);
+        const auto end = std::upper_bound(it, documents.end(), filter.max_id);
+        const bool check_rating = filter.HasRatingRange();
+        //Бюджет проверяется по границам участков из CHECK_INTERVAL постингов
+        auto check_point = it;
+        const auto is_exhausted = [&]() {
+            if (budget == nullptr || it - check_point < static_cast<std::ptrdiff_t>(SearchBudget::CHECK_INTERVAL)) {
+                return false;
+            }
+            check_point = it;
+            return budget->IsExhausted();
+        };
+
+        if (filter.HasAllStatuses()) {
+            for (; it != end && !is_exhausted(); ++it) {
+                if (!deleted_.Test(*it) && (!check_rating || IsRatingInRange(*it, filter))) {
+                    func(*it, it - documents.begin());
+                }
+            }
+            return;
+        }
+
+        while (it != end && !is_exhausted()) {
+            const size_t word_index = static_cast<size_t>(*it) / 64;
+            uint64_t allowed = 0;
+            for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+                if (filter.HasStatus(static_cast<DocumentStatus>(status))) {
+                    allowed |= status_documents_[status].GetWord(word_index);
+                }
+            }
+            if (allowed == 0) {
+                it = std::upper_bound(it, end, *it | 63);
+                continue;
+            }
+            for (; it != end && static_cast<size_t>(*it) / 64 == word_index; ++it) {
+                if ((allowed >> (*it % 64) & 1) != 0 && (!check_rating || IsRatingInRange(*it, filter))) {
+                    func(*it, it - documents.begin());
+                }
+            }
+        }
+    }
+
+    bool IsRatingInRange(int document_id, const DocumentFilter& filter) const {
+        const int rating = document_parameters_.at(document_id).rating;
+        return filter.min_rating <= rating && rating <= filter.max_rating;
     }
 
     /*
-     * Поиск всех документов, удовлетворяющих запросу.
+     * Поиск всех документов, удовлетворяющих запросу. Политика не передаётся алгоритмам:
+     * параллельная лишь разрешает поиск по диапазонам id, а внутри диапазона и при seq
+     * релевантность накапливается последовательно.
      */
     template <typename ExPo, typename Predicate>
-    std::vector<Document> FindAllDocuments(ExPo&& policy, const Query& query, const Predicate predicate) const {
-        size_t buckets = std::is_same<ExPo, const std::execution::parallel_policy&>::value ? 8 : 1;
-        ConcurrentMap<int, double> document_to_relevance(buckets);
+    std::vector<Document> FindAllDocuments([[maybe_unused]] ExPo&& policy, const Query& query,
+                                           const DocumentFilter& filter, const Predicate predicate,
+                                           const SearchBudget* budget = nullptr) const {
+        TRACE_SPAN("FindAllDocuments");
+        if constexpr (!std::is_same_v<std::decay_t<ExPo>, std::execution::sequenced_policy>) {
+            const size_t range_count = ComputeDocumentRangeCount(query);
+            if (range_count > 1) {
+                return FindAllDocumentsByRanges(query, filter, predicate, range_count, budget);
+            }
+        }
+        if (IsCompactScoring()) {
+            return FindAllDocumentsCompact(query, filter, predicate, budget);
+        }
+
+        //Начальный размер по самому длинному постингу запроса, чтобы таблица реже росла
+        size_t expected_document_count = 0;
+        for (const std::string_view word : query.plus_words) {
+            expected_document_count = std::max(expected_document_count, DocumentsWithWord(word).size());
+        }
+        //Накопление последовательное, поэтому обычная таблица без атомарных операций
+        std::unordered_map<int, double> document_to_relevance;
+        document_to_relevance.reserve(expected_document_count);
 
         //Проходим по плюс словам и заполняем словарь document_to_relevance
-        std::for_each(policy, query.plus_words.begin(), query.plus_words.end(),
-                      [this, &document_to_relevance, &query, &predicate](const std::string_view word){
-            const std::set<int>& documents_with_word = DocumentsWithWord(word);
-            if (documents_with_word.empty() || query.minus_words.count(word) > 0) {
+        std::for_each(query.plus_words.begin(), query.plus_words.end(),
+                      [this, &document_to_relevance, &query, &filter, &predicate, budget](const std::string_view word){
+            const std::vector<int>& documents_with_word = DocumentsWithWord(word);
+            if (documents_with_word.empty() || query.minus_words.count(word) > 0
+                || (budget != nullptr && budget->IsExhausted())) {
                 return;
             }
 
             const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const int document_id : documents_with_word) {
+            ForEachFilteredDocument(documents_with_word, filter, budget, [&](const int document_id, size_t) {
                 if (IsDocumentAllowed(document_id, query.minus_words, predicate)) {
-                    document_to_relevance[document_id].ref_to_value += id_to_word_freq_.at(document_id)
-                            .at(word) * inverse_document_freq;
+                    document_to_relevance[document_id] += id_to_word_freq_.at(document_id).at(word)
+                                                          * inverse_document_freq;
                 }
-            }
+            });
         });
 
-        //Объявляем и заполняем вектор документов
-        std::map<int, double> document_to_relevance_ordinary = document_to_relevance.BuildOrdinaryMap();
-        std::vector<Document> matched_documents(document_to_relevance_ordinary.size());
-        std::transform(policy, document_to_relevance_ordinary.begin(), document_to_relevance_ordinary.end(),
-                      matched_documents.begin(), [this](const std::pair<int, double>& doc_freq){
-            return Document{
-                doc_freq.first,
-                doc_freq.second,
-                document_parameters_.at(doc_freq.first).rating
-            };
+        //Документы собираются прямо из таблицы, без промежуточного упорядоченного словаря
+        std::vector<Document> matched_documents;
+        matched_documents.reserve(document_to_relevance.size());
+        for (const auto& [document_id, relevance] : document_to_relevance) {
+            matched_documents.emplace_back(document_id, relevance, document_parameters_.at(document_id).rating);
+        }
+        return matched_documents;
+    }
+
+    /*
+     * Подходит ли документ под фильтр, без учёта предиката и минус-слов.
+     */
+    bool IsDocumentInFilter(int document_id, const DocumentFilter& filter) const;
+
+    /*
+     * Претенденты в лучшие документы в режиме ScoringMode::IMPACT, подсчёт score-at-a-time.
+     * Участки постингов с равным вкладом обходятся от большего вклада к меньшему сразу по всем
+     * словам запроса. Обход останавливается, когда даже сумма оставшихся вкладов не выводит
+     * ещё не встреченный документ в лучшие, а претендентов, которые могут обогнать
+     * MAX_RESULT_DOCUMENT_COUNT-й документ, осталось не больше MAX_IMPACT_CANDIDATE_COUNT.
+     * Квантованная сумма документа отличается от точной не больше чем на шаг на слово,
+     * поэтому запас в 2 шага на слово не даёт потерять документ из точной выдачи.
+     * Релевантность претендентов пересчитывается точно по прямому индексу.
+     */
+    template <typename Predicate>
+    std::vector<Document> FindImpactCandidates(const Query& query, const DocumentFilter& filter,
+                                               const Predicate& predicate) const {
+        using PostingIterator = std::vector<ImpactIndex::Posting>::const_iterator;
+        struct TermCursor {
+            PostingIterator next;
+            PostingIterator end;
+        };
+        std::vector<TermCursor> cursors;
+        std::vector<std::pair<std::string_view, double>> word_idfs;
+        for (const std::string_view word : query.plus_words) {
+            const uint32_t term = terms_.Find(word);
+            if (term == TermDictionary::NO_TERM || query.minus_words.count(word) > 0) {
+                continue;
+            }
+            const auto postings = impact_index_->GetPostings(term);
+            if (postings.begin() != postings.end()) {
+                cursors.push_back({postings.begin(), postings.end()});
+                word_idfs.emplace_back(word, ComputeWordInverseDocumentFreq(word));
+            }
+        }
+
+        struct Accumulator {
+            uint32_t score = 0;
+            //Начало битовой маски документа в term_masks
+            size_t terms = 0;
+            bool rejected = false;
+        };
+        //Слова запроса, в постингах которых документ уже встречен: mask_words слов на документ подряд
+        const size_t mask_words = (cursors.size() + 63) / 64;
+        std::vector<uint64_t> term_masks;
+        const uint32_t slack = 2 * static_cast<uint32_t>(cursors.size());
+        std::unordered_map<int, Accumulator> accumulators;
+        //Вклады в начале непройденной части постинга каждого слова и их сумма
+        std::vector<uint32_t> heads(cursors.size(), 0);
+        uint32_t remaining = 0;
+        //Верхняя граница итоговой квантованной суммы: документ ещё может встретиться только в словах, где его не было
+        const auto upper_bound = [&](const Accumulator& accumulator) {
+            uint32_t bound = accumulator.score + remaining;
+            for (size_t word = 0; word < mask_words; ++word) {
+                for (uint64_t terms = term_masks[accumulator.terms + word]; terms != 0; terms &= terms - 1) {
+                    bound -= heads[word * 64 + CountTrailingZeros(terms)];
+                }
+            }
+            return bound;
+        };
+        std::vector<uint32_t> accepted_scores;
+        //Квантованная сумма MAX_RESULT_DOCUMENT_COUNT-го документа, 0 если документов меньше
+        const auto compute_threshold = [&]() -> uint32_t {
+            accepted_scores.clear();
+            for (const auto& [_, accumulator] : accumulators) {
+                if (!accumulator.rejected) {
+                    accepted_scores.push_back(accumulator.score);
+                }
+            }
+            if (accepted_scores.size() < MAX_RESULT_DOCUMENT_COUNT) {
+                return 0;
+            }
+            const auto kth = accepted_scores.begin() + (MAX_RESULT_DOCUMENT_COUNT - 1);
+            std::nth_element(accepted_scores.begin(), kth, accepted_scores.end(), std::greater<>());
+            return *kth;
+        };
+        const auto is_candidate = [&](const Accumulator& accumulator, const uint32_t threshold) {
+            return !accumulator.rejected && upper_bound(accumulator) + slack >= threshold;
+        };
+
+        //Проверка остановки стоит O(числа встреченных документов) и делается не чаще, чем через столько же постингов
+        size_t postings_since_check = 0;
+        size_t check_interval = MAX_RESULT_DOCUMENT_COUNT;
+        while (true) {
+            remaining = 0;
+            size_t best = cursors.size();
+            for (size_t i = 0; i < cursors.size(); ++i) {
+                heads[i] = cursors[i].next != cursors[i].end ? cursors[i].next->impact : 0;
+                remaining += heads[i];
+                if (heads[i] > 0 && (best == cursors.size() || heads[i] > heads[best])) {
+                    best = i;
+                }
+            }
+            if (best == cursors.size()) {
+                break;
+            }
+            if (postings_since_check >= check_interval) {
+                postings_since_check = 0;
+                check_interval = std::max(accumulators.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+                const uint32_t threshold = compute_threshold();
+                if (remaining + slack < threshold) {
+                    size_t candidate_count = 0;
+                    for (auto it = accumulators.begin(); it != accumulators.end()
+                                                         && candidate_count <= MAX_IMPACT_CANDIDATE_COUNT; ++it) {
+                        candidate_count += is_candidate(it->second, threshold) ? 1 : 0;
+                    }
+                    if (candidate_count <= MAX_IMPACT_CANDIDATE_COUNT) {
+                        break;
+                    }
+                }
+            }
+
+            TermCursor& cursor = cursors[best];
+            const uint8_t impact = cursor.next->impact;
+            const uint64_t term_bit = uint64_t{1} << (best % 64);
+            for (; cursor.next != cursor.end && cursor.next->impact == impact; ++cursor.next, ++postings_since_check) {
+                const int document_id = cursor.next->document_id;
+                const auto [it, inserted] = accumulators.try_emplace(document_id);
+                Accumulator& accumulator = it->second;
+                if (inserted) {
+                    accumulator.rejected = !(IsDocumentInFilter(document_id, filter)
+                                             && IsDocumentAllowed(document_id, query.minus_words, predicate));
+                    accumulator.terms = term_masks.size();
+                    term_masks.resize(term_masks.size() + mask_words, 0);
+                }
+                accumulator.score += impact;
+                term_masks[accumulator.terms + best / 64] |= term_bit;
+            }
+        }
+
+        const uint32_t threshold = compute_threshold();
+        std::vector<Document> candidates;
+        for (const auto& [document_id, accumulator] : accumulators) {
+            if (!is_candidate(accumulator, threshold)) {
+                continue;
+            }
+            //Тот же порядок сложения, что и в FindAllDocuments, даёт побитово ту же релевантность
+            const auto& word_freqs = id_to_word_freq_.at(document_id);
+            double relevance = 0.0;
+            for (const auto& [word, inverse_document_freq] : word_idfs) {
+                const auto word_freq = word_freqs.find(word);
+                if (word_freq != word_freqs.end()) {
+                    relevance += word_freq->second * inverse_document_freq;
+                }
+            }
+            candidates.emplace_back(document_id, relevance, document_parameters_.at(document_id).rating);
+        }
+        return candidates;
+    }
+
+    /*
+     * Поиск в режиме ScoringMode::COMPACT. Вклады слова считаются векторным ядром по всему
+     * постингу, а суммы во float накапливаются в рабочих массивах потока по смещению id
+     * от наименьшего. Сбрасываются только затронутые ячейки, поэтому запрос стоит
+     * O(обойдённых постингов), а не O(диапазона id). Подсчёт последовательный.
+     */
+    template <typename Predicate>
+    std::vector<Document> FindAllDocumentsCompact(const Query& query, const DocumentFilter& filter,
+                                                  const Predicate& predicate, const SearchBudget* budget) const {
+        if (ids_.empty()) {
+            return {};
+        }
+        const int first_id = *ids_.begin();
+        DocumentScratch& scratch = DocumentScratch::Acquire(static_cast<size_t>(*ids_.rbegin() - first_id) + 1);
+        std::vector<float> contributions;
+
+        for (const std::string_view word : query.plus_words) {
+            const uint32_t term = terms_.Find(word);
+            if (term == TermDictionary::NO_TERM || query.minus_words.count(word) > 0) {
+                continue;
+            }
+            if (budget != nullptr && budget->IsExhausted()) {
+                break;
+            }
+            const PostingList& postings = word_to_documents_[term];
+            const float factor = static_cast<float>(ComputeWordInverseDocumentFreq(word) / scoring::TERM_FREQ_LEVELS);
+            contributions.resize(postings.term_freqs.size());
+            scoring::ScaleTermFrequencies(postings.term_freqs.data(), postings.term_freqs.size(), factor,
+                                          contributions.data());
+
+            ForEachFilteredDocument(postings.documents, filter, budget,
+                                    [&](const int document_id, const size_t position) {
+                const uint32_t index = static_cast<uint32_t>(document_id - first_id);
+                DocumentScratch::State state = scratch.GetState(index);
+                if (state == DocumentScratch::UNSEEN) {
+                    state = IsDocumentAllowed(document_id, query.minus_words, predicate)
+                            ? DocumentScratch::MATCHED : DocumentScratch::REJECTED;
+                    scratch.SetState(index, state);
+                }
+                if (state == DocumentScratch::MATCHED) {
+                    //Сумма ведётся во float, как в FindTopDocumentsBatch
+                    scratch.SetRelevance(index, static_cast<float>(scratch.GetRelevance(index)) + contributions[position]);
+                }
+            });
+        }
+
+        //Выдача по возрастанию id, как при обходе плотного массива
+        scratch.SortTouched();
+        std::vector<Document> matched_documents;
+        for (const uint32_t index : scratch.GetTouched()) {
+            if (scratch.GetState(index) == DocumentScratch::MATCHED) {
+                const int document_id = first_id + static_cast<int>(index);
+                matched_documents.emplace_back(document_id, scratch.GetRelevance(index),
+                                               document_parameters_.at(document_id).rating);
+            }
+        }
+        return matched_documents;
+    }
+
+    /*
+     * Число диапазонов id для параллельного поиска по запросу. 1, если постингов
+     * слишком мало и параллельный поиск не окупится.
+     */
+    size_t ComputeDocumentRangeCount(const Query& query) const;
+
+    /*
+     * Параллельный поиск: пространство id делится на range_count равных диапазонов,
+     * каждый диапазон независимо обходит постинги всех слов запроса с помощью
+     * бинарного поиска по своим границам. Результаты диапазонов не пересекаются и
+     * склеиваются в порядке id, как у последовательного поиска.
+     */
+    template <typename Predicate>
+    std::vector<Document> FindAllDocumentsByRanges(const Query& query, const DocumentFilter& filter,
+                                                   const Predicate& predicate, const size_t range_count,
+                                                   const SearchBudget* budget) const {
+        const int64_t first_id = std::max(filter.min_id, *ids_.begin());
+        const int64_t last_id = std::min(filter.max_id, *ids_.rbegin());
+        if (last_id < first_id) {
+            return {};
+        }
+        const int64_t range_size = (last_id - first_id) / static_cast<int64_t>(range_count) + 1;
+
+        std::vector<std::vector<Document>> range_documents(range_count);
+        std::vector<size_t> ranges(range_count);
+        std::iota(ranges.begin(), ranges.end(), 0);
+        std::for_each(std::execution::par, ranges.begin(), ranges.end(), [&](const size_t range) {
+            const int64_t range_first_id = first_id + range_size * static_cast<int64_t>(range);
+            if (range_first_id > last_id) {
+                return;
+            }
+            DocumentFilter range_filter = filter;
+            range_filter.min_id = static_cast<int>(range_first_id);
+            range_filter.max_id = static_cast<int>(std::min(last_id, range_first_id + range_size - 1));
+            range_documents[range] = FindAllDocuments(std::execution::seq, query, range_filter, predicate, budget);
         });
+
+        std::vector<Document> matched_documents;
+        for (auto& documents : range_documents) {
+            matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+        }
         return matched_documents;
     }
 
-    [[nodiscard]] static bool IsValidWord(const std::string_view word);
+    /*
+     * Проверяет, что id достаточно плотные для массива по id в режиме COMPACT.
+     * Иначе поиск идёт точным способом.
+     */
+    bool HasDenseDocumentIds() const;
+
+    //Поиск сейчас считает релевантность способом ScoringMode::COMPACT
+    bool IsCompactScoring() const;
 
     std::string_view GetSourceView(std::string_view word) const;
 
+    template <typename ExPo, typename Predicate>
+    SearchPage FindPage(ExPo&& policy, const std::string_view raw_query, const DocumentFilter& filter,
+                        const Predicate predicate, const PageRequest& request) const {
+        QueryArena arena(query_arenas_);
+        Query query = ParseQuery(raw_query, arena.GetResource());
+        std::vector<Document> matched_documents = FindAllDocuments(policy, query, filter, predicate);
+
+        if (request.after) {
+            const Document& last = request.after->last_;
+            matched_documents.erase(
+                    std::remove_if(policy, matched_documents.begin(), matched_documents.end(),
+                                   [&last](const Document& document) {
+                return !IsDocumentBefore(last, document);
+            }), matched_documents.end());
+        }
+
+        const size_t total = matched_documents.size();
+        const size_t page_begin = std::min(request.offset, total);
+        const size_t page_end = std::min(page_begin + request.page_size, total);
+        SelectTopDocuments(policy, matched_documents, page_end);
+
+        SearchPage page;
+        page.documents.assign(matched_documents.begin() + page_begin, matched_documents.end());
+        if (page_end < total && !page.documents.empty()) {
+            page.next = SearchCursor(page.documents.back());
+        }
+        return page;
+    }
+
+
 };
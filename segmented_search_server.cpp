@@ -0,0 +1,258 @@
+#include "segmented_search_server.h"
+#include "string_processing.h"
+
+#include <algorithm>
+
+using namespace std;
+
+SegmentedSearchServer::SegmentedSearchServer(const string_view stop_text, SegmentPolicy policy)
+    : policy_(policy), mutable_segment_(policy.seal_document_count) {
+    for (const string_view word : SplitIntoWords(stop_text)) {
+        if (!SearchServer::IsValidWord(word)) {
+            throw invalid_argument("Stop word has an invalid entry!"s);
+        }
+        stop_words_.emplace(word);
+    }
+    if (policy_.seal_document_count == 0 || policy_.merge_factor < 2) {
+        throw invalid_argument("Invalid segment policy!"s);
+    }
+    if (policy_.background_merge) {
+        merger_ = thread([this]() {
+            RunMerger();
+        });
+    }
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+    if (merger_.joinable()) {
+        {
+            lock_guard lock(merge_mutex_);
+            stopping_ = true;
+        }
+        merge_cv_.notify_all();
+        merger_.join();
+    }
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, const string_view document, const DocumentStatus status,
+                                        const vector<int>& ratings) {
+    if (document_id < 0) {
+        throw invalid_argument("Negative document id = "s + to_string(document_id) + "!"s);
+    }
+    vector<string_view> words;
+    for (const string_view word : SplitIntoWords(document)) {
+        if (!SearchServer::IsValidWord(word)) {
+            throw invalid_argument("Word in adding document has an invalid entry!"s);
+        }
+        if (stop_words_.count(word) == 0) {
+            words.push_back(word);
+        }
+    }
+
+    const SegmentDocument segment_document{document_id, status, SearchServer::ComputeAverageRating(ratings)};
+    while (true) {
+        MutableSegment::AddResult result;
+        {
+            //Добавления идут параллельно под общей блокировкой, запечатанные сегменты при этом не меняются
+            shared_lock lock(mutex_);
+            result = HasSealedDocument(document_id) ? MutableSegment::AddResult::DUPLICATE
+                                                    : mutable_segment_.AddDocument(segment_document, words);
+        }
+        if (result == MutableSegment::AddResult::DUPLICATE) {
+            throw invalid_argument("Document with id = "s + to_string(document_id) + " already exists!"s);
+        }
+        if (result == MutableSegment::AddResult::ADDED) {
+            return;
+        }
+
+        unique_lock lock(mutex_);
+        //Сегмент мог запечатать другой поток, пока мы ждали блокировку
+        if (mutable_segment_.GetDocumentCount() >= policy_.seal_document_count) {
+            SealMutableSegment();
+        }
+        if (result == MutableSegment::AddResult::FILLED) {
+            return;
+        }
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+    {
+        //Удаление из изменяемого сегмента идёт параллельно с добавлениями под общей блокировкой
+        shared_lock lock(mutex_);
+        if (mutable_segment_.RemoveDocument(document_id) || !HasSealedDocument(document_id)) {
+            return;
+        }
+    }
+    //Пометки удаления запечатанных сегментов меняются только под исключительной блокировкой
+    unique_lock lock(mutex_);
+    for (const auto& segment : segments_) {
+        if (segment->RemoveDocument(document_id)) {
+            --sealed_document_count_;
+            return;
+        }
+    }
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(const string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, [status](int, const DocumentStatus doc_status, int) {
+        return doc_status == status;
+    });
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+    shared_lock lock(mutex_);
+    return sealed_document_count_ + mutable_segment_.GetLiveDocumentCount(mutable_segment_.GetPublishedSequence());
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const {
+    shared_lock lock(mutex_);
+    return segments_.size();
+}
+
+void SegmentedSearchServer::Flush() {
+    unique_lock lock(mutex_);
+    if (mutable_segment_.GetDocumentCount() > 0) {
+        SealMutableSegment();
+    }
+}
+
+void SegmentedSearchServer::WaitForMerges() {
+    if (!policy_.background_merge) {
+        return;
+    }
+    unique_lock lock(merge_mutex_);
+    merge_cv_.wait(lock, [this]() {
+        return !merge_requested_ && !merging_;
+    });
+}
+
+SegmentedSearchServer::Query SegmentedSearchServer::ParseQuery(const string_view text) const {
+    Query query;
+    for (string_view word : SplitIntoWords(text)) {
+        bool is_minus = false;
+        if (word[0] == '-') {
+            is_minus = true;
+            word.remove_prefix(1);
+        }
+        if (!SearchServer::IsValidWord(word)) {
+            throw invalid_argument(__FUNCTION__ + " invalid word error!"s);
+        }
+        if (stop_words_.count(word) > 0) {
+            continue;
+        }
+        (is_minus ? query.minus_words : query.plus_words).insert(word);
+    }
+    return query;
+}
+
+bool SegmentedSearchServer::HasSealedDocument(int document_id) const {
+    return any_of(segments_.begin(), segments_.end(), [document_id](const auto& segment) {
+        const uint32_t document = segment->FindDocument(document_id);
+        return document != IndexSegment::NOT_FOUND && !segment->IsDeleted(document);
+    });
+}
+
+void SegmentedSearchServer::SealMutableSegment() {
+    auto sealed = mutable_segment_.Seal();
+    mutable_segment_.Clear();
+    if (sealed->GetLiveDocumentCount() == 0) {
+        return;
+    }
+    sealed_document_count_ += sealed->GetLiveDocumentCount();
+    segments_.push_back(move(sealed));
+
+    if (policy_.background_merge) {
+        RequestMerge();
+        return;
+    }
+    while (const auto plan = PlanMerge()) {
+        CommitMerge(*plan, IndexSegment::Merge(plan->segments, plan->deleted, policy_.merge_order));
+    }
+}
+
+optional<SegmentedSearchServer::MergePlan> SegmentedSearchServer::PlanMerge() const {
+    //Уровень сегмента: log по основанию merge_factor от его размера в порогах запечатывания
+    map<int, vector<shared_ptr<IndexSegment>>> levels;
+    for (const auto& segment : segments_) {
+        int level = 0;
+        for (size_t size = policy_.seal_document_count * policy_.merge_factor;
+             segment->GetLiveDocumentCount() >= size; size *= policy_.merge_factor) {
+            ++level;
+        }
+        levels[level].push_back(segment);
+    }
+
+    for (auto& [_, level_segments] : levels) {
+        if (level_segments.size() < policy_.merge_factor) {
+            continue;
+        }
+        sort(level_segments.begin(), level_segments.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs->GetLiveDocumentCount() < rhs->GetLiveDocumentCount();
+        });
+        MergePlan plan;
+        plan.segments.assign(level_segments.begin(), level_segments.begin() + policy_.merge_factor);
+        for (const auto& segment : plan.segments) {
+            plan.deleted.push_back(segment->GetDeleted());
+        }
+        return plan;
+    }
+    return nullopt;
+}
+
+void SegmentedSearchServer::CommitMerge(const MergePlan& plan, shared_ptr<IndexSegment> merged) {
+    for (size_t i = 0; i < plan.segments.size(); ++i) {
+        const IndexSegment& segment = *plan.segments[i];
+        for (uint32_t document = 0; document < segment.GetDocumentCount(); ++document) {
+            if (segment.IsDeleted(document) && !plan.deleted[i][document]) {
+                merged->RemoveDocument(segment.GetDocument(document).id);
+            }
+        }
+        segments_.erase(find(segments_.begin(), segments_.end(), plan.segments[i]));
+    }
+    if (merged->GetLiveDocumentCount() > 0) {
+        segments_.push_back(move(merged));
+    }
+}
+
+void SegmentedSearchServer::RequestMerge() {
+    {
+        lock_guard lock(merge_mutex_);
+        merge_requested_ = true;
+    }
+    merge_cv_.notify_all();
+}
+
+void SegmentedSearchServer::RunMerger() {
+    unique_lock lock(merge_mutex_);
+    while (true) {
+        merge_cv_.wait(lock, [this]() {
+            return merge_requested_ || stopping_;
+        });
+        if (stopping_) {
+            return;
+        }
+        merge_requested_ = false;
+        merging_ = true;
+        lock.unlock();
+
+        while (true) {
+            optional<MergePlan> plan;
+            {
+                shared_lock index_lock(mutex_);
+                plan = PlanMerge();
+            }
+            if (!plan) {
+                break;
+            }
+            //Сегменты сливаются без блокировки: их данные неизменны, а удаления взяты из снимка
+            auto merged = IndexSegment::Merge(plan->segments, plan->deleted, policy_.merge_order);
+            unique_lock index_lock(mutex_);
+            CommitMerge(*plan, move(merged));
+        }
+
+        lock.lock();
+        merging_ = false;
+        merge_cv_.notify_all();
+    }
+}
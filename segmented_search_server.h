@@ -0,0 +1,247 @@
+#pragma once
+
+#include <cmath>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document_scratch.h"
+#include "index_segment.h"
+#include "search_server.h"
+
+struct SegmentPolicy {
+    //Число документов, при котором изменяемый сегмент запечатывается
+    size_t seal_document_count = 4096;
+    //Сколько сегментов одного уровня сливаются в один
+    size_t merge_factor = 4;
+    //Сливать сегменты в фоновом потоке, а не в потоке AddDocument
+    bool background_merge = true;
+    //Порядок документов в слитых сегментах; запечатанные сегменты всегда упорядочены по id
+    DocumentOrder merge_order = DocumentOrder::BY_SIMILARITY;
+};
+
+/*
+ * Поисковый сервер с индексом из сегментов.
+ * Новые документы попадают в небольшой изменяемый сегмент, который по достижении порога
+ * запечатывается в неизменяемый IndexSegment. Сегменты одного уровня (размера с точностью
+ * до merge_factor) сливаются в фоне. Запрос обходит все живые сегменты, IDF считается
+ * по общему числу документов, поэтому релевантность совпадает с SearchServer.
+ * AddDocument и RemoveDocument можно вызывать из нескольких потоков одновременно: добавления
+ * и удаления в изменяемом сегменте идут под общей блокировкой, исключительная берётся только
+ * для запечатывания и для удаления из запечатанных сегментов.
+ */
+class SegmentedSearchServer {
+public:
+    explicit SegmentedSearchServer(const std::string_view stop_text, SegmentPolicy policy = {});
+
+    ~SegmentedSearchServer();
+
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+    void AddDocument(int document_id, const std::string_view document, const DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    template <typename Predicate>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, const Predicate predicate) const {
+        const Query query = ParseQuery(raw_query);
+        std::vector<Document> matched_documents;
+        {
+            std::shared_lock lock(mutex_);
+            matched_documents = FindAllDocuments(query, predicate);
+        }
+        SearchServer::SelectTopDocuments(std::execution::seq, matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+        return matched_documents;
+    }
+
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    int GetDocumentCount() const;
+
+    //Число запечатанных сегментов
+    size_t GetSegmentCount() const;
+
+    /*
+     * Запечатывает изменяемый сегмент, не дожидаясь порога.
+     */
+    void Flush();
+
+    /*
+     * Ждёт, пока фоновый поток не сольёт все сегменты, подходящие под политику.
+     */
+    void WaitForMerges();
+
+private:
+    struct Query {
+        std::set<std::string_view> plus_words;
+        std::set<std::string_view> minus_words;
+    };
+
+    struct MergePlan {
+        std::vector<std::shared_ptr<IndexSegment>> segments;
+        std::vector<std::vector<bool>> deleted;
+    };
+
+    const SegmentPolicy policy_;
+    std::set<std::string, std::less<>> stop_words_;
+
+    mutable std::shared_mutex mutex_;
+    MutableSegment mutable_segment_;
+    std::vector<std::shared_ptr<IndexSegment>> segments_;
+    //Живые документы запечатанных сегментов
+    int sealed_document_count_ = 0;
+
+    std::mutex merge_mutex_;
+    std::condition_variable merge_cv_;
+    bool merge_requested_ = false;
+    bool merging_ = false;
+    bool stopping_ = false;
+    std::thread merger_;
+
+    Query ParseQuery(const std::string_view text) const;
+
+    //Есть ли живой документ в запечатанных сегментах. Вызывается под блокировкой mutex_.
+    bool HasSealedDocument(int document_id) const;
+
+    /*
+     * Запечатывает изменяемый сегмент. Вызывается под исключительной блокировкой mutex_.
+     */
+    void SealMutableSegment();
+
+    /*
+     * Выбирает сегменты для слияния: merge_factor самых маленьких сегментов одного уровня.
+     * Вызывается под блокировкой mutex_.
+     */
+    std::optional<MergePlan> PlanMerge() const;
+
+    /*
+     * Заменяет слитые сегменты результатом, перенося удаления, сделанные во время слияния.
+     * Вызывается под исключительной блокировкой mutex_.
+     */
+    void CommitMerge(const MergePlan& plan, std::shared_ptr<IndexSegment> merged);
+
+    void RequestMerge();
+
+    void RunMerger();
+
+    template <typename Predicate>
+    std::vector<Document> FindAllDocuments(const Query& query, const Predicate& predicate) const {
+        //Документы, опубликованные во время запроса, не учитываются ни в IDF, ни в выдаче
+        const uint64_t snapshot = mutable_segment_.GetPublishedSequence();
+        const int document_count = sealed_document_count_ + mutable_segment_.GetLiveDocumentCount(snapshot);
+        std::vector<std::pair<std::string_view, double>> word_idfs;
+        for (const std::string_view word : query.plus_words) {
+            if (query.minus_words.count(word) > 0) {
+                continue;
+            }
+            int word_count = mutable_segment_.GetDocumentFrequency(word, snapshot);
+            for (const auto& segment : segments_) {
+                const uint32_t term = segment->FindTerm(word);
+                if (term != IndexSegment::NOT_FOUND) {
+                    word_count += segment->GetDocumentFrequency(term);
+                }
+            }
+            if (word_count > 0) {
+                word_idfs.emplace_back(word, std::log(document_count * 1.0 / word_count));
+            }
+        }
+
+        std::vector<Document> matched_documents;
+        for (const auto& segment : segments_) {
+            FindSegmentDocuments(*segment, query, word_idfs, predicate, matched_documents);
+        }
+        FindMutableSegmentDocuments(query, snapshot, word_idfs, predicate, matched_documents);
+        return matched_documents;
+    }
+
+    template <typename Predicate>
+    static void FindSegmentDocuments(const IndexSegment& segment, const Query& query,
+                                     const std::vector<std::pair<std::string_view, double>>& word_idfs,
+                                     const Predicate& predicate, std::vector<Document>& matched_documents) {
+        DocumentScratch& scratch = DocumentScratch::Acquire(segment.GetDocumentCount());
+        for (const std::string_view word : query.minus_words) {
+            const uint32_t term = segment.FindTerm(word);
+            if (term == IndexSegment::NOT_FOUND) {
+                continue;
+            }
+            for (const IndexSegment::Posting& posting : segment.GetPostings(term)) {
+                scratch.SetState(posting.document, DocumentScratch::REJECTED);
+            }
+        }
+
+        for (const auto& [word, inverse_document_freq] : word_idfs) {
+            const uint32_t term = segment.FindTerm(word);
+            if (term == IndexSegment::NOT_FOUND) {
+                continue;
+            }
+            for (const IndexSegment::Posting& posting : segment.GetPostings(term)) {
+                DocumentScratch::State state = scratch.GetState(posting.document);
+                if (state == DocumentScratch::UNSEEN) {
+                    const SegmentDocument& document = segment.GetDocument(posting.document);
+                    state = !segment.IsDeleted(posting.document)
+                            && predicate(document.id, document.status, document.rating)
+                            ? DocumentScratch::MATCHED : DocumentScratch::REJECTED;
+                    scratch.SetState(posting.document, state);
+                }
+                if (state == DocumentScratch::MATCHED) {
+                    scratch.AddRelevance(posting.document, posting.term_freq * inverse_document_freq);
+                }
+            }
+        }
+
+        //Документы сегмента по возрастанию номеров, как при обходе всего сегмента
+        scratch.SortTouched();
+        for (const uint32_t document : scratch.GetTouched()) {
+            if (scratch.GetState(document) == DocumentScratch::MATCHED) {
+                const SegmentDocument& attributes = segment.GetDocument(document);
+                matched_documents.emplace_back(attributes.id, scratch.GetRelevance(document), attributes.rating);
+            }
+        }
+    }
+
+    template <typename Predicate>
+    void FindMutableSegmentDocuments(const Query& query, const uint64_t snapshot,
+                                     const std::vector<std::pair<std::string_view, double>>& word_idfs,
+                                     const Predicate& predicate, std::vector<Document>& matched_documents) const {
+        std::set<int> rejected;
+        for (const std::string_view word : query.minus_words) {
+            mutable_segment_.ForEachPosting(word, snapshot, [&rejected](const SegmentDocument& document, double) {
+                rejected.insert(document.id);
+            });
+        }
+
+        std::map<int, Document> document_to_relevance;
+        for (const auto& [word, inverse_document_freq] : word_idfs) {
+            mutable_segment_.ForEachPosting(word, snapshot, [&, idf = inverse_document_freq](
+                    const SegmentDocument& document, const double term_freq) {
+                if (rejected.count(document.id) > 0) {
+                    return;
+                }
+                auto it = document_to_relevance.find(document.id);
+                if (it == document_to_relevance.end()) {
+                    if (!predicate(document.id, document.status, document.rating)) {
+                        rejected.insert(document.id);
+                        return;
+                    }
+                    it = document_to_relevance.emplace(document.id, Document{document.id, 0.0, document.rating}).first;
+                }
+                it->second.relevance += term_freq * idf;
+            });
+        }
+
+        for (const auto& [_, document] : document_to_relevance) {
+            matched_documents.push_back(document);
+        }
+    }
+};
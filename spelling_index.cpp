@@ -0,0 +1,140 @@
+#include "spelling_index.h"
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <functional>
+#include <numeric>
+
+using namespace std;
+
+namespace {
+
+/*
+ * Удаляет из word по одному символу с позиции first и дальше, не больше depth раз подряд,
+ * и добавляет хеши всех получившихся строк. Позиции удалений не убывают, поэтому каждый
+ * набор удалённых позиций перебирается один раз. Буфер word возвращается в исходное состояние.
+ */
+void CollectDeleteHashes(string& word, const size_t first, const int depth, vector<uint64_t>& hashes) {
+    if (depth == 0) {
+        return;
+    }
+    for (size_t i = first; i < word.size(); ++i) {
+        const char removed = word[i];
+        word.erase(i, 1);
+        hashes.push_back(hash<string_view>{}(word));
+        CollectDeleteHashes(word, i, depth - 1, hashes);
+        word.insert(i, 1, removed);
+    }
+}
+
+}
+
+void SpellingIndex::AddTerm(const uint32_t term, const string_view word) {
+    for (const uint64_t hash : ComputeDeleteHashes(word)) {
+        deletes_.emplace(hash, term);
+    }
+}
+
+void SpellingIndex::RemoveTerm(const uint32_t term, const string_view word) {
+    for (const uint64_t hash : ComputeDeleteHashes(word)) {
+        auto [it, end] = deletes_.equal_range(hash);
+        while (it != end) {
+            it = it->second == term ? deletes_.erase(it) : next(it);
+        }
+    }
+}
+
+vector<pair<uint32_t, int>> SpellingIndex::FindCandidates(const string_view word, const TermDictionary& terms) const {
+    vector<uint32_t> matched_terms;
+    for (const uint64_t hash : ComputeDeleteHashes(word)) {
+        const auto [begin, end] = deletes_.equal_range(hash);
+        for (auto it = begin; it != end; ++it) {
+            matched_terms.push_back(it->second);
+        }
+    }
+    sort(matched_terms.begin(), matched_terms.end());
+    matched_terms.erase(unique(matched_terms.begin(), matched_terms.end()), matched_terms.end());
+
+    vector<pair<uint32_t, int>> candidates;
+    for (const uint32_t term : matched_terms) {
+        const int distance = ComputeEditDistance(word, terms.GetTerm(term), MAX_EDIT_DISTANCE);
+        if (distance > 0 && distance <= MAX_EDIT_DISTANCE) {
+            candidates.emplace_back(term, distance);
+        }
+    }
+    return candidates;
+}
+
+int SpellingIndex::ComputeEditDistance(string_view lhs, string_view rhs, const int max_distance) {
+    if (abs(static_cast<int>(lhs.size()) - static_cast<int>(rhs.size())) > max_distance) {
+        return max_distance + 1;
+    }
+    //Общие начало и конец на расстояние не влияют, а у слова с опечаткой и кандидата они обычно длинные
+    while (!lhs.empty() && !rhs.empty() && lhs.front() == rhs.front()) {
+        lhs.remove_prefix(1);
+        rhs.remove_prefix(1);
+    }
+    while (!lhs.empty() && !rhs.empty() && lhs.back() == rhs.back()) {
+        lhs.remove_suffix(1);
+        rhs.remove_suffix(1);
+    }
+    //Три строки матрицы: две предыдущие нужны для перестановки соседних символов.
+    //Для обычных слов строки лежат на стеке, подбор исправлений не выделяет память на каждого кандидата
+    constexpr size_t STACK_ROW_SIZE = 64;
+    array<int, 3 * STACK_ROW_SIZE> stack_rows;
+    vector<int> heap_rows;
+    int* rows = stack_rows.data();
+    if (rhs.size() + 1 > STACK_ROW_SIZE) {
+        heap_rows.resize(3 * (rhs.size() + 1));
+        rows = heap_rows.data();
+    }
+    int* before_previous = rows;
+    int* previous = rows + rhs.size() + 1;
+    int* current = rows + 2 * (rhs.size() + 1);
+    //Считается только полоса |i - j| <= max_distance: клетки вне её заведомо больше max_distance
+    const int too_far = max_distance + 1;
+    const size_t band = static_cast<size_t>(max_distance);
+    for (size_t j = 0; j <= rhs.size(); ++j) {
+        previous[j] = min(static_cast<int>(j), too_far);
+    }
+    for (size_t i = 1; i <= lhs.size(); ++i) {
+        const size_t first = i > band ? i - band : 1;
+        const size_t last = min(rhs.size(), i + band);
+        current[first - 1] = first == 1 ? min(static_cast<int>(i), too_far) : too_far;
+        int row_min = current[first - 1];
+        for (size_t j = first; j <= last; ++j) {
+            const int cost = lhs[i - 1] == rhs[j - 1] ? 0 : 1;
+            current[j] = min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+            if (i > 1 && j > 1 && lhs[i - 1] == rhs[j - 2] && lhs[i - 2] == rhs[j - 1]) {
+                current[j] = min(current[j], before_previous[j - 2] + 1);
+            }
+            row_min = min(row_min, current[j]);
+        }
+        if (last < rhs.size()) {
+            current[last + 1] = too_far;
+        }
+        //Расстояние не меньше минимума строки, дальше считать незачем
+        if (row_min > max_distance) {
+            return too_far;
+        }
+        swap(before_previous, previous);
+        swap(previous, current);
+    }
+    return min(previous[rhs.size()], too_far);
+}
+
+size_t SpellingIndex::GetMemoryUsage() const {
+    return memory_usage::HeapBytes(deletes_);
+}
+
+vector<uint64_t> SpellingIndex::ComputeDeleteHashes(const string_view word) {
+    string buffer(word);
+    vector<uint64_t> hashes = {hash<string_view>{}(buffer)};
+    CollectDeleteHashes(buffer, 0, MAX_EDIT_DISTANCE, hashes);
+    //Одно удаление получается разными путями, если в слове есть повторы символов
+    sort(hashes.begin(), hashes.end());
+    hashes.erase(unique(hashes.begin(), hashes.end()), hashes.end());
+    return hashes;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "term_dictionary.h"
+
+/*
+ * Индекс исправлений опечаток по словарю терминов, алгоритм symmetric delete (как в SymSpell).
+ * Для каждого термина хранятся хеши строк, получаемых из него удалением не больше
+ * MAX_EDIT_DISTANCE символов. Слово запроса порождает такие же удаления, а термины
+ * с совпавшими хешами проверяются точным расстоянием Дамерау-Левенштейна
+ * (вставка, удаление, замена и перестановка соседних символов), так что коллизии хешей безвредны.
+ * Термин индексируется один раз при появлении в словаре, поэтому после того, как словарь
+ * наполнился, добавление документов индекс почти не затрагивает.
+ */
+class SpellingIndex {
+public:
+    static constexpr int MAX_EDIT_DISTANCE = 2;
+
+    void AddTerm(uint32_t term, std::string_view word);
+
+    void RemoveTerm(uint32_t term, std::string_view word);
+
+    /*
+     * Термины словаря terms на расстоянии от 1 до MAX_EDIT_DISTANCE от word
+     * и эти расстояния, в произвольном порядке.
+     */
+    std::vector<std::pair<uint32_t, int>> FindCandidates(std::string_view word, const TermDictionary& terms) const;
+
+    /*
+     * Расстояние Дамерау-Левенштейна между lhs и rhs или max_distance + 1, если оно больше max_distance.
+     */
+    static int ComputeEditDistance(std::string_view lhs, std::string_view rhs, int max_distance);
+
+    size_t GetMemoryUsage() const;
+
+private:
+    //Хеш строки-удаления -> термин; один термин встречается под каждым своим удалением
+    std::unordered_multimap<uint64_t, uint32_t> deletes_;
+
+    //Хеши всех различных удалений word, включая саму word
+    static std::vector<uint64_t> ComputeDeleteHashes(std::string_view word);
+};
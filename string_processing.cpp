@@ -20,3 +20,17 @@ std::vector<std::string_view> SplitIntoWords(std::string_view text) {
 
     return words;
 }
+
+size_t CountWords(std::string_view text) {
+    size_t count = 0;
+    bool in_word = false;
+    for (const char c : text) {
+        if (c == ' ') {
+            in_word = false;
+        } else if (!in_word) {
+            in_word = true;
+            ++count;
+        }
+    }
+    return count;
+}
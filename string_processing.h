@@ -8,3 +8,6 @@
 #include <execution>
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
+
+//Число слов, на которые SplitIntoWords разбил бы text, без выделения памяти
+size_t CountWords(std::string_view text);
@@ -0,0 +1,151 @@
+#include "term_dictionary.h"
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+uint32_t TermDictionary::Find(const string_view term) const {
+    const auto sorted_it = lower_bound(sorted_.begin(), sorted_.end(), term,
+                                       [this](const uint32_t id, const string_view value) {
+        return terms_[id] < value;
+    });
+    if (sorted_it != sorted_.end() && terms_[*sorted_it] == term) {
+        return *sorted_it;
+    }
+    const auto recent_it = recent_.find(term);
+    return recent_it == recent_.end() ? NO_TERM : recent_it->second;
+}
+
+uint32_t TermDictionary::Insert(const string_view term) {
+    const uint32_t existing = Find(term);
+    if (existing != NO_TERM) {
+        return existing;
+    }
+    const string_view stored = StoreTerm(term);
+    uint32_t id;
+    if (free_ids_.empty()) {
+        id = static_cast<uint32_t>(terms_.size());
+        terms_.push_back(stored);
+    } else {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+        terms_[id] = stored;
+    }
+    recent_.emplace(stored, id);
+    if (recent_.size() > max(MIN_RECENT_SIZE, sorted_.size() / 16)) {
+        MergeRecent();
+    }
+    return id;
+}
+
+void TermDictionary::Erase(const vector<uint32_t>& ids) {
+    if (ids.empty()) {
+        return;
+    }
+    //Несколько терминов проще найти в sorted_ бинарным поиском, чем проходить весь массив
+    const bool few = ids.size() * 64 < sorted_.size();
+    vector<bool> erased(few ? 0 : terms_.size(), false);
+    for (const uint32_t id : ids) {
+        const string_view term = terms_[id];
+        if (recent_.erase(term) == 0 && few) {
+            sorted_.erase(lower_bound(sorted_.begin(), sorted_.end(), term,
+                                      [this](const uint32_t sorted_id, const string_view value) {
+                return terms_[sorted_id] < value;
+            }));
+        }
+        //Блоки выделены как изменяемая память, const снимается только у string_view
+        free_slots_[term.size()].push_back(const_cast<char*>(term.data()));
+        terms_[id] = {};
+        if (!few) {
+            erased[id] = true;
+        }
+        free_ids_.push_back(id);
+    }
+    if (!few) {
+        sorted_.erase(remove_if(sorted_.begin(), sorted_.end(), [&erased](const uint32_t id) {
+            return erased[id];
+        }), sorted_.end());
+    }
+}
+
+vector<unique_ptr<char[]>> TermDictionary::ShrinkStorage() {
+    vector<unique_ptr<char[]>> old_blocks = move(blocks_);
+    blocks_.clear();
+    block_used_ = BLOCK_SIZE;
+    arena_bytes_ = 0;
+    free_slots_.clear();
+
+    for (string_view& term : terms_) {
+        if (!term.empty()) {
+            term = StoreTerm(term);
+        }
+    }
+
+    map<string_view, uint32_t> recent;
+    for (const auto& [_, id] : recent_) {
+        recent.emplace(terms_[id], id);
+    }
+    recent_ = move(recent);
+    return old_blocks;
+}
+
+string_view TermDictionary::StoreTerm(const string_view term) {
+    if (const auto slots = free_slots_.find(term.size()); slots != free_slots_.end()) {
+        char* dest = slots->second.back();
+        slots->second.pop_back();
+        if (slots->second.empty()) {
+            free_slots_.erase(slots);
+        }
+        memcpy(dest, term.data(), term.size());
+        return {dest, term.size()};
+    }
+    if (term.size() > BLOCK_SIZE) {
+        blocks_.push_back(make_unique<char[]>(term.size()));
+        arena_bytes_ += term.size();
+        memcpy(blocks_.back().get(), term.data(), term.size());
+        //Отдельный блок заполнен целиком, следующий термин начнёт новый
+        block_used_ = BLOCK_SIZE;
+        return {blocks_.back().get(), term.size()};
+    }
+    if (block_used_ + term.size() > BLOCK_SIZE) {
+        blocks_.push_back(make_unique<char[]>(BLOCK_SIZE));
+        arena_bytes_ += BLOCK_SIZE;
+        block_used_ = 0;
+    }
+    char* dest = blocks_.back().get() + block_used_;
+    memcpy(dest, term.data(), term.size());
+    block_used_ += term.size();
+    return {dest, term.size()};
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+    size_t free_slot_bytes = memory_usage::HeapBytes(free_slots_);
+    for (const auto& [_, slots] : free_slots_) {
+        free_slot_bytes += memory_usage::HeapBytes(slots);
+    }
+    return arena_bytes_ + free_slot_bytes
+           + memory_usage::HeapBytes(blocks_)
+           + memory_usage::HeapBytes(terms_)
+           + memory_usage::HeapBytes(sorted_)
+           + memory_usage::HeapBytes(recent_)
+           + memory_usage::HeapBytes(free_ids_);
+}
+
+void TermDictionary::MergeRecent() {
+    vector<uint32_t> merged;
+    merged.reserve(sorted_.size() + recent_.size());
+    auto recent_it = recent_.begin();
+    for (const uint32_t id : sorted_) {
+        while (recent_it != recent_.end() && recent_it->first < terms_[id]) {
+            merged.push_back((recent_it++)->second);
+        }
+        merged.push_back(id);
+    }
+    for (; recent_it != recent_.end(); ++recent_it) {
+        merged.push_back(recent_it->second);
+    }
+    sorted_ = move(merged);
+    recent_.clear();
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/*
+ * Компактный сортированный словарь терминов.
+ * Каждому термину присваивается плотный номер, по которому хранятся его постинги.
+ * Строки лежат подряд в блоках, которые перемещает только явный вызов ShrinkStorage, поэтому
+ * string_view на живые термины остаются действительными до него. Место удалённого термина
+ * занимает следующий добавленный термин той же длины.
+ * Порядок терминов хранится в отсортированном массиве номеров и небольшом буфере
+ * недавно добавленных терминов, который периодически вливается в массив.
+ */
+class TermDictionary {
+public:
+    static constexpr uint32_t NO_TERM = UINT32_MAX;
+
+    TermDictionary() = default;
+    TermDictionary(const TermDictionary&) = delete;
+    TermDictionary& operator=(const TermDictionary&) = delete;
+    TermDictionary(TermDictionary&&) = default;
+    TermDictionary& operator=(TermDictionary&&) = default;
+
+    /*
+     * Возвращает номер термина или NO_TERM, если его нет в словаре.
+     */
+    uint32_t Find(std::string_view term) const;
+
+    /*
+     * Добавляет термин, если его ещё нет, и возвращает его номер.
+     * Номера удалённых терминов используются повторно.
+     */
+    uint32_t Insert(std::string_view term);
+
+    /*
+     * Удаляет термины с номерами ids. Место их строк переходит новым терминам той же длины,
+     * а целиком возвращается только в ShrinkStorage.
+     */
+    void Erase(const std::vector<uint32_t>& ids);
+
+    /*
+     * Переписывает строки живых терминов в новые блоки.
+     * Старые блоки возвращаются вызывающему: string_view на них остаются действительными,
+     * пока он не заменит их новыми через GetTerm(Find(word)).
+     */
+    [[nodiscard]] std::vector<std::unique_ptr<char[]>> ShrinkStorage();
+
+    std::string_view GetTerm(uint32_t id) const {
+        return terms_[id];
+    }
+
+    //Число живых терминов
+    size_t size() const {
+        return terms_.size() - free_ids_.size();
+    }
+
+    /*
+     * Память в куче, занятая словарём, в байтах.
+     */
+    size_t GetMemoryUsage() const;
+
+    /*
+     * Вызывает func(id) для не более чем limit терминов с префиксом prefix
+     * в лексикографическом порядке. Стоимость O(log N + число найденных терминов).
+     */
+    template <typename Func>
+    void ForEachWithPrefix(std::string_view prefix, size_t limit, Func func) const {
+        ForEachWithPrefix(prefix, limit, [](uint32_t) { return false; }, func);
+    }
+
+    /*
+     * То же, но термины, для которых skip(id) истинно, пропускаются и не входят в limit.
+     */
+    template <typename Skip, typename Func>
+    void ForEachWithPrefix(std::string_view prefix, size_t limit, Skip skip, Func func) const {
+        auto sorted_it = std::lower_bound(sorted_.begin(), sorted_.end(), prefix,
+                                          [this](const uint32_t id, const std::string_view value) {
+            return terms_[id] < value;
+        });
+        auto recent_it = recent_.lower_bound(prefix);
+
+        const auto has_prefix = [prefix](const std::string_view term) {
+            return term.substr(0, prefix.size()) == prefix;
+        };
+        for (size_t count = 0; count < limit;) {
+            const bool sorted_ok = sorted_it != sorted_.end() && has_prefix(terms_[*sorted_it]);
+            const bool recent_ok = recent_it != recent_.end() && has_prefix(recent_it->first);
+            uint32_t id;
+            if (sorted_ok && (!recent_ok || terms_[*sorted_it] < recent_it->first)) {
+                id = *sorted_it++;
+            } else if (recent_ok) {
+                id = (recent_it++)->second;
+            } else {
+                break;
+            }
+            if (!skip(id)) {
+                func(id);
+                ++count;
+            }
+        }
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    static constexpr size_t MIN_RECENT_SIZE = 256;
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    size_t block_used_ = BLOCK_SIZE;
+    size_t arena_bytes_ = 0;
+    //Места строк удалённых терминов по длине
+    std::map<size_t, std::vector<char*>> free_slots_;
+
+    std::vector<std::string_view> terms_;
+    std::vector<uint32_t> sorted_;
+    std::map<std::string_view, uint32_t> recent_;
+    std::vector<uint32_t> free_ids_;
+
+    std::string_view StoreTerm(std::string_view term);
+
+    void MergeRecent();
+};
@@ -0,0 +1,242 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+namespace tracing {
+
+namespace {
+
+struct ThreadBuffer {
+    explicit ThreadBuffer(uint32_t id) : thread_id(id) {
+    }
+
+    const uint32_t thread_id;
+    //Пишет только свой поток, так что мьютекс захватывается без конкуренции, кроме моментов выгрузки
+    mutex events_mutex;
+    vector<TraceEvent> events;
+    //Куда пишется следующий интервал, когда буфер заполнен
+    size_t next = 0;
+    //Поток буфера завершился, и буфер можно отдать новому потоку. Защищён State::state_mutex
+    bool orphaned = false;
+};
+
+struct State {
+    atomic<uint64_t> slow_query_threshold_ns{10'000'000};
+    atomic<uint64_t> slow_query_sampling{1};
+    atomic<uint64_t> slow_query_count{0};
+    const chrono::steady_clock::time_point origin = chrono::steady_clock::now();
+
+    mutex state_mutex;
+    //Буферы переживают свои потоки, чтобы интервалы завершившихся потоков попали в выгрузку.
+    //Буфер завершившегося потока достаётся следующему новому потоку вместе с номером,
+    //так что буферов не больше, чем потоков, одновременно писавших интервалы
+    vector<shared_ptr<ThreadBuffer>> buffers;
+    deque<SlowQuery> slow_queries;
+};
+
+State& GetState() {
+    static State state;
+    return state;
+}
+
+#if SEARCH_SERVER_TRACING
+
+//Буфер потока: берётся при первом интервале потока и освобождается при его завершении
+class ThreadBufferHolder {
+public:
+    ThreadBufferHolder() {
+        State& state = GetState();
+        lock_guard guard(state.state_mutex);
+        const auto orphaned = find_if(state.buffers.begin(), state.buffers.end(), [](const auto& buffer) {
+            return buffer->orphaned;
+        });
+        if (orphaned != state.buffers.end()) {
+            buffer_ = *orphaned;
+            buffer_->orphaned = false;
+        } else {
+            state.buffers.push_back(make_shared<ThreadBuffer>(static_cast<uint32_t>(state.buffers.size() + 1)));
+            buffer_ = state.buffers.back();
+        }
+    }
+
+    ThreadBufferHolder(const ThreadBufferHolder&) = delete;
+    ThreadBufferHolder& operator=(const ThreadBufferHolder&) = delete;
+
+    ~ThreadBufferHolder() {
+        State& state = GetState();
+        lock_guard guard(state.state_mutex);
+        buffer_->orphaned = true;
+    }
+
+    ThreadBuffer& Get() const {
+        return *buffer_;
+    }
+
+private:
+    shared_ptr<ThreadBuffer> buffer_;
+};
+
+ThreadBuffer& GetThreadBuffer() {
+    thread_local const ThreadBufferHolder holder;
+    return holder.Get();
+}
+
+#endif
+
+void WriteMicroseconds(ostream& out, const uint64_t ns) {
+    out << ns / 1000 << '.' << setw(3) << setfill('0') << ns % 1000 << setfill(' ');
+}
+
+void WriteJsonString(ostream& out, const string_view str) {
+    out << '"';
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u"s << hex << setw(4) << setfill('0') << static_cast<int>(c) << dec << setfill(' ');
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+void WriteEvent(ostream& out, const TraceEvent& event, const char* category) {
+    out << "{\"name\":"s;
+    WriteJsonString(out, event.name);
+    out << ",\"cat\":\""s << category << "\",\"ph\":\"X\",\"ts\":"s;
+    WriteMicroseconds(out, event.start_ns);
+    out << ",\"dur\":"s;
+    WriteMicroseconds(out, event.duration_ns);
+    out << ",\"pid\":1,\"tid\":"s << event.thread_id;
+}
+
+}
+
+void SetSlowQueryThreshold(const chrono::nanoseconds threshold) {
+    GetState().slow_query_threshold_ns.store(max<int64_t>(threshold.count(), 0), memory_order_relaxed);
+}
+
+void SetSlowQuerySampling(const uint64_t every) {
+    GetState().slow_query_sampling.store(max<uint64_t>(every, 1), memory_order_relaxed);
+}
+
+vector<TraceEvent> CollectEvents() {
+    State& state = GetState();
+    vector<shared_ptr<ThreadBuffer>> buffers;
+    {
+        lock_guard guard(state.state_mutex);
+        buffers = state.buffers;
+    }
+    vector<TraceEvent> events;
+    for (const auto& buffer : buffers) {
+        lock_guard guard(buffer->events_mutex);
+        events.insert(events.end(), buffer->events.begin(), buffer->events.end());
+    }
+    sort(events.begin(), events.end(), [](const TraceEvent& lhs, const TraceEvent& rhs) {
+        return lhs.start_ns < rhs.start_ns;
+    });
+    return events;
+}
+
+vector<SlowQuery> GetSlowQueries() {
+    State& state = GetState();
+    lock_guard guard(state.state_mutex);
+    return {state.slow_queries.begin(), state.slow_queries.end()};
+}
+
+void Clear() {
+    State& state = GetState();
+    lock_guard guard(state.state_mutex);
+    for (const auto& buffer : state.buffers) {
+        lock_guard buffer_guard(buffer->events_mutex);
+        buffer->events.clear();
+        buffer->next = 0;
+    }
+    state.slow_queries.clear();
+    state.slow_query_count.store(0, memory_order_relaxed);
+}
+
+void WriteChromeTrace(ostream& out) {
+    out << "{\"traceEvents\":["s;
+    bool first = true;
+    for (const TraceEvent& event : CollectEvents()) {
+        out << (first ? "\n"s : ",\n"s);
+        first = false;
+        WriteEvent(out, event, "search");
+        out << '}';
+    }
+    for (const SlowQuery& slow_query : GetSlowQueries()) {
+        out << (first ? "\n"s : ",\n"s);
+        first = false;
+        TraceEvent event = slow_query.event;
+        event.name = "slow query";
+        WriteEvent(out, event, "slow");
+        out << ",\"args\":{\"operation\":"s;
+        WriteJsonString(out, slow_query.event.name);
+        out << ",\"query\":"s;
+        WriteJsonString(out, slow_query.query);
+        out << ",\"postings\":"s << slow_query.counters.postings
+            << ",\"minus_words\":"s << slow_query.counters.minus_words
+            << ",\"candidates\":"s << slow_query.counters.candidates
+            << ",\"results\":"s << slow_query.counters.results << "}}"s;
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n"s;
+}
+
+#if SEARCH_SERVER_TRACING
+
+uint64_t Now() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - GetState().origin).count();
+}
+
+void Record(const TraceEvent& event) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    lock_guard guard(buffer.events_mutex);
+    if (buffer.events.size() < RING_CAPACITY) {
+        buffer.events.push_back(event);
+        buffer.events.back().thread_id = buffer.thread_id;
+        return;
+    }
+    buffer.events[buffer.next] = event;
+    buffer.events[buffer.next].thread_id = buffer.thread_id;
+    buffer.next = (buffer.next + 1) % RING_CAPACITY;
+}
+
+void RecordSlowQuery(const TraceEvent& event, const string_view query, const QueryCounters& counters) {
+    State& state = GetState();
+    SlowQuery slow_query{event, string(query), counters};
+    slow_query.event.thread_id = GetThreadBuffer().thread_id;
+    lock_guard guard(state.state_mutex);
+    state.slow_queries.push_back(move(slow_query));
+    if (state.slow_queries.size() > SLOW_QUERY_CAPACITY) {
+        state.slow_queries.pop_front();
+    }
+}
+
+QueryTrace::~QueryTrace() {
+    if (!active_) {
+        return;
+    }
+    const TraceEvent event{name_, start_ns_, Now() - start_ns_, 0};
+    Record(event);
+    State& state = GetState();
+    if (event.duration_ns < state.slow_query_threshold_ns.load(memory_order_relaxed)) {
+        return;
+    }
+    const uint64_t index = state.slow_query_count.fetch_add(1, memory_order_relaxed);
+    if (index % state.slow_query_sampling.load(memory_order_relaxed) == 0) {
+        RecordSlowQuery(event, query_, counters_);
+    }
+}
+
+#endif
+
+}
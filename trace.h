@@ -0,0 +1,189 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Трассировка запросов. TRACE_SPAN(name) отмечает интервал от объявления до конца области;
+ * интервалы пишутся в кольцевой буфер своего потока и выгружаются в формате Chrome trace
+ * (chrome://tracing, Perfetto). Медленные запросы дополнительно попадают в журнал с текстом
+ * запроса и счётчиками работы, каждый N-й из них, см. SetSlowQuerySampling.
+ * Буфер завершившегося потока вместе с его номером переходит к следующему новому потоку,
+ * поэтому буферов не больше, чем потоков, писавших интервалы одновременно.
+ * Сборка с -DSEARCH_SERVER_TRACING=0 убирает трассировку из кода совсем; в остальных сборках
+ * выключенная трассировка (по умолчанию) стоит одно чтение атомарного флага на интервал.
+ * Имена интервалов - строковые литералы: буфер хранит указатель, а не копию.
+ */
+#ifndef SEARCH_SERVER_TRACING
+#define SEARCH_SERVER_TRACING 1
+#endif
+
+#define TRACE_CONCAT_INTERNAL(X, Y) X ## Y
+#define TRACE_CONCAT(X, Y) TRACE_CONCAT_INTERNAL(X, Y)
+#define TRACE_SPAN(name) tracing::Span TRACE_CONCAT(traceSpan, __LINE__)(name)
+
+namespace tracing {
+
+//Сколько последних интервалов хранит буфер одного потока
+constexpr size_t RING_CAPACITY = 16384;
+//Сколько последних медленных запросов хранит журнал
+constexpr size_t SLOW_QUERY_CAPACITY = 256;
+
+struct TraceEvent {
+    const char* name = "";
+    //Время от начала трассировки процесса
+    uint64_t start_ns = 0;
+    uint64_t duration_ns = 0;
+    uint32_t thread_id = 0;
+};
+
+/*
+ * Работа, проделанная запросом.
+ */
+struct QueryCounters {
+    //Постинги плюс-слов, которые обходит поиск
+    size_t postings = 0;
+    size_t minus_words = 0;
+    //Документы, получившие релевантность, до отбора лучших
+    size_t candidates = 0;
+    size_t results = 0;
+};
+
+struct SlowQuery {
+    TraceEvent event;
+    std::string query;
+    QueryCounters counters;
+};
+
+//Флаг в заголовке, чтобы проверка в каждом интервале встраивалась в место вызова
+inline std::atomic<bool> enabled{false};
+
+inline void SetEnabled(bool value) {
+    enabled.store(value, std::memory_order_relaxed);
+}
+
+inline bool IsEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+/*
+ * Запросы не быстрее threshold считаются медленными. По умолчанию 10 мс.
+ */
+void SetSlowQueryThreshold(std::chrono::nanoseconds threshold);
+
+/*
+ * В журнал попадает каждый every-й медленный запрос. По умолчанию каждый.
+ */
+void SetSlowQuerySampling(uint64_t every);
+
+/*
+ * Интервалы всех потоков по времени начала.
+ */
+std::vector<TraceEvent> CollectEvents();
+
+/*
+ * Медленные запросы от старых к новым.
+ */
+std::vector<SlowQuery> GetSlowQueries();
+
+/*
+ * Очищает буферы интервалов и журнал медленных запросов.
+ */
+void Clear();
+
+/*
+ * Интервалы и медленные запросы в JSON формата Chrome trace. Медленные запросы - отдельные
+ * интервалы "slow query" с текстом и счётчиками в args.
+ */
+void WriteChromeTrace(std::ostream& out);
+
+#if SEARCH_SERVER_TRACING
+
+uint64_t Now();
+
+void Record(const TraceEvent& event);
+
+void RecordSlowQuery(const TraceEvent& event, std::string_view query, const QueryCounters& counters);
+
+class Span {
+public:
+    explicit Span(const char* name) : name_(name), active_(IsEnabled()), start_ns_(active_ ? Now() : 0) {
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    ~Span() {
+        if (active_) {
+            Record({name_, start_ns_, Now() - start_ns_, 0});
+        }
+    }
+
+private:
+    const char* name_;
+    bool active_;
+    uint64_t start_ns_;
+};
+
+/*
+ * Интервал запроса: кроме записи в буфер, проверяет, не медленный ли запрос.
+ * Текст запроса копируется только в журнал медленных, поэтому raw_query должен жить до конца области.
+ */
+class QueryTrace {
+public:
+    QueryTrace(const char* name, std::string_view raw_query)
+        : name_(name), query_(raw_query), active_(IsEnabled()), start_ns_(active_ ? Now() : 0) {
+    }
+
+    QueryTrace(const QueryTrace&) = delete;
+    QueryTrace& operator=(const QueryTrace&) = delete;
+
+    ~QueryTrace();
+
+    //Счётчики стоит считать, только если трассировка идёт
+    bool IsActive() const {
+        return active_;
+    }
+
+    void SetCounters(const QueryCounters& counters) {
+        counters_ = counters;
+    }
+
+private:
+    const char* name_;
+    std::string_view query_;
+    bool active_;
+    uint64_t start_ns_;
+    QueryCounters counters_;
+};
+
+#else
+
+class Span {
+public:
+    explicit Span(const char*) {
+    }
+};
+
+class QueryTrace {
+public:
+    QueryTrace(const char*, std::string_view) {
+    }
+
+    constexpr bool IsActive() const {
+        return false;
+    }
+
+    void SetCounters(const QueryCounters&) {
+    }
+};
+
+#endif
+
+}
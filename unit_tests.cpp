@@ -1,7 +1,33 @@
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory_resource>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <thread>
 #include <string_view>
 #include "unit_tests.h"
 #include "testing_framework.h"
 #include "search_server.h"
+#include "paginator.h"
+#include "term_dictionary.h"
+#include "memory_usage.h"
+#include "segmented_search_server.h"
+#include "benchmark.h"
+#include "durable_search_server.h"
+#include "corpus_loader.h"
+#include "scoring_kernels.h"
+#include "process_queries.h"
+#include "query_server.h"
+#include "load_generator.h"
+#include "concurrent_hash_map.h"
+#include "frozen_search_server.h"
+#include "posting_intersection.h"
+#include "remove_duplicates.h"
+#include "trace.h"
+#include "index_delta.h"
 
 using namespace std;
 
@@ -106,6 +132,34 @@ void TestMatchDocument() {
     ASSERT(get<1>(match5) == DocumentStatus::ACTUAL);
 }
 
+void TestMatchDocuments() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "fat rat in the house"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(2, "cat in the city"s, DocumentStatus::BANNED, {1, 2});
+    server.AddDocument(3, "fat cat and dog"s, DocumentStatus::ACTUAL, {1, 2});
+
+    const vector<int> ids = {3, 1, 7, 2};
+    const string query = "fat cat city -dog"s;
+    auto matched = server.MatchDocuments(execution::par, query, ids);
+    ASSERT_EQUAL(matched.size(), ids.size());
+    ASSERT_EQUAL(matched.offsets.back(), matched.words.size());
+
+    for (size_t i = 0; i < ids.size(); ++i) {
+        auto [words, status] = server.MatchDocument(query, ids[i]);
+        sort(words.begin(), words.end());
+        const auto range = matched.GetWords(i);
+        ASSERT_EQUAL(vector<string_view>(range.begin(), range.end()), words);
+        ASSERT(matched.statuses[i] == status);
+    }
+    ASSERT(matched.statuses[2] == DocumentStatus::REMOVED);
+    ASSERT_EQUAL(matched.GetWords(0).size(), 0);
+
+    //Слова ссылаются на словарь сервера, а не на строку запроса
+    const auto range = matched.GetWords(3);
+    ASSERT_EQUAL(range.size(), 2);
+    ASSERT(range.begin()->data() < query.data() || range.begin()->data() >= query.data() + query.size());
+}
+
 void TestRelevanceSort() {
     SearchServer server;
     server.AddDocument(1, "fat rat in the house"s, DocumentStatus::ACTUAL, {1, 5, 24});
@@ -208,14 +262,1783 @@ void TestRelevanceComputing() {
     ASSERT(abs(docs[2].relevance - 0.138629) < EPSILON);
 }
 
+void TestPagination() {
+    SearchServer server;
+    for (int id = 0; id < 12; ++id) {
+        server.AddDocument(id, id % 3 == 0 ? "fat cat"s : "cat in the city"s, DocumentStatus::ACTUAL, {id % 4});
+    }
+
+    PageRequest request;
+    request.page_size = 5;
+    vector<Document> by_cursor;
+    int pages = 0;
+    while (true) {
+        SearchPage page = server.FindTopDocumentsPage(execution::par, "cat city"s, request);
+        ASSERT(page.documents.size() <= request.page_size);
+        by_cursor.insert(by_cursor.end(), page.documents.begin(), page.documents.end());
+        ++pages;
+        if (!page.next) {
+            break;
+        }
+        request.after = page.next;
+    }
+    ASSERT_EQUAL(pages, 3);
+    ASSERT_EQUAL(by_cursor.size(), 12);
+
+    PageRequest offset_request;
+    offset_request.page_size = 5;
+    for (size_t offset = 0; offset < by_cursor.size(); offset += 5) {
+        offset_request.offset = offset;
+        SearchPage page = server.FindTopDocumentsPage("cat city"s, offset_request);
+        for (size_t i = 0; i < page.documents.size(); ++i) {
+            ASSERT_EQUAL(page.documents[i].id, by_cursor[offset + i].id);
+        }
+    }
+
+    auto top = server.FindTopDocuments("cat city"s);
+    ASSERT_EQUAL(top.size(), 5);
+    for (size_t i = 0; i < top.size(); ++i) {
+        ASSERT_EQUAL(top[i].id, by_cursor[i].id);
+    }
+}
+
+void TestPaginator() {
+    const vector<int> numbers = {1, 2, 3, 4, 5, 6, 7};
+    const auto pages = Paginate(numbers, 3);
+    ASSERT_EQUAL(pages.size(), 3);
+    ASSERT_EQUAL(pages[1].size(), 3);
+    ASSERT_EQUAL(*pages[1].begin(), 4);
+    ASSERT_EQUAL(pages[2].size(), 1);
+
+    const list<int> numbers_list(numbers.begin(), numbers.end());
+    vector<size_t> sizes;
+    for (const auto& page : Paginate(numbers_list, 3)) {
+        sizes.push_back(page.size());
+    }
+    ASSERT_EQUAL(sizes, (vector<size_t>{3, 3, 1}));
+}
+
+void TestTermDictionary() {
+    TermDictionary dictionary;
+    vector<string> words;
+    for (int i = 0; i < 1000; ++i) {
+        words.push_back("w"s + to_string(i * 7919 % 1000));
+    }
+    for (size_t i = 0; i < words.size(); ++i) {
+        ASSERT_EQUAL(dictionary.Insert(words[i]), i);
+    }
+    ASSERT_EQUAL(dictionary.Insert("w5"s), dictionary.Find("w5"s));
+    ASSERT_EQUAL(dictionary.size(), 1000);
+    for (size_t i = 0; i < words.size(); ++i) {
+        ASSERT_EQUAL(dictionary.Find(words[i]), i);
+        ASSERT_EQUAL(dictionary.GetTerm(i), words[i]);
+    }
+    ASSERT_EQUAL(dictionary.Find("w1000"s), TermDictionary::NO_TERM);
+
+    dictionary.Insert("w99a"s);
+    vector<string_view> found;
+    dictionary.ForEachWithPrefix("w99"s, 100, [&dictionary, &found](const uint32_t id) {
+        found.push_back(dictionary.GetTerm(id));
+    });
+    ASSERT_EQUAL(found, (vector<string_view>{"w99"sv, "w990"sv, "w991"sv, "w992"sv, "w993"sv, "w994"sv,
+                                             "w995"sv, "w996"sv, "w997"sv, "w998"sv, "w999"sv, "w99a"sv}));
+    found.clear();
+    dictionary.ForEachWithPrefix("w99"s, 3, [&dictionary, &found](const uint32_t id) {
+        found.push_back(dictionary.GetTerm(id));
+    });
+    ASSERT_EQUAL(found.size(), 3);
+
+    //Удалённые термины освобождают номера и место строк, остальные строки не двигаются
+    const string_view kept = dictionary.GetTerm(dictionary.Find("w5"s));
+    const char* const erased_data = dictionary.GetTerm(dictionary.Find("w990"s)).data();
+    dictionary.Erase({dictionary.Find("w990"s), dictionary.Find("w7"s)});
+    ASSERT_EQUAL(dictionary.Find("w990"s), TermDictionary::NO_TERM);
+    ASSERT_EQUAL(dictionary.size(), 999);
+    dictionary.Insert("x990"s);
+    dictionary.Insert("x7"s);
+    ASSERT_EQUAL(dictionary.GetTerm(dictionary.Find("x990"s)), "x990"sv);
+    ASSERT(dictionary.GetTerm(dictionary.Find("w5"s)).data() == kept.data());
+    ASSERT_EQUAL(static_cast<const void*>(dictionary.GetTerm(dictionary.Find("x990"s)).data()),
+                 static_cast<const void*>(erased_data));
+}
+
+void TestPrefixQuery() {
+    SearchServer server("the"s);
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "catfish at home"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "dog at home"s, DocumentStatus::ACTUAL, {3});
+
+    ASSERT_EQUAL(server.FindTopDocuments("cat*"s).size(), 2);
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), 1);
+    ASSERT_EQUAL(server.FindTopDocuments("home -catf*"s).size(), 1);
+    ASSERT_EQUAL(server.FindTopDocuments("bird*"s).size(), 0);
+
+    auto [words, status] = server.MatchDocument("ca* ci*"s, 1);
+    sort(words.begin(), words.end());
+    ASSERT_EQUAL(words, (vector<string_view>{"cat"sv, "city"sv}));
+
+    //Термины удалённых документов до Compact не занимают места в MAX_PREFIX_EXPANSION
+    SearchServer expansion_server;
+    const int term_count = static_cast<int>(MAX_PREFIX_EXPANSION) + 10;
+    for (int i = 0; i < term_count; ++i) {
+        expansion_server.AddDocument(i, "word"s + to_string(100 + i), DocumentStatus::ACTUAL, {i});
+    }
+    for (int i = 0; i < 10; ++i) {
+        expansion_server.RemoveDocument(i);
+    }
+    //При равной релевантности первым идёт документ с наибольшим рейтингом, то есть с последним термином
+    const vector<Document> expanded = expansion_server.FindTopDocuments("word*"s);
+    ASSERT(!expanded.empty());
+    ASSERT_EQUAL(expanded[0].id, term_count - 1);
+    const vector<Document> frozen_expanded = FrozenSearchServer(expansion_server).FindTopDocuments("word*"s);
+    ASSERT(!frozen_expanded.empty());
+    ASSERT_EQUAL(frozen_expanded[0].id, term_count - 1);
+}
+
+namespace {
+
+//Ресурс-обёртка, считающий занятые через него байты
+class CountingResource : public pmr::memory_resource {
+public:
+    size_t allocations = 0;
+    size_t bytes_in_use = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++allocations;
+        bytes_in_use += bytes;
+        return pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        bytes_in_use -= bytes;
+        pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+}
+
+void TestMemoryStats() {
+    SearchServer server("in the"s);
+    const IndexMemoryStats empty_stats = server.GetMemoryStats();
+    ASSERT_EQUAL(empty_stats.posting_count, 0);
+    //Два коротких стоп-слова хранятся внутри std::string без памяти в куче
+    ASSERT_EQUAL(empty_stats.stop_words, 2 * memory_usage::TreeNodeSize<string>());
+
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat at home"s, DocumentStatus::ACTUAL, {2});
+    const IndexMemoryStats stats = server.GetMemoryStats();
+    ASSERT_EQUAL(stats.posting_count, 5);
+    ASSERT(stats.term_dictionary > empty_stats.term_dictionary);
+    ASSERT(stats.postings > 0);
+    ASSERT(stats.term_frequencies >= stats.posting_count * sizeof(uint16_t));
+    ASSERT(stats.forward_index > 0);
+    ASSERT(stats.document_attributes > 0);
+    ASSERT_EQUAL(stats.document_ids, 2 * memory_usage::TreeNodeSize<int>());
+    ASSERT_EQUAL(stats.stop_words, empty_stats.stop_words);
+    ASSERT(stats.spelling_index > 0);
+    ASSERT_EQUAL(stats.Total(), stats.term_dictionary + stats.postings + stats.term_frequencies
+                                + stats.forward_index + stats.document_attributes + stats.stop_words
+                                + stats.document_ids + stats.spelling_index);
+
+    //Размеры узлов из memory_usage совпадают с тем, что контейнеры действительно выделяют
+    CountingResource tree_counting;
+    pmr::set<int> ids(&tree_counting);
+    pmr::map<int, double> ratings(&tree_counting);
+    CountingResource hash_counting;
+    pmr::unordered_multimap<uint64_t, uint32_t> deletes(&hash_counting);
+    CountingResource string_hash_counting;
+    pmr::unordered_multimap<string, int> words(&string_hash_counting);
+    for (int i = 0; i < 100; ++i) {
+        ids.insert(i);
+        ratings.emplace(i, i * 0.5);
+        deletes.emplace(i % 10, i);
+        words.emplace(to_string(i % 10), i);
+    }
+    ASSERT_EQUAL(memory_usage::HeapBytes(ids) + memory_usage::HeapBytes(ratings), tree_counting.bytes_in_use);
+    ASSERT_EQUAL(memory_usage::HeapBytes(deletes), hash_counting.bytes_in_use);
+    ASSERT_EQUAL(memory_usage::HeapBytes(words), string_hash_counting.bytes_in_use);
+}
+
+void TestRemoveDocument() {
+    SearchServer server;
+    server.AddDocument(1, "fat rat in the house"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat in the city"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "fat cat in the house"s, DocumentStatus::ACTUAL, {3});
+
+    SearchServer expected;
+    expected.AddDocument(1, "fat rat in the house"s, DocumentStatus::ACTUAL, {1});
+    expected.AddDocument(3, "fat cat in the house"s, DocumentStatus::ACTUAL, {3});
+
+    server.RemoveDocument(2);
+    server.RemoveDocument(2);
+    ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    ASSERT(server.GetWordFrequencies(2).empty());
+    ASSERT(get<1>(server.MatchDocument("cat"s, 2)) == DocumentStatus::REMOVED);
+
+    //Релевантность считается по живым документам ещё до уплотнения
+    const auto docs = server.FindTopDocuments("cat city house"s);
+    const auto expected_docs = expected.FindTopDocuments("cat city house"s);
+    ASSERT_EQUAL(docs.size(), expected_docs.size());
+    for (size_t i = 0; i < docs.size(); ++i) {
+        ASSERT_EQUAL(docs[i].id, expected_docs[i].id);
+        ASSERT(abs(docs[i].relevance - expected_docs[i].relevance) < 1e-6);
+    }
+
+    ASSERT_EQUAL(server.GetMemoryStats().posting_count, 14);
+    server.Compact();
+    ASSERT_EQUAL(server.GetMemoryStats().posting_count, 10);
+    ASSERT(server.DocumentsWithWord("city"s).empty());
+    ASSERT_EQUAL(server.DocumentsWithWord("cat"s), (vector<int>{3}));
+
+    //Повторное добавление вычищает только свой документ, остальные удалённые ждут Compact
+    server.AddDocument(4, "fat bat"s, DocumentStatus::ACTUAL, {5});
+    server.RemoveDocument(4);
+    server.RemoveDocument(execution::par, 3);
+    server.AddDocument(3, "dog in the city"s, DocumentStatus::ACTUAL, {4});
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), 0);
+    ASSERT_EQUAL(server.FindTopDocuments("city"s).size(), 1);
+    ASSERT_EQUAL(server.DocumentsWithWord("bat"s), (vector<int>{4}));
+    ASSERT_EQUAL(server.DocumentsWithWord("fat"s), (vector<int>{1, 4}));
+
+    //Автоматическое уплотнение не перемещает строки живых терминов
+    const string_view kept_word = server.GetWordFrequencies(1).begin()->first;
+    const string kept_copy(kept_word);
+    for (int id = 10; id < 5000; ++id) {
+        server.AddDocument(id, "churn"s + string(200, 'x') + to_string(id), DocumentStatus::ACTUAL, {id});
+        server.RemoveDocument(id);
+        ASSERT(server.GetWordFrequencies(1).begin()->first.data() == kept_word.data());
+    }
+    ASSERT_EQUAL(kept_word, kept_copy);
+    ASSERT(server.DocumentsWithWord("churn"s + string(200, 'x') + "10"s).empty());
+}
+
+void TestBulkRemoveCompaction() {
+    SearchServer server;
+    const int document_count = 20000;
+    for (int id = 0; id < document_count; ++id) {
+        server.AddDocument(id, "common unique"s + to_string(id), DocumentStatus::ACTUAL, {id});
+    }
+    for (int id = 1; id < document_count; ++id) {
+        server.RemoveDocument(id);
+    }
+    server.Compact();
+
+    const IndexMemoryStats stats = server.GetMemoryStats();
+    ASSERT_EQUAL(stats.posting_count, 2);
+    ASSERT_EQUAL(server.GetDocumentCount(), 1);
+    ASSERT_EQUAL(server.FindTopDocuments("unique*"s).size(), 1);
+    ASSERT_EQUAL(server.GetWordFrequencies(0).count("unique0"s), 1);
+
+    auto [words, status] = server.MatchDocument("common unique0"s, 0);
+    ASSERT_EQUAL(words.size(), 2);
+}
+
+void AssertSameDocuments(const vector<Document>& lhs, const vector<Document>& rhs) {
+    ASSERT_EQUAL(lhs.size(), rhs.size());
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        ASSERT_EQUAL(lhs[i].id, rhs[i].id);
+        ASSERT_EQUAL(lhs[i].rating, rhs[i].rating);
+        ASSERT(abs(lhs[i].relevance - rhs[i].relevance) < 1e-6);
+    }
+}
+
+void TestSegmentedSearchServer() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 60, 4);
+    const auto documents = GenerateQueries(generator, dictionary, 300, 8);
+    const auto queries = GenerateQueries(generator, dictionary, 30, 3);
+
+    for (const bool background_merge : {false, true}) {
+        SegmentPolicy policy;
+        policy.seal_document_count = 16;
+        policy.merge_factor = 2;
+        policy.background_merge = background_merge;
+        SegmentedSearchServer segmented(string_view("and"), policy);
+        SearchServer server("and"s);
+
+        for (size_t id = 0; id < documents.size(); ++id) {
+            const DocumentStatus status = id % 3 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+            const vector<int> ratings = {static_cast<int>(id % 7)};
+            segmented.AddDocument(id, documents[id], status, ratings);
+            server.AddDocument(id, documents[id], status, ratings);
+            if (id % 5 == 0) {
+                segmented.RemoveDocument(id / 2);
+                server.RemoveDocument(id / 2);
+            }
+        }
+        segmented.WaitForMerges();
+        ASSERT(segmented.GetSegmentCount() < documents.size() / policy.seal_document_count);
+        ASSERT_EQUAL(segmented.GetDocumentCount(), server.GetDocumentCount());
+
+        for (const string& query : queries) {
+            AssertSameDocuments(segmented.FindTopDocuments(query), server.FindTopDocuments(query));
+            AssertSameDocuments(segmented.FindTopDocuments(query + " -"s + dictionary[0], DocumentStatus::BANNED),
+                                server.FindTopDocuments(query + " -"s + dictionary[0], DocumentStatus::BANNED));
+        }
+
+        try {
+            segmented.AddDocument(1, "duplicate"s, DocumentStatus::ACTUAL, {});
+            ASSERT_HINT(false, "duplicate id must be rejected"s);
+        } catch (const invalid_argument&) {
+        }
+    }
+}
+
+void TestConcurrentIngestion() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 60, 4);
+    const auto documents = GenerateQueries(generator, dictionary, 1000, 8);
+    const auto queries = GenerateQueries(generator, dictionary, 30, 3);
+    const int producer_count = 4;
+
+    SegmentPolicy policy;
+    policy.seal_document_count = 64;
+    SegmentedSearchServer segmented(string_view("and"), policy);
+    SearchServer server("and"s);
+    for (size_t id = 0; id < documents.size(); ++id) {
+        server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {static_cast<int>(id % 7)});
+    }
+
+    //Свои id производители добавляют вперемешку и затем повторно, за общие id соревнуются все сразу
+    const size_t contested_begin = documents.size() - 100;
+    atomic_int duplicates = 0;
+    atomic_bool done = false;
+    vector<thread> producers;
+    for (int producer = 0; producer < producer_count; ++producer) {
+        producers.emplace_back([&, producer] {
+            const auto add = [&](size_t id) {
+                try {
+                    segmented.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {static_cast<int>(id % 7)});
+                } catch (const invalid_argument&) {
+                    ++duplicates;
+                }
+            };
+            for (size_t id = producer; id < contested_begin; id += producer_count) {
+                add(id);
+                add(id);
+            }
+            for (size_t id = contested_begin; id < documents.size(); ++id) {
+                add(id);
+            }
+        });
+    }
+    thread reader([&] {
+        while (!done) {
+            for (const string& query : queries) {
+                for (const Document& document : segmented.FindTopDocuments(query)) {
+                    ASSERT(document.id >= 0 && document.id < static_cast<int>(documents.size()));
+                }
+            }
+        }
+    });
+    //Свои документы удаляющий поток добавляет и сразу удаляет: из изменяемого сегмента или, если его
+    //успели запечатать, из запечатанного. Их слова не встречаются в запросах
+    thread remover([&] {
+        for (int id = static_cast<int>(documents.size()); !done; ++id) {
+            segmented.AddDocument(id, "churn"s, DocumentStatus::ACTUAL, {});
+            segmented.RemoveDocument(id);
+        }
+    });
+    for (thread& producer : producers) {
+        producer.join();
+    }
+    done = true;
+    reader.join();
+    remover.join();
+
+    ASSERT_EQUAL(duplicates.load(), static_cast<int>(contested_begin + 100 * (producer_count - 1)));
+    ASSERT_EQUAL(segmented.GetDocumentCount(), server.GetDocumentCount());
+    for (const string& query : queries) {
+        AssertSameDocuments(segmented.FindTopDocuments(query), server.FindTopDocuments(query));
+    }
+}
+
+void TestDurableSearchServer() {
+    const auto directory = filesystem::temp_directory_path() / "search_server_durable_test"s;
+    filesystem::remove_all(directory);
+    const string query = "fat cat city"s;
+    vector<Document> expected;
+    {
+        DurableSearchServer server(directory.string(), "in the"s);
+        server.AddDocument(1, "fat rat in the house"s, DocumentStatus::ACTUAL, {1, 2});
+        server.AddDocument(2, "cat in the city"s, DocumentStatus::ACTUAL, {3});
+        server.AddDocument(3, "fat cat"s, DocumentStatus::BANNED, {});
+        server.RemoveDocument(1);
+        server.RemoveDocument(100);
+        expected = server.GetServer().FindTopDocuments(query);
+        ASSERT_EQUAL(server.GetLastSequence(), 4);
+    }
+    {
+        DurableSearchServer server(directory.string(), ""s);
+        ASSERT_EQUAL(server.GetLastSequence(), 4);
+        ASSERT_EQUAL(server.GetServer().GetDocumentCount(), 2);
+        AssertSameDocuments(server.GetServer().FindTopDocuments(query), expected);
+        ASSERT(server.GetServer().FindTopDocuments("in"s).empty());
+
+        server.Checkpoint();
+        ASSERT_EQUAL(filesystem::file_size(directory / "index.wal"s), 0);
+        server.AddDocument(4, "fat cat in the city"s, DocumentStatus::ACTUAL, {5});
+        server.Sync();
+        expected = server.GetServer().FindTopDocuments(query);
+    }
+    {
+        //Недописанная при сбое запись в конце журнала отбрасывается
+        ofstream log(directory / "index.wal"s, ios::binary | ios::app);
+        log << "\x10\x00\x00\x00garbage"s;
+    }
+    {
+        DurableSearchServer server(directory.string(), ""s);
+        ASSERT_EQUAL(server.GetLastSequence(), 5);
+        ASSERT_EQUAL(server.GetServer().GetDocumentCount(), 3);
+        AssertSameDocuments(server.GetServer().FindTopDocuments(query), expected);
+        ASSERT(get<1>(server.GetServer().MatchDocument("cat"s, 3)) == DocumentStatus::BANNED);
+    }
+    {
+        //Sync и Checkpoint сбрасывают неполную группу сразу, а не по истечении задержки
+        WriteAheadLog::Options options;
+        options.group_commit_records = 1000;
+        options.group_commit_delay = chrono::seconds(5);
+        DurableSearchServer server(directory.string(), ""s, options);
+        const auto start = chrono::steady_clock::now();
+        server.AddDocument(6, "cat"s, DocumentStatus::ACTUAL, {1});
+        server.Sync();
+        server.AddDocument(7, "dog"s, DocumentStatus::ACTUAL, {1});
+        server.Checkpoint();
+        ASSERT(chrono::steady_clock::now() - start < chrono::seconds(1));
+    }
+    {
+        //Truncate во время дозаписи отрезает журнал только по границе записей
+        const string log_path = (directory / "concurrent.wal"s).string();
+        WriteAheadLog::Options options;
+        options.group_commit_records = 8;
+        options.group_commit_delay = chrono::microseconds(100);
+        uint64_t last_sequence = 0;
+        {
+            WriteAheadLog log(log_path, 1, options);
+            thread writer([&] {
+                for (int id = 0; id < 2000; ++id) {
+                    last_sequence = log.AppendAdd(id, "cat in the city"s, DocumentStatus::ACTUAL, {id});
+                }
+            });
+            for (int i = 0; i < 50; ++i) {
+                log.Truncate();
+            }
+            writer.join();
+            log.Sync();
+        }
+        const auto size = filesystem::file_size(log_path);
+        uint64_t previous_sequence = 0;
+        const uint64_t recovered = WriteAheadLog::Recover(log_path, 0, [&](const WalRecord& record) {
+            ASSERT(previous_sequence == 0 || record.sequence == previous_sequence + 1);
+            previous_sequence = record.sequence;
+        });
+        ASSERT_EQUAL(filesystem::file_size(log_path), size);
+        ASSERT(recovered == 0 || recovered == last_sequence);
+    }
+    filesystem::remove_all(directory);
+}
+
+void TestCorpusLoader() {
+    const string corpus =
+            "# id\tstatus\tratings\ttext\n"s
+            "1\tACTUAL\t1 2 3\tcat in the city\n"s
+            "2\tBANNED\t\tdog at home\r\n"s
+            "\n"s
+            "x\tACTUAL\t1\tbad id\n"s
+            "3\tACTUAL\t-5\tfat cat\n"s
+            "1\tACTUAL\t1\tduplicate id\n"s
+            "4\tDELETED\t1\tbad status\n"s
+            "5\tIRRELEVANT\t4 x\tbad rating\n"s
+            "6\tIRRELEVANT\t7\n"s
+            "7\tIRRELEVANT\t7\tlast line without newline"s;
+
+    for (const size_t threads : {1, 4}) {
+        SearchServer server("in the"s);
+        const CorpusLoadResult result = LoadCorpusFromMemory(corpus, server, threads);
+        ASSERT_EQUAL(result.loaded, 4);
+        vector<size_t> error_lines;
+        for (const CorpusError& error : result.errors) {
+            error_lines.push_back(error.line);
+        }
+        ASSERT_EQUAL(error_lines, (vector<size_t>{5, 7, 8, 9, 10}));
+
+        ASSERT_EQUAL(server.GetDocumentCount(), 4);
+        ASSERT_EQUAL(server.GetDocumentParams(3)->rating, -5);
+        ASSERT(server.GetDocumentParams(2)->status == DocumentStatus::BANNED);
+        ASSERT_EQUAL(server.GetWordFrequencies(2).count("home"s), 1);
+        ASSERT_EQUAL(server.FindTopDocuments("line"s, DocumentStatus::IRRELEVANT).size(), 1);
+    }
+
+    const auto path = filesystem::temp_directory_path() / "search_server_corpus_test.tsv"s;
+    {
+        ofstream file(path, ios::binary);
+        file << corpus;
+    }
+    SearchServer server;
+    ASSERT_EQUAL(LoadCorpus(path.string(), server).loaded, 4);
+    filesystem::remove(path);
+}
+
+void TestDocumentFilter() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 40, 4);
+    const auto documents = GenerateQueries(generator, dictionary, 500, 8);
+    const auto queries = GenerateQueries(generator, dictionary, 30, 3);
+
+    SearchServer server("and"s);
+    for (size_t id = 0; id < documents.size(); ++id) {
+        //Статусы идут длинными полосами, чтобы фильтр пропускал целые блоки по 64 документа
+        const DocumentStatus status = static_cast<DocumentStatus>(id / 100 % DOCUMENT_STATUS_COUNT);
+        server.AddDocument(id, documents[id], status, {static_cast<int>(id % 11) - 5});
+    }
+    for (int id = 0; id < 500; id += 7) {
+        server.RemoveDocument(id);
+    }
+
+    DocumentFilter filter = DocumentFilter::ByStatuses({DocumentStatus::IRRELEVANT, DocumentStatus::REMOVED});
+    filter.min_rating = -2;
+    filter.max_rating = 3;
+    filter.min_id = 150;
+    filter.max_id = 420;
+    ASSERT(filter.Matches(200, DocumentStatus::IRRELEVANT, 0));
+    ASSERT(!filter.Matches(200, DocumentStatus::ACTUAL, 0));
+    ASSERT(!filter.Matches(200, DocumentStatus::REMOVED, 4));
+    ASSERT(!filter.Matches(421, DocumentStatus::REMOVED, 0));
+
+    for (const string& query : queries) {
+        AssertSameDocuments(server.FindTopDocuments(query, filter),
+                            server.FindTopDocuments(query, [&filter](int id, DocumentStatus status, int rating) {
+            return filter.Matches(id, status, rating);
+        }));
+        AssertSameDocuments(server.FindTopDocuments(execution::par, query, DocumentStatus::BANNED),
+                            server.FindTopDocuments(query, [](int, DocumentStatus status, int) {
+            return status == DocumentStatus::BANNED;
+        }));
+        AssertSameDocuments(server.FindTopDocuments(query, DocumentFilter()),
+                            server.FindTopDocuments(query, [](int, DocumentStatus, int) {
+            return true;
+        }));
+    }
+
+    //Предикат применяется поверх фильтра
+    const string query = dictionary[0] + " "s + dictionary[1] + " "s + dictionary[2];
+    for (const Document& document : server.FindTopDocuments(execution::seq, query, filter,
+                                                            [](int id, DocumentStatus, int) {
+        return id % 2 == 0;
+    })) {
+        ASSERT(document.id % 2 == 0 && document.id >= 150 && document.id <= 420);
+    }
+}
+
+void TestCompactScoring() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 50, 4);
+    const auto documents = GenerateQueries(generator, dictionary, 400, 10);
+    const auto queries = GenerateQueries(generator, dictionary, 40, 4);
+
+    SearchServer server("and"s);
+    for (size_t id = 0; id < documents.size(); ++id) {
+        server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {static_cast<int>(id % 3)});
+    }
+    //Одинаковые документы с разными рейтингами: точные релевантности равны
+    for (int id = 400; id < 410; ++id) {
+        server.AddDocument(id, dictionary[0] + " "s + dictionary[1], DocumentStatus::ACTUAL, {410 - id});
+    }
+    for (int id = 0; id < 400; id += 9) {
+        server.RemoveDocument(id);
+    }
+
+    for (const string& query : queries) {
+        server.SetScoringMode(ScoringMode::EXACT);
+        const auto exact = server.FindTopDocuments(query, [](int, DocumentStatus, int) {
+            return true;
+        });
+        server.SetScoringMode(ScoringMode::COMPACT);
+        const auto compact = server.FindTopDocuments(query, [](int, DocumentStatus, int) {
+            return true;
+        });
+        ASSERT_EQUAL(exact.size(), compact.size());
+        for (size_t i = 0; i < exact.size(); ++i) {
+            ASSERT(abs(exact[i].relevance - compact[i].relevance) < 1e-3);
+        }
+    }
+
+    const string query = dictionary[0] + " "s + dictionary[1];
+    server.SetScoringMode(ScoringMode::EXACT);
+    const auto exact = server.FindTopDocuments(query);
+    server.SetScoringMode(ScoringMode::COMPACT);
+    const auto compact = server.FindTopDocuments(query);
+    ASSERT_EQUAL(exact.size(), compact.size());
+    for (size_t i = 0; i < exact.size(); ++i) {
+        ASSERT_EQUAL(exact[i].id, compact[i].id);
+    }
+
+    vector<uint16_t> term_freqs;
+    for (uint16_t i = 1; i < 20; ++i) {
+        term_freqs.push_back(scoring::QuantizeTermFrequency(1.0 / i));
+    }
+    vector<float> scaled(term_freqs.size());
+    scoring::ScaleTermFrequencies(term_freqs.data(), term_freqs.size(), 2.0f / scoring::TERM_FREQ_LEVELS,
+                                  scaled.data());
+    for (size_t i = 0; i < scaled.size(); ++i) {
+        ASSERT(abs(scaled[i] - 2.0 / (i + 1)) < 1e-4);
+    }
+    ASSERT_EQUAL(scoring::QuantizeTermFrequency(1e-9), 1);
+}
+
+void TestDocumentRangeParallelism() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 20, 5);
+    const auto documents = GenerateQueries(generator, dictionary, 6000, 20);
+
+    SearchServer server("and"s);
+    for (size_t id = 0; id < documents.size(); ++id) {
+        server.AddDocument(id * 3, documents[id], static_cast<DocumentStatus>(id % 2), {static_cast<int>(id % 5)});
+    }
+    for (int id = 0; id < 18000; id += 33) {
+        server.RemoveDocument(id);
+    }
+
+    string query;
+    for (size_t i = 0; i < 12; ++i) {
+        query += dictionary[i] + " "s;
+    }
+    DocumentFilter filter;
+    filter.min_id = 1000;
+    filter.max_id = 15000;
+    for (const ScoringMode mode : {ScoringMode::EXACT, ScoringMode::COMPACT}) {
+        server.SetScoringMode(mode);
+        AssertSameDocuments(server.FindTopDocuments(execution::par, query),
+                            server.FindTopDocuments(execution::seq, query));
+        AssertSameDocuments(server.FindTopDocuments(execution::par, query + " -"s + dictionary[15], filter),
+                            server.FindTopDocuments(execution::seq, query + " -"s + dictionary[15], filter));
+
+        PageRequest request;
+        request.page_size = 50;
+        request.offset = 100;
+        AssertSameDocuments(server.FindTopDocumentsPage(execution::par, query, request).documents,
+                            server.FindTopDocumentsPage(execution::seq, query, request).documents);
+    }
+}
+
+void TestSearchBudget() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10, 5);
+    const auto documents = GenerateQueries(generator, dictionary, 5000, 10);
+    SearchServer server("and"s);
+    for (size_t id = 0; id < documents.size(); ++id) {
+        server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {static_cast<int>(id % 7)});
+    }
+    const string query = dictionary[0] + " "s + dictionary[1] + " "s + dictionary[2];
+
+    const SearchResult unlimited = server.FindTopDocumentsWithin(query, DocumentFilter(), SearchBudget());
+    ASSERT(unlimited.complete);
+    AssertSameDocuments(unlimited.documents, server.FindTopDocuments(query, DocumentFilter()));
+
+    CancellationToken token;
+    auto future = server.FindTopDocumentsAsync(query, DocumentFilter(), SearchBudget(token));
+    const SearchResult async_result = future.get();
+    ASSERT(async_result.complete);
+    AssertSameDocuments(async_result.documents, unlimited.documents);
+
+    //Запросы выполняют потоки пула, а не новый поток на каждый запрос
+    SearchExecutor executor(2);
+    vector<std::future<SearchResult>> pooled;
+    for (int i = 0; i < 20; ++i) {
+        pooled.push_back(server.FindTopDocumentsAsync(executor, query, DocumentFilter(), SearchBudget()));
+    }
+    for (auto& pooled_result : pooled) {
+        AssertSameDocuments(pooled_result.get().documents, unlimited.documents);
+    }
+    mutex thread_ids_mutex;
+    set<thread::id> thread_ids;
+    vector<std::future<void>> tasks;
+    for (int i = 0; i < 50; ++i) {
+        tasks.push_back(executor.Submit([&thread_ids_mutex, &thread_ids]() {
+            lock_guard guard(thread_ids_mutex);
+            thread_ids.insert(this_thread::get_id());
+        }));
+    }
+    for (auto& task : tasks) {
+        task.get();
+    }
+    ASSERT(thread_ids.size() <= executor.GetThreadCount());
+
+    token.Cancel();
+    const SearchResult cancelled = server.FindTopDocumentsAsync(query, DocumentFilter(), SearchBudget(token)).get();
+    ASSERT(!cancelled.complete);
+    ASSERT(cancelled.documents.empty());
+
+    //Истёкший срок запоминается бюджетом и прерывает все запросы с ним
+    const SearchBudget budget = SearchBudget::WithTimeout(chrono::nanoseconds(1));
+    this_thread::sleep_for(chrono::microseconds(10));
+    const SearchResult expired = server.FindTopDocumentsWithin(query, DocumentFilter(), budget);
+    ASSERT(!expired.complete);
+    ASSERT(budget.WasExhausted());
+    ASSERT(server.FindTopDocumentsWithin(execution::par, query, DocumentFilter(), budget).documents.empty());
+}
+
+void TestBatchQueries() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 30, 4);
+    const auto documents = GenerateQueries(generator, dictionary, 800, 8);
+    //Маленький словарь: запросы пакета часто делят слова
+    vector<string> queries;
+    for (int i = 0; i < 200; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, 4, 0.2));
+    }
+
+    SearchServer server("and"s);
+    for (size_t id = 0; id < documents.size(); ++id) {
+        server.AddDocument(id, documents[id], static_cast<DocumentStatus>(id % 3 == 0), {static_cast<int>(id % 4)});
+    }
+    for (int id = 0; id < 800; id += 13) {
+        server.RemoveDocument(id);
+    }
+
+    //Пакет совпадает с поиском в каждом режиме подсчёта, включая IMPACT с построенным индексом вкладов
+    const DocumentFilter filter = DocumentFilter::ByStatus(DocumentStatus::IRRELEVANT);
+    for (const ScoringMode mode : {ScoringMode::EXACT, ScoringMode::COMPACT, ScoringMode::IMPACT}) {
+        server.SetScoringMode(mode);
+        if (mode == ScoringMode::IMPACT) {
+            server.BuildImpactIndex();
+        }
+        const auto expected = ProcessQueries(server, queries);
+        const auto batched = ProcessQueriesBatched(server, queries);
+        ASSERT_EQUAL(batched.size(), queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            AssertSameDocuments(batched[i], expected[i]);
+        }
+
+        const auto filtered = server.FindTopDocumentsBatch(queries, filter);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            AssertSameDocuments(filtered[i], server.FindTopDocuments(queries[i], filter));
+        }
+    }
+    ASSERT(server.FindTopDocumentsBatch({}, filter).empty());
+}
+
+void TestQueryServer() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(3, "nasty rat with curly hair"s, DocumentStatus::BANNED, {3});
+
+    QueryServer::Options options;
+    options.worker_count = 2;
+    options.max_batch_size = 3;
+    options.max_line_length = 64;
+    QueryServer query_server(search_server, options);
+    thread loop([&query_server]() {
+        query_server.Run();
+    });
+
+    //Все запросы уходят одним куском, ответы должны прийти по порядку
+    const string requests =
+            "FIND\tcurly hair\n"s
+            "MATCH\t1\tnasty pet -hair\n"s
+            "ADD\t10\tACTUAL\t5\tcurly dog\n"s
+            "FIND\tdog\r\n"s
+            "FIND\tcat\n"s
+            "ADD\t10\tACTUAL\t5\tdog\n"s
+            "REMOVE\t10\n"s
+            "FIND\tdog\n"s
+            "MATCH\tx\tdog\n"s
+            "FIND\t--dog\n"s
+            "HELLO\n"s;
+    const int fd = ConnectToQueryServer(query_server.GetPort());
+    ASSERT(send(fd, requests.data(), requests.size(), 0) == static_cast<ssize_t>(requests.size()));
+    shutdown(fd, SHUT_WR);
+    string response;
+    char buffer[4096];
+    for (ssize_t size; (size = recv(fd, buffer, sizeof(buffer), 0)) > 0;) {
+        response.append(buffer, size);
+    }
+    close(fd);
+
+    vector<string> lines;
+    istringstream response_stream(response);
+    for (string line; getline(response_stream, line);) {
+        lines.push_back(line);
+    }
+    ASSERT_EQUAL(lines.size(), 11);
+    ASSERT_EQUAL(lines[0].substr(0, 5), "OK\t2 "s);
+    ASSERT_EQUAL(lines[1], "OK\tACTUAL\tnasty pet"s);
+    ASSERT_EQUAL(lines[2], "OK"s);
+    ASSERT_EQUAL(lines[3].substr(0, 6), "OK\t10 "s);
+    ASSERT_EQUAL(lines[4], "OK"s);
+    ASSERT_EQUAL(lines[5].substr(0, 6), "ERROR\t"s);
+    ASSERT_EQUAL(lines[6], "OK"s);
+    ASSERT_EQUAL(lines[7], "OK"s);
+    ASSERT_EQUAL(lines[8].substr(0, 6), "ERROR\t"s);
+    ASSERT_EQUAL(lines[9].substr(0, 6), "ERROR\t"s);
+    ASSERT_EQUAL(lines[10], "ERROR\tunknown command 'HELLO'"s);
+
+    //Слишком длинная строка: запросы до неё отвечены, потом ошибка, и сервер сам закрывает соединение
+    {
+        const string long_requests = "FIND\tcurly hair\nFIND\t"s + string(100, 'a');
+        const int long_fd = ConnectToQueryServer(query_server.GetPort());
+        ASSERT(send(long_fd, long_requests.data(), long_requests.size(), 0)
+               == static_cast<ssize_t>(long_requests.size()));
+        string long_response;
+        for (ssize_t size; (size = recv(long_fd, buffer, sizeof(buffer), 0)) > 0;) {
+            long_response.append(buffer, size);
+        }
+        close(long_fd);
+        ASSERT_EQUAL(long_response.substr(0, 5), "OK\t2 "s);
+        ASSERT_EQUAL(long_response.substr(long_response.find('\n') + 1), "ERROR\tline is too long\n"s);
+    }
+
+    LoadTestOptions load_options;
+    load_options.port = query_server.GetPort();
+    load_options.connection_count = 3;
+    load_options.pipeline_depth = 8;
+    load_options.request_count = 500;
+    const LoadTestReport report = RunLoadTest({"funny pet"s, "curly -rat"s, "hair"s}, load_options);
+    ASSERT_EQUAL(report.requests, 500);
+    ASSERT_EQUAL(report.errors, 0);
+    ASSERT(report.p50_latency <= report.p99_latency && report.p99_latency <= report.max_latency);
+
+    query_server.Stop();
+    loop.join();
+}
+
+void TestImpactOrderedSearch() {
+    mt19937 generator;
+    //Небольшой словарь и документы разной длины дают длинные постинги с разными вкладами,
+    //на которых обход действительно останавливается раньше
+    const auto dictionary = GenerateDictionary(generator, 30, 4);
+    vector<string> documents;
+    for (int i = 0; i < 3000; ++i) {
+        documents.push_back(GenerateQuery(generator, dictionary, uniform_int_distribution(1, 20)(generator)));
+    }
+    const auto queries = GenerateQueries(generator, dictionary, 60, 4);
+
+    SearchServer server("and"s);
+    for (size_t id = 0; id < documents.size(); ++id) {
+        const DocumentStatus status = static_cast<DocumentStatus>(id % DOCUMENT_STATUS_COUNT);
+        server.AddDocument(id, documents[id], status, {static_cast<int>(id % 11) - 5});
+    }
+    //Одинаковые документы с разными рейтингами: равные релевантности упорядочиваются по рейтингу
+    for (int id = 3000; id < 3010; ++id) {
+        server.AddDocument(id, dictionary[0] + " "s + dictionary[1], DocumentStatus::ACTUAL, {id - 3000});
+    }
+    for (int id = 0; id < 3000; id += 13) {
+        server.RemoveDocument(id);
+    }
+
+    DocumentFilter filter = DocumentFilter::ByStatuses({DocumentStatus::ACTUAL, DocumentStatus::BANNED});
+    filter.min_rating = -3;
+    filter.min_id = 500;
+    const auto even = [](int id, DocumentStatus, int) {
+        return id % 2 == 0;
+    };
+    const auto compare_modes = [&](const string& query) {
+        server.SetScoringMode(ScoringMode::EXACT);
+        const auto exact_actual = server.FindTopDocuments(query);
+        const auto exact_filtered = server.FindTopDocuments(query, filter);
+        const auto exact_even = server.FindTopDocuments(query, even);
+        server.SetScoringMode(ScoringMode::IMPACT);
+        AssertSameDocuments(server.FindTopDocuments(query), exact_actual);
+        AssertSameDocuments(server.FindTopDocuments(query, filter), exact_filtered);
+        AssertSameDocuments(server.FindTopDocuments(execution::par, query, even), exact_even);
+    };
+
+    server.BuildImpactIndex();
+    ASSERT(server.HasImpactIndex());
+    ASSERT(server.GetMemoryStats().impact_index > 0);
+    for (const string& query : queries) {
+        compare_modes(query);
+        compare_modes(query + " -"s + dictionary[2]);
+    }
+    compare_modes(dictionary[0] + " "s + dictionary[1]);
+
+    //Изменение сервера сбрасывает индекс вкладов, поиск продолжает работать точно
+    server.AddDocument(5000, dictionary[0], DocumentStatus::ACTUAL, {100});
+    ASSERT(!server.HasImpactIndex());
+    compare_modes(dictionary[0]);
+    server.BuildImpactIndex();
+    compare_modes(dictionary[0]);
+    ASSERT_EQUAL(server.FindTopDocuments(dictionary[0]).front().id, 5000);
+    server.RemoveDocument(5000);
+    ASSERT(!server.HasImpactIndex());
+
+    //Запрос длиннее 64 слов: маска слов документа занимает несколько машинных слов
+    const auto wide_dictionary = GenerateDictionary(generator, 150, 5);
+    SearchServer wide_server;
+    for (int id = 0; id < 2000; ++id) {
+        const int word_count = uniform_int_distribution(1, 30)(generator);
+        wide_server.AddDocument(id, GenerateQuery(generator, wide_dictionary, word_count), DocumentStatus::ACTUAL, {id % 7});
+    }
+    string wide_query;
+    for (size_t i = 0; i < 100; ++i) {
+        wide_query += wide_dictionary[i] + " "s;
+    }
+    const auto exact_wide = wide_server.FindTopDocuments(wide_query);
+    wide_server.BuildImpactIndex();
+    wide_server.SetScoringMode(ScoringMode::IMPACT);
+    AssertSameDocuments(wide_server.FindTopDocuments(wide_query), exact_wide);
+}
+
+void TestSpellingSuggestions() {
+    ASSERT_EQUAL(SpellingIndex::ComputeEditDistance("kitten"s, "sitting"s, 3), 3);
+    ASSERT_EQUAL(SpellingIndex::ComputeEditDistance("kitten"s, "sitting"s, 2), 3);
+    ASSERT_EQUAL(SpellingIndex::ComputeEditDistance("city"s, "ctiy"s, 2), 1);
+    ASSERT_EQUAL(SpellingIndex::ComputeEditDistance("cat"s, ""s, 2), 3);
+
+    SearchServer server("in the"s);
+    server.AddDocument(1, "fat cat in the city"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat and car"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "black cat"s, DocumentStatus::BANNED, {3});
+    server.AddDocument(4, "old cart"s, DocumentStatus::ACTUAL, {4});
+
+    //Сначала ближайшие, при равном расстоянии - более частые
+    const auto suggestions = server.SuggestCorrections("caz"s);
+    ASSERT_EQUAL(suggestions.size(), 4u);
+    ASSERT_EQUAL(suggestions[0].word, "cat"sv);
+    ASSERT_EQUAL(suggestions[0].document_count, 3);
+    ASSERT_EQUAL(suggestions[1].word, "car"sv);
+    ASSERT_EQUAL(suggestions[2].word, "cart"sv);
+    ASSERT_EQUAL(suggestions[2].distance, 2);
+    ASSERT_EQUAL(suggestions[3].word, "fat"sv);
+    ASSERT_EQUAL(server.SuggestCorrections("caz"s, 1).size(), 1u);
+    ASSERT(server.SuggestCorrections("cat"s, 1).front().word != "cat"sv);
+
+    ASSERT_EQUAL(server.SuggestQuery("fat ctiy -dgo in"s).value(), "fat city -dgo in"s);
+    ASSERT(!server.SuggestQuery("fat cat"s).has_value());
+    ASSERT(!server.SuggestQuery("qwerty"s).has_value());
+
+    //Термин без живых документов не предлагается ни до, ни после уплотнения
+    const auto suggests_cart = [&server]() {
+        const auto suggestions = server.SuggestCorrections("cartt"s);
+        return any_of(suggestions.begin(), suggestions.end(), [](const WordSuggestion& suggestion) {
+            return suggestion.word == "cart"sv;
+        });
+    };
+    ASSERT(suggests_cart());
+    server.RemoveDocument(4);
+    ASSERT(!suggests_cart());
+    server.Compact();
+    ASSERT(!suggests_cart());
+    server.AddDocument(5, "cart"s, DocumentStatus::ACTUAL, {});
+    ASSERT_EQUAL(server.SuggestCorrections("cartt"s).front().word, "cart"sv);
+
+    //Совпадение с перебором всего словаря на случайных опечатках
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 8);
+    SearchServer random_server(""s);
+    for (size_t id = 0; id < dictionary.size(); ++id) {
+        random_server.AddDocument(id, dictionary[id], DocumentStatus::ACTUAL, {});
+    }
+    for (int i = 0; i < 200; ++i) {
+        string word = dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        for (int edit = uniform_int_distribution(1, 2)(generator); edit > 0 && !word.empty(); --edit) {
+            word[uniform_int_distribution<size_t>(0, word.size() - 1)(generator)] = 'a' + i % 26;
+        }
+        size_t expected = 0;
+        for (const string& term : dictionary) {
+            const int distance = SpellingIndex::ComputeEditDistance(word, term, SpellingIndex::MAX_EDIT_DISTANCE);
+            expected += distance > 0 && distance <= SpellingIndex::MAX_EDIT_DISTANCE ? 1 : 0;
+        }
+        ASSERT_EQUAL(random_server.SuggestCorrections(word, dictionary.size()).size(), expected);
+    }
+}
+
+void TestMemoryResources() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 200, 8);
+    const auto documents = GenerateQueries(generator, dictionary, 300, 10);
+    const auto queries = GenerateQueries(generator, dictionary, 50, 4);
+
+    CountingResource counting;
+    {
+        pmr::unsynchronized_pool_resource pool(&counting);
+        SearchServer reference("and with"s);
+        SearchServer pooled("and with"s, MemoryOptions{&pool, true});
+        SearchServer no_arenas("and with"s, MemoryOptions{pmr::get_default_resource(), false});
+        for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+            const auto status = static_cast<DocumentStatus>(id % DOCUMENT_STATUS_COUNT);
+            reference.AddDocument(id, documents[id], status, {id % 7});
+            pooled.AddDocument(id, documents[id], status, {id % 7});
+            no_arenas.AddDocument(id, documents[id], status, {id % 7});
+        }
+        //Узлы индекса выделены из переданного ресурса
+        ASSERT(counting.allocations > 0);
+        ASSERT(counting.bytes_in_use > 0);
+
+        const auto check_same = [&]() {
+            for (const string& query : queries) {
+                const auto expected = reference.FindTopDocuments(query);
+                for (const SearchServer* server : {&pooled, &no_arenas}) {
+                    const auto found = server->FindTopDocuments(query);
+                    ASSERT_EQUAL(found.size(), expected.size());
+                    for (size_t i = 0; i < found.size(); ++i) {
+                        ASSERT_EQUAL(found[i].id, expected[i].id);
+                        ASSERT(abs(found[i].relevance - expected[i].relevance) < 1e-9);
+                    }
+                    ASSERT(get<0>(server->MatchDocument(query, 3)) == get<0>(reference.MatchDocument(query, 3)));
+                }
+            }
+            const auto expected_batch = reference.FindTopDocumentsBatch(queries, DocumentFilter());
+            const auto pooled_batch = pooled.FindTopDocumentsBatch(execution::par, queries, DocumentFilter());
+            ASSERT_EQUAL(pooled_batch.size(), expected_batch.size());
+            for (size_t i = 0; i < pooled_batch.size(); ++i) {
+                ASSERT_EQUAL(pooled_batch[i].size(), expected_batch[i].size());
+            }
+        };
+        check_same();
+
+        //Запросы не берут память из ресурса индекса
+        const size_t allocations = counting.allocations;
+        for (const string& query : queries) {
+            pooled.FindTopDocuments(execution::par, query);
+            pooled.FindTopDocumentsPage(query, PageRequest{});
+        }
+        ASSERT_EQUAL(counting.allocations, allocations);
+
+        for (int id = 0; id < static_cast<int>(documents.size()); id += 3) {
+            reference.RemoveDocument(id);
+            pooled.RemoveDocument(id);
+            no_arenas.RemoveDocument(id);
+        }
+        reference.Compact();
+        pooled.Compact();
+        no_arenas.Compact();
+        check_same();
+        ASSERT_EQUAL(pooled.GetWordFrequencies(1).size(), reference.GetWordFrequencies(1).size());
+    }
+    //Пул вернул всё вышестоящему ресурсу
+    ASSERT_EQUAL(counting.bytes_in_use, 0u);
+}
+
+void TestConcurrentHashMap() {
+    const int thread_count = 4;
+    const int key_count = 5000;
+    const int rounds = 2;
+
+    //Сложение из нескольких потоков в таблицу минимального размера: слагаемые не теряются при росте
+    ConcurrentHashMap<int, double> sums;
+    atomic_bool done = false;
+    vector<thread> writers;
+    for (int writer = 0; writer < thread_count; ++writer) {
+        writers.emplace_back([&, writer] {
+            vector<int> keys(key_count);
+            iota(keys.begin(), keys.end(), 0);
+            shuffle(keys.begin(), keys.end(), mt19937(writer));
+            for (int round = 0; round < rounds; ++round) {
+                for (const int key : keys) {
+                    sums.Add(key, 1.0);
+                }
+            }
+        });
+    }
+    //Читатель видит каждое значение только растущим и не больше итогового
+    thread reader([&] {
+        vector<double> last_seen(key_count, 0.0);
+        mt19937 generator;
+        while (!done) {
+            const int key = uniform_int_distribution(0, key_count - 1)(generator);
+            const double value = sums.Find(key).value_or(0.0);
+            ASSERT(value >= last_seen[key] && value <= thread_count * rounds);
+            last_seen[key] = value;
+        }
+    });
+    for (thread& writer : writers) {
+        writer.join();
+    }
+    done = true;
+    reader.join();
+
+    ASSERT_EQUAL(sums.size(), static_cast<size_t>(key_count));
+    ASSERT(sums.GetCapacity() >= static_cast<size_t>(key_count));
+    for (int key = 0; key < key_count; ++key) {
+        ASSERT_EQUAL(sums.Find(key).value(), thread_count * rounds * 1.0);
+    }
+    ASSERT(!sums.Find(key_count).has_value());
+    size_t visited = 0;
+    double total = 0.0;
+    sums.ForEach([&visited, &total](int, const double value) {
+        ++visited;
+        total += value;
+    });
+    ASSERT_EQUAL(visited, static_cast<size_t>(key_count));
+    ASSERT_EQUAL(total, static_cast<double>(key_count * thread_count * rounds));
+
+    //Строковые ключи: из одновременных вставок одного ключа удаётся ровно одна
+    ConcurrentHashMap<string, int> owners;
+    atomic_int inserted = 0;
+    vector<thread> inserters;
+    for (int inserter = 0; inserter < thread_count; ++inserter) {
+        inserters.emplace_back([&, inserter] {
+            for (int key = 0; key < key_count; ++key) {
+                inserted += owners.Insert("key"s + to_string(key), inserter) ? 1 : 0;
+                owners.Update("max"s, [inserter](const int value) {
+                    return max(value, inserter);
+                });
+            }
+        });
+    }
+    for (thread& inserter : inserters) {
+        inserter.join();
+    }
+    ASSERT_EQUAL(inserted.load(), key_count);
+    ASSERT_EQUAL(owners.size(), static_cast<size_t>(key_count + 1));
+    ASSERT_EQUAL(owners.Find("max"s).value(), thread_count - 1);
+    const int owner = owners.Find("key0"s).value();
+    ASSERT(owner >= 0 && owner < thread_count);
+    owners.InsertOrAssign("key0"s, -1);
+    ASSERT_EQUAL(owners.Find("key0"s).value(), -1);
+    ASSERT(!owners.Insert("key0"s, 5));
+    ASSERT_EQUAL(owners.Find("key0"s).value(), -1);
+}
+
+void TestDocumentReordering() {
+    //Документы 32 тем со своими словарями, id перемешаны и о теме ничего не говорят.
+    //Термин встречается примерно в каждом 150-м документе: по id разности постингов не влезают в байт
+    mt19937 generator;
+    const int topic_count = 32;
+    const int document_count = 2048;
+    vector<vector<string>> topics;
+    for (int topic = 0; topic < topic_count; ++topic) {
+        topics.push_back(GenerateDictionary(generator, 30, 6));
+        for (string& word : topics.back()) {
+            word += to_string(topic);
+        }
+    }
+    vector<int> ids(document_count);
+    iota(ids.begin(), ids.end(), 0);
+    shuffle(ids.begin(), ids.end(), generator);
+
+    vector<SegmentDocument> documents;
+    vector<string> texts;
+    SegmentPostings postings;
+    for (int i = 0; i < document_count; ++i) {
+        const vector<string>& topic = topics[i % topic_count];
+        documents.push_back({ids[i], DocumentStatus::ACTUAL, i % 5});
+        set<string_view> words;
+        for (int j = 0; j < 6; ++j) {
+            words.insert(topic[uniform_int_distribution<size_t>(0, topic.size() - 1)(generator)]);
+        }
+        texts.emplace_back();
+        for (const string_view word : words) {
+            postings[word].emplace_back(ids[i], 1.0 / words.size());
+            texts.back() += " "s + string(word);
+        }
+    }
+
+    const IndexSegment by_id(documents, postings);
+    IndexSegment by_similarity(documents, postings, DocumentOrder::BY_SIMILARITY);
+    ASSERT(by_similarity.GetGapEncodedPostingBytes() < by_id.GetGapEncodedPostingBytes());
+
+    //Перестановка не видна снаружи: id, атрибуты и постинги терминов те же
+    for (const SegmentDocument& document : documents) {
+        const uint32_t local = by_similarity.FindDocument(document.id);
+        ASSERT(local != IndexSegment::NOT_FOUND);
+        ASSERT_EQUAL(by_similarity.GetDocument(local).id, document.id);
+        ASSERT_EQUAL(by_similarity.GetDocument(local).rating, document.rating);
+    }
+    ASSERT_EQUAL(by_similarity.FindDocument(document_count), IndexSegment::NOT_FOUND);
+    for (const auto& [word, _] : postings) {
+        const auto collect = [word = word](const IndexSegment& segment) {
+            set<pair<int, double>> entries;
+            uint32_t previous = 0;
+            bool sorted = true;
+            for (const IndexSegment::Posting& posting : segment.GetPostings(segment.FindTerm(word))) {
+                sorted = sorted && posting.document >= previous;
+                previous = posting.document;
+                entries.emplace(segment.GetDocument(posting.document).id, posting.term_freq);
+            }
+            ASSERT(sorted);
+            return entries;
+        };
+        ASSERT(collect(by_similarity) == collect(by_id));
+    }
+    ASSERT(by_similarity.RemoveDocument(ids[0]));
+    ASSERT(by_similarity.IsDeleted(by_similarity.FindDocument(ids[0])));
+    ASSERT_EQUAL(by_similarity.GetLiveDocumentCount(), static_cast<size_t>(document_count - 1));
+
+    //Слияние с перестановкой: выдача сервера та же, что у SearchServer
+    const auto queries = GenerateQueries(generator, topics[0], 20, 3);
+    for (const DocumentOrder order : {DocumentOrder::BY_ID, DocumentOrder::BY_SIMILARITY}) {
+        SegmentPolicy policy;
+        policy.seal_document_count = 256;
+        policy.merge_factor = 2;
+        policy.background_merge = false;
+        policy.merge_order = order;
+        SegmentedSearchServer segmented(string_view(""), policy);
+        SearchServer server(""s);
+        for (int i = 0; i < document_count; ++i) {
+            segmented.AddDocument(ids[i], texts[i], DocumentStatus::ACTUAL, {i % 5});
+            server.AddDocument(ids[i], texts[i], DocumentStatus::ACTUAL, {i % 5});
+            if (i % 7 == 0) {
+                segmented.RemoveDocument(ids[i / 2]);
+                server.RemoveDocument(ids[i / 2]);
+            }
+        }
+        for (const string& query : queries) {
+            AssertSameDocuments(segmented.FindTopDocuments(query), server.FindTopDocuments(query));
+        }
+    }
+}
+
+void TestFrozenSearchServer() {
+    //Хеш-функция - биекция ключей на [0, size())
+    {
+        vector<uint64_t> hashes(10000);
+        mt19937_64 generator;
+        generate(hashes.begin(), hashes.end(), generator);
+        const MinimalPerfectHash hash(hashes);
+        vector<bool> used(hashes.size(), false);
+        for (const uint64_t key : hashes) {
+            const uint32_t index = hash.Lookup(key);
+            ASSERT(index < hashes.size());
+            ASSERT(!used[index]);
+            used[index] = true;
+        }
+        ASSERT(hash.GetMemoryUsage() < hashes.size());
+    }
+    {
+        const vector<string_view> strings = {"cat"sv, "dog"sv, "city"sv, ""sv, "catalog"sv};
+        const FrozenStringSet set(strings);
+        ASSERT_EQUAL(set.size(), strings.size());
+        for (const string_view str : strings) {
+            ASSERT_EQUAL(set.Get(set.Find(str)), str);
+        }
+        ASSERT_EQUAL(set.Find("ca"sv), FrozenStringSet::NOT_FOUND);
+        ASSERT_EQUAL(set.Find("cats"sv), FrozenStringSet::NOT_FOUND);
+        ASSERT_EQUAL(FrozenStringSet().Find("cat"sv), FrozenStringSet::NOT_FOUND);
+    }
+
+    //Выдача и сопоставление те же, что у исходного сервера после Compact
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 200, 5);
+    const auto documents = GenerateQueries(generator, dictionary, 1000, 10);
+    auto queries = GenerateQueries(generator, dictionary, 100, 4);
+    for (int i = 0; i < 20; ++i) {
+        queries.push_back(dictionary[i * 7].substr(0, 2) + "* -"s + dictionary[i * 3]);
+    }
+    SearchServer server(dictionary[0] + " "s + dictionary[1]);
+    for (int i = 0; i < static_cast<int>(documents.size()); ++i) {
+        server.AddDocument(i * 3, documents[i], static_cast<DocumentStatus>(i % DOCUMENT_STATUS_COUNT), {i % 11});
+    }
+    for (int i = 0; i < 300; i += 4) {
+        server.RemoveDocument(i * 3);
+    }
+    server.Compact();
+
+    const FrozenSearchServer frozen(server);
+    ASSERT_EQUAL(frozen.GetDocumentCount(), server.GetDocumentCount());
+    ASSERT(equal(frozen.begin(), frozen.end(), server.begin(), server.end()));
+    ASSERT(frozen.GetMemoryUsage() < server.GetMemoryStats().Total());
+
+    DocumentFilter filter = DocumentFilter::ByStatuses({DocumentStatus::ACTUAL, DocumentStatus::BANNED});
+    filter.min_rating = 3;
+    filter.min_id = 100;
+    filter.max_id = 2000;
+    const auto predicate = [](int document_id, DocumentStatus, int rating) {
+        return document_id % 2 == 0 || rating > 7;
+    };
+    for (const string& query : queries) {
+        AssertSameDocuments(frozen.FindTopDocuments(query), server.FindTopDocuments(query));
+        AssertSameDocuments(frozen.FindTopDocuments(execution::par, query, DocumentStatus::IRRELEVANT),
+                            server.FindTopDocuments(execution::par, query, DocumentStatus::IRRELEVANT));
+        AssertSameDocuments(frozen.FindTopDocuments(query, filter), server.FindTopDocuments(query, filter));
+        AssertSameDocuments(frozen.FindTopDocuments(query, predicate), server.FindTopDocuments(query, predicate));
+        for (const int document_id : {6, 12, 999, 1500}) {
+            ASSERT(frozen.MatchDocument(query, document_id) == server.MatchDocument(query, document_id));
+        }
+    }
+    ASSERT(frozen.FindTopDocuments(dictionary[0]).empty());
+    ASSERT(frozen.FindTopDocuments("zzzzzzz"s).empty());
+    ASSERT(get<1>(frozen.MatchDocument(dictionary[2], 0)) == DocumentStatus::REMOVED);
+    for (const string& query : {"cat --dog"s, "cat -"s}) {
+        try {
+            frozen.FindTopDocuments(query);
+            ASSERT_HINT(false, "invalid query must be rejected"s);
+        } catch (const invalid_argument&) {
+        }
+    }
+}
+
+void TestAdaptiveExecution() {
+    //Решения по модели стоимости
+    ExecutionCostModel model;
+    model.unit_cost_ns = {10.0, 10.0, 10.0};
+    model.parallel_overhead_ns = 10000.0;
+    model.thread_count = 8;
+    ExecutionPlanner planner;
+    planner.SetCostModel(model);
+    ASSERT(!planner.Plan(ExecutionOperation::SEARCH, 100).parallel);
+    const ExecutionDecision medium = planner.Plan(ExecutionOperation::SEARCH, 3000);
+    ASSERT(medium.parallel);
+    ASSERT_EQUAL(medium.task_count, 3u);
+    ASSERT_EQUAL(planner.Plan(ExecutionOperation::SEARCH, 1000000).task_count, 32u);
+    ASSERT_EQUAL(planner.Plan(ExecutionOperation::MATCH, 1000000).task_count, 8u);
+    model.thread_count = 1;
+    planner.SetCostModel(model);
+    ASSERT(!planner.Plan(ExecutionOperation::SEARCH, 1000000).parallel);
+
+    const ExecutionMetrics metrics = planner.GetMetrics();
+    ASSERT_EQUAL(metrics[ExecutionOperation::SEARCH].sequential, 2u);
+    ASSERT_EQUAL(metrics[ExecutionOperation::SEARCH].parallel, 2u);
+    ASSERT_EQUAL(metrics[ExecutionOperation::SEARCH].tasks, 35u);
+    ASSERT_EQUAL(metrics[ExecutionOperation::SEARCH].work, 2003100u);
+    ASSERT_EQUAL(metrics[ExecutionOperation::MATCH].parallel, 1u);
+    ASSERT_EQUAL(metrics[ExecutionOperation::REMOVE].sequential, 0u);
+    planner.ResetMetrics();
+    ASSERT_EQUAL(planner.GetMetrics()[ExecutionOperation::SEARCH].sequential, 0u);
+
+    //Работа сопоставления - число слов запроса, посчитанное без разбиения
+    for (const string_view text : {""sv, "   "sv, "cat"sv, "  fluffy  cat -dog "sv, "a b c"sv}) {
+        ASSERT_EQUAL(CountWords(text), SplitIntoWords(text).size());
+    }
+
+    //Выдача, сопоставление и удаление не зависят от принятого решения
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 100, 5);
+    const auto documents = GenerateQueries(generator, dictionary, 2000, 10);
+    const auto queries = GenerateQueries(generator, dictionary, 50, 4);
+    SearchServer server(dictionary[0]);
+    SearchServer expected(dictionary[0]);
+    for (int i = 0; i < static_cast<int>(documents.size()); ++i) {
+        server.AddDocument(i, documents[i], static_cast<DocumentStatus>(i % DOCUMENT_STATUS_COUNT), {i % 7});
+        expected.AddDocument(i, documents[i], static_cast<DocumentStatus>(i % DOCUMENT_STATUS_COUNT), {i % 7});
+    }
+    DocumentFilter filter = DocumentFilter::ByStatuses({DocumentStatus::ACTUAL, DocumentStatus::BANNED});
+    filter.min_id = 300;
+    const auto predicate = [](int document_id, DocumentStatus, int) {
+        return document_id % 3 != 0;
+    };
+    ExecutionCostModel sequential;
+    sequential.thread_count = 1;
+    ExecutionCostModel parallel;
+    parallel.thread_count = 4;
+    parallel.parallel_overhead_ns = 0.0;
+    for (const ExecutionCostModel& forced : {sequential, parallel}) {
+        server.SetExecutionCostModel(forced);
+        server.ResetExecutionMetrics();
+        for (const string& query : queries) {
+            AssertSameDocuments(server.FindTopDocuments(adaptive_execution, query), expected.FindTopDocuments(query));
+            AssertSameDocuments(server.FindTopDocuments(adaptive_execution, query, filter),
+                                expected.FindTopDocuments(query, filter));
+            AssertSameDocuments(server.FindTopDocuments(adaptive_execution, query, predicate),
+                                expected.FindTopDocuments(query, predicate));
+            auto [words, status] = server.MatchDocument(adaptive_execution, query, 42);
+            auto [expected_words, expected_status] = expected.MatchDocument(query, 42);
+            sort(words.begin(), words.end());
+            ASSERT(words == expected_words);
+            ASSERT(status == expected_status);
+        }
+        const ExecutionMetrics search_metrics = server.GetExecutionMetrics();
+        const auto& counters = search_metrics[ExecutionOperation::SEARCH];
+        ASSERT_EQUAL(counters.sequential + counters.parallel, 3 * queries.size());
+        ASSERT_EQUAL(counters.parallel > 0, forced.thread_count > 1);
+        ASSERT_EQUAL(search_metrics[ExecutionOperation::MATCH].sequential
+                     + search_metrics[ExecutionOperation::MATCH].parallel, queries.size());
+    }
+    for (int i = 0; i < 200; i += 3) {
+        server.RemoveDocument(adaptive_execution, i);
+        expected.RemoveDocument(i);
+    }
+    server.RemoveDocument(adaptive_execution, 100000);
+    ASSERT_EQUAL(server.GetDocumentCount(), expected.GetDocumentCount());
+    ASSERT_EQUAL(server.GetExecutionMetrics()[ExecutionOperation::REMOVE].parallel, 67u);
+    for (const string& query : queries) {
+        AssertSameDocuments(server.FindTopDocuments(adaptive_execution, query), expected.FindTopDocuments(query));
+    }
+
+    //Самонастройка даёт положительные цены и не меняет индекс
+    const ExecutionCostModel calibrated = server.CalibrateExecution();
+    ASSERT(calibrated.thread_count >= 1);
+    ASSERT(calibrated.parallel_overhead_ns > 0.0);
+    for (const double unit_cost : calibrated.unit_cost_ns) {
+        ASSERT(unit_cost > 0.0);
+    }
+    ASSERT_EQUAL(server.GetExecutionCostModel().parallel_overhead_ns, calibrated.parallel_overhead_ns);
+    for (const string& query : queries) {
+        AssertSameDocuments(server.FindTopDocuments(adaptive_execution, query), expected.FindTopDocuments(query));
+    }
+    //Цена удаления не замеряется
+    ASSERT_EQUAL(calibrated.unit_cost_ns[static_cast<int>(ExecutionOperation::REMOVE)],
+                 ExecutionCostModel().unit_cost_ns[static_cast<int>(ExecutionOperation::REMOVE)]);
+
+    //Документ из одних стоп-слов не попадает в прямой индекс, калибровке нечего сопоставлять
+    SearchServer stop_words_only("and"s);
+    stop_words_only.AddDocument(1, "and"s, DocumentStatus::ACTUAL, {1});
+    const ExecutionCostModel stop_words_model = stop_words_only.CalibrateExecution();
+    ASSERT_EQUAL(stop_words_model.unit_cost_ns[static_cast<int>(ExecutionOperation::MATCH)],
+                 ExecutionCostModel().unit_cost_ns[static_cast<int>(ExecutionOperation::MATCH)]);
+    //и удаляется так же, как документ со словами
+    stop_words_only.RemoveDocument(adaptive_execution, 1);
+    ASSERT_EQUAL(stop_words_only.GetDocumentCount(), 0);
+    ASSERT(!stop_words_only.GetDocumentParams(1));
+}
+
+void TestConjunctiveQuery() {
+    //Пересечение совпадает с std::set_intersection при любых длинах и диапазонах
+    mt19937 generator;
+    for (int round = 0; round < 50; ++round) {
+        vector<vector<int>> lists(1 + round % 4);
+        for (vector<int>& list : lists) {
+            const int density = uniform_int_distribution(1, 40)(generator);
+            for (int id = 0; id < 5000; ++id) {
+                if (uniform_int_distribution(0, density)(generator) == 0) {
+                    list.push_back(id);
+                }
+            }
+        }
+        const int min_id = round % 3 == 0 ? 0 : uniform_int_distribution(0, 2500)(generator);
+        const int max_id = round % 5 == 0 ? numeric_limits<int>::max() : uniform_int_distribution(2500, 5000)(generator);
+        vector<int> expected;
+        copy_if(lists[0].begin(), lists[0].end(), back_inserter(expected), [&](int id) {
+            return min_id <= id && id <= max_id;
+        });
+        vector<postings::SortedList> sorted_lists;
+        for (const vector<int>& list : lists) {
+            vector<int> intersection;
+            set_intersection(expected.begin(), expected.end(), list.begin(), list.end(), back_inserter(intersection));
+            expected = move(intersection);
+            sorted_lists.push_back({list.data(), list.size()});
+        }
+        vector<int> result;
+        postings::Intersect(sorted_lists, min_id, max_id, result);
+        ASSERT(result == expected);
+        for (const int target : {-1, 0, 17, 2500, 4999, 6000}) {
+            const size_t position = postings::Gallop(lists[0].data(), 0, lists[0].size(), target);
+            ASSERT_EQUAL(position, static_cast<size_t>(lower_bound(lists[0].begin(), lists[0].end(), target)
+                                                       - lists[0].begin()));
+        }
+    }
+
+    {
+        SearchServer server("the"s);
+        server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+        server.AddDocument(2, "cat at home"s, DocumentStatus::ACTUAL, {2});
+        server.AddDocument(3, "dog in the city"s, DocumentStatus::ACTUAL, {3});
+        const auto found = server.FindTopDocumentsConjunctive("the cat city"s);
+        ASSERT_EQUAL(found.size(), 1u);
+        ASSERT_EQUAL(found[0].id, 1);
+        ASSERT_EQUAL(server.FindTopDocumentsConjunctive("ci* in"s).size(), 2u);
+        ASSERT(server.FindTopDocumentsConjunctive("cat city -in"s).empty());
+        ASSERT(server.FindTopDocumentsConjunctive("cat mouse"s).empty());
+        ASSERT(server.FindTopDocumentsConjunctive("the"s).empty());
+    }
+
+    //Выдача - выдача обычного поиска среди документов, где есть все слова
+    const auto dictionary = GenerateDictionary(generator, 40, 4);
+    const auto documents = GenerateQueries(generator, dictionary, 2000, 12);
+    auto queries = GenerateQueries(generator, dictionary, 60, 3);
+    for (int i = 0; i < 10; ++i) {
+        queries.push_back(dictionary[i].substr(0, 1) + "* "s + dictionary[i + 10]);
+    }
+    SearchServer server(dictionary[0]);
+    for (int i = 0; i < static_cast<int>(documents.size()); ++i) {
+        server.AddDocument(i, documents[i], static_cast<DocumentStatus>(i % DOCUMENT_STATUS_COUNT), {i % 9});
+    }
+    for (int i = 0; i < 2000; i += 7) {
+        server.RemoveDocument(i);
+    }
+    DocumentFilter filter = DocumentFilter::ByStatuses({DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT});
+    filter.min_id = 150;
+    filter.max_id = 1800;
+    filter.min_rating = 2;
+    for (const string& query : queries) {
+        set<int> all_words;
+        for (const int document_id : server) {
+            const auto& word_freqs = server.GetWordFrequencies(document_id);
+            bool has_all = true;
+            for (string_view word : SplitIntoWords(query)) {
+                if (word[0] == '-' || word == dictionary[0]) {
+                    continue;
+                }
+                if (word.back() == '*') {
+                    word.remove_suffix(1);
+                    has_all = has_all && any_of(word_freqs.begin(), word_freqs.end(), [word](const auto& entry) {
+                        return entry.first.substr(0, word.size()) == word;
+                    });
+                } else {
+                    has_all = has_all && word_freqs.count(word) > 0;
+                }
+            }
+            if (has_all) {
+                all_words.insert(document_id);
+            }
+        }
+        const auto has_all_words = [&all_words](int document_id, DocumentStatus, int) {
+            return all_words.count(document_id) > 0;
+        };
+        const auto odd = [](int document_id, DocumentStatus, int) {
+            return document_id % 2 == 1;
+        };
+        const auto odd_with_all_words = [&](int document_id, DocumentStatus status, int rating) {
+            return odd(document_id, status, rating) && has_all_words(document_id, status, rating);
+        };
+        AssertSameDocuments(server.FindTopDocumentsConjunctive(query),
+                            server.FindTopDocuments(execution::seq, query,
+                                                    DocumentFilter::ByStatus(DocumentStatus::ACTUAL), has_all_words));
+        AssertSameDocuments(server.FindTopDocumentsConjunctive(query, filter),
+                            server.FindTopDocuments(execution::seq, query, filter, has_all_words));
+        AssertSameDocuments(server.FindTopDocumentsConjunctive(query, filter, odd),
+                            server.FindTopDocuments(execution::seq, query, filter, odd_with_all_words));
+    }
+}
+
+void TestTracing() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    server.AddDocument(4, "fluffy tail dog"s, DocumentStatus::ACTUAL, {1});
+
+    //Выключенная трассировка ничего не пишет
+    tracing::Clear();
+    server.FindTopDocuments("fluffy cat"s);
+    ASSERT(tracing::CollectEvents().empty());
+    if (!SEARCH_SERVER_TRACING) {
+        return;
+    }
+
+    tracing::SetEnabled(true);
+    tracing::SetSlowQueryThreshold(0ns);
+    tracing::SetSlowQuerySampling(1);
+    server.FindTopDocuments("fluffy cat -collar"s);
+    const auto find_event = [](string_view name) {
+        const auto events = tracing::CollectEvents();
+        const auto it = find_if(events.begin(), events.end(), [name](const tracing::TraceEvent& event) {
+            return event.name == name;
+        });
+        ASSERT_HINT(it != events.end(), string(name));
+        return *it;
+    };
+    const tracing::TraceEvent query = find_event("FindTopDocuments"sv);
+    for (const string_view name : {"ParseQuery"sv, "FindAllDocuments"sv, "SelectTopDocuments"sv}) {
+        const tracing::TraceEvent inner = find_event(name);
+        ASSERT(query.start_ns <= inner.start_ns);
+        ASSERT(inner.start_ns + inner.duration_ns <= query.start_ns + query.duration_ns);
+        ASSERT_EQUAL(inner.thread_id, query.thread_id);
+    }
+
+    //Журнал медленных запросов: текст и счётчики работы
+    auto slow_queries = tracing::GetSlowQueries();
+    ASSERT_EQUAL(slow_queries.size(), 1u);
+    ASSERT_EQUAL(slow_queries[0].query, "fluffy cat -collar"s);
+    ASSERT_EQUAL(slow_queries[0].counters.postings, 4u);
+    ASSERT_EQUAL(slow_queries[0].counters.minus_words, 1u);
+    ASSERT_EQUAL(slow_queries[0].counters.candidates, 2u);
+    ASSERT_EQUAL(slow_queries[0].counters.results, 2u);
+
+    //Поиск с бюджетом трассируется так же
+    tracing::Clear();
+    server.FindTopDocumentsWithin("fluffy cat -collar"s, DocumentFilter(), SearchBudget());
+    find_event("FindTopDocumentsWithin"sv);
+    find_event("SelectTopDocuments"sv);
+    slow_queries = tracing::GetSlowQueries();
+    ASSERT_EQUAL(slow_queries.size(), 1u);
+    ASSERT_EQUAL(slow_queries[0].query, "fluffy cat -collar"s);
+    ASSERT_EQUAL(slow_queries[0].counters.postings, 4u);
+    ASSERT_EQUAL(slow_queries[0].counters.results, 2u);
+
+    tracing::Clear();
+    tracing::SetSlowQuerySampling(2);
+    const vector<string> queries = {"cat"s, "dog"s, "tail"s, "eyes \"collar\""s};
+    ProcessQueries(server, queries);
+    server.MatchDocument("cat"s, 1);
+    server.FindTopDocumentsConjunctive("fluffy cat"s);
+    RemoveDuplicates(server);
+    size_t query_count = 0;
+    for (const tracing::TraceEvent& event : tracing::CollectEvents()) {
+        query_count += event.name == "FindTopDocuments"sv;
+    }
+    ASSERT_EQUAL(query_count, queries.size());
+    find_event("ProcessQueries"sv);
+    slow_queries = tracing::GetSlowQueries();
+    ASSERT_EQUAL(slow_queries.size(), 3u);
+
+    ostringstream trace;
+    tracing::WriteChromeTrace(trace);
+    const string json = trace.str();
+    ASSERT_EQUAL(json.substr(0, 16), "{\"traceEvents\":["s);
+    for (const string& part : {"\"name\":\"MatchDocument\""s, "\"name\":\"RemoveDuplicates\""s,
+                               "\"name\":\"IntersectPostings\""s, "\"ph\":\"X\""s, "\"name\":\"slow query\""s}) {
+        ASSERT_HINT(json.find(part) != string::npos, part);
+    }
+    if (any_of(slow_queries.begin(), slow_queries.end(), [](const tracing::SlowQuery& slow_query) {
+        return slow_query.query == "eyes \"collar\""s;
+    })) {
+        ASSERT(json.find("\"query\":\"eyes \\\"collar\\\"\""s) != string::npos);
+    }
+
+    //Потоки, живущие по очереди, пишут в один и тот же буфер
+    tracing::Clear();
+    for (int i = 0; i < 20; ++i) {
+        thread([]() {
+            TRACE_SPAN("short thread");
+        }).join();
+    }
+    set<uint32_t> short_thread_ids;
+    for (const tracing::TraceEvent& event : tracing::CollectEvents()) {
+        short_thread_ids.insert(event.thread_id);
+    }
+    ASSERT_EQUAL(short_thread_ids.size(), 1u);
+
+    //Кольцевой буфер потока хранит последние RING_CAPACITY интервалов
+    tracing::Clear();
+    for (size_t i = 0; i < tracing::RING_CAPACITY + 10; ++i) {
+        TRACE_SPAN("span");
+    }
+    ASSERT_EQUAL(tracing::CollectEvents().size(), tracing::RING_CAPACITY);
+
+    tracing::SetEnabled(false);
+    tracing::SetSlowQueryThreshold(10ms);
+    tracing::SetSlowQuerySampling(1);
+    tracing::Clear();
+}
+
+void TestIndexDelta() {
+    const auto directory = filesystem::temp_directory_path() / "search_server_delta_test"s;
+    const auto other_directory = filesystem::temp_directory_path() / "search_server_delta_other_test"s;
+    filesystem::remove_all(directory);
+    filesystem::remove_all(other_directory);
+    const string delta_path = (filesystem::temp_directory_path() / "search_server_test.delta"s).string();
+    const vector<string> queries = {"fat cat city"s, "dog -cat"s, "house"s};
+    const auto assert_same_index = [&queries](const DurableSearchServer& source, const IndexReplica& replica) {
+        ASSERT_EQUAL(replica.GetSequence(), source.GetLastSequence());
+        ASSERT_EQUAL(replica.GetChecksum(), source.GetChecksum());
+        ASSERT_EQUAL(ComputeIndexChecksum(replica.GetServer()), source.GetChecksum());
+        ASSERT_EQUAL(replica.GetServer().GetDocumentCount(), source.GetServer().GetDocumentCount());
+        for (const string& query : queries) {
+            AssertSameDocuments(replica.GetServer().FindTopDocuments(query),
+                                source.GetServer().FindTopDocuments(query));
+        }
+    };
+
+    IndexReplica replica;
+    {
+        DurableSearchServer source(directory.string(), "in the"s);
+        source.AddDocument(1, "fat rat in the house"s, DocumentStatus::ACTUAL, {1, 2});
+        source.AddDocument(2, "cat in the city"s, DocumentStatus::ACTUAL, {3});
+        source.AddDocument(3, "fat cat"s, DocumentStatus::BANNED, {});
+        ASSERT_EQUAL(source.GetChecksum(), ComputeIndexChecksum(source.GetServer()));
+        source.ExportDelta(0, delta_path);
+        replica.ApplyFile(delta_path);
+        assert_same_index(source, replica);
+        ASSERT(replica.GetServer().FindTopDocuments("in"s).empty());
+
+        //Удаление, замена документа и новый документ
+        source.RemoveDocument(1);
+        source.RemoveDocument(2);
+        source.AddDocument(2, "dog in the city"s, DocumentStatus::ACTUAL, {4});
+        source.AddDocument(4, "fat cat house"s, DocumentStatus::ACTUAL, {-5});
+        source.ExportDelta(replica.GetSequence(), delta_path);
+        replica.ApplyFile(delta_path);
+        assert_same_index(source, replica);
+        ASSERT(get<1>(replica.GetServer().MatchDocument("cat"s, 3)) == DocumentStatus::BANNED);
+
+        //Дельта не с того номера и повреждённая дельта не меняют реплику
+        try {
+            replica.Apply(source.ExportDelta(3));
+            ASSERT_HINT(false, "delta from a wrong sequence must be rejected"s);
+        } catch (const runtime_error&) {
+        }
+        string corrupted = source.ExportDelta(replica.GetSequence());
+        corrupted[corrupted.size() / 2] ^= 1;
+        try {
+            replica.Apply(corrupted);
+            ASSERT_HINT(false, "corrupted delta must be rejected"s);
+        } catch (const runtime_error&) {
+        }
+        assert_same_index(source, replica);
+        source.Checkpoint();
+    }
+    {
+        //После перезапуска ранние удаления неизвестны, и дельта с начала полная
+        DurableSearchServer source(directory.string(), ""s);
+        source.AddDocument(5, "cat house"s, DocumentStatus::IRRELEVANT, {1});
+        IndexReplica fresh_replica;
+        fresh_replica.Apply(source.ExportDelta(0));
+        assert_same_index(source, fresh_replica);
+        replica.Apply(source.ExportDelta(replica.GetSequence()));
+        assert_same_index(source, replica);
+    }
+    {
+        //Дельта чужого источника с подходящим номером: состояние расходится, реплика очищается
+        DurableSearchServer other(other_directory.string(), "in the"s);
+        for (int id = 10; id <= 18; ++id) {
+            other.AddDocument(id, "lonely dog"s, DocumentStatus::ACTUAL, {1});
+        }
+        ASSERT_EQUAL(other.GetLastSequence(), replica.GetSequence() + 1);
+        try {
+            replica.Apply(other.ExportDelta(replica.GetSequence()));
+            ASSERT_HINT(false, "diverged replica must be detected"s);
+        } catch (const runtime_error&) {
+        }
+        ASSERT_EQUAL(replica.GetSequence(), 0);
+        ASSERT_EQUAL(replica.GetServer().GetDocumentCount(), 0);
+    }
+    {
+        //Пакет с неотсортированными словами отвергается целиком
+        SearchServer server;
+        SearchServer::FrequencyBatch batch;
+        batch.words = {"dog"s, "cat"s};
+        batch.documents = {{1, {DocumentStatus::ACTUAL, 1}, 0, 1}, {2, {DocumentStatus::ACTUAL, 2}, 1, 2}};
+        batch.word_freqs = {{0, 1.0}, {1, 1.0}};
+        try {
+            server.AddDocumentsWithFrequencies(batch);
+            ASSERT_HINT(false, "unsorted batch words must be rejected"s);
+        } catch (const invalid_argument&) {
+        }
+        ASSERT_EQUAL(server.GetDocumentCount(), 0);
+        batch.words = {"cat"s, "dog"s};
+        server.AddDocumentsWithFrequencies(batch);
+        ASSERT_EQUAL(server.GetDocumentCount(), 2);
+        ASSERT_EQUAL(server.FindTopDocuments("dog"s).size(), 1u);
+    }
+    filesystem::remove_all(directory);
+    filesystem::remove_all(other_directory);
+    filesystem::remove(delta_path);
+}
+
 void TestSearchServer() {
     RUN_TEST(TestAddingDocument);
     RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
     RUN_TEST(TestMinusWordsExcludeDocs);
     RUN_TEST(TestMatchDocument);
+    RUN_TEST(TestMatchDocuments);
     RUN_TEST(TestRelevanceComputing);
     RUN_TEST(TestRelevanceSort);
     RUN_TEST(TestRatingCompute);
     RUN_TEST(TestPredicateFiltering);
     RUN_TEST(TestStatusFiltering);
+    RUN_TEST(TestPagination);
+    RUN_TEST(TestPaginator);
+    RUN_TEST(TestTermDictionary);
+    RUN_TEST(TestPrefixQuery);
+    RUN_TEST(TestMemoryStats);
+    RUN_TEST(TestRemoveDocument);
+    RUN_TEST(TestBulkRemoveCompaction);
+    RUN_TEST(TestSegmentedSearchServer);
+    RUN_TEST(TestConcurrentIngestion);
+    RUN_TEST(TestDurableSearchServer);
+    RUN_TEST(TestCorpusLoader);
+    RUN_TEST(TestDocumentFilter);
+    RUN_TEST(TestCompactScoring);
+    RUN_TEST(TestDocumentRangeParallelism);
+    RUN_TEST(TestSearchBudget);
+    RUN_TEST(TestBatchQueries);
+    RUN_TEST(TestQueryServer);
+    RUN_TEST(TestImpactOrderedSearch);
+    RUN_TEST(TestSpellingSuggestions);
+    RUN_TEST(TestMemoryResources);
+    RUN_TEST(TestConcurrentHashMap);
+    RUN_TEST(TestDocumentReordering);
+    RUN_TEST(TestFrozenSearchServer);
+    RUN_TEST(TestAdaptiveExecution);
+    RUN_TEST(TestConjunctiveQuery);
+    RUN_TEST(TestTracing);
+    RUN_TEST(TestIndexDelta);
 }
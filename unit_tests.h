@@ -4,9 +4,37 @@ void TestAddingDocument();
 void TestExcludeStopWordsFromAddedDocumentContent();
 void TestMinusWordsExcludeDocs();
 void TestMatchDocument();
+void TestMatchDocuments();
 void TestRelevanceSort();
 void TestRatingCompute();
 void TestPredicateFiltering();
 void TestStatusFiltering();
 void TestRelevanceComputing();
+void TestPagination();
+void TestPaginator();
+void TestTermDictionary();
+void TestPrefixQuery();
+void TestMemoryStats();
+void TestRemoveDocument();
+void TestBulkRemoveCompaction();
+void TestSegmentedSearchServer();
+void TestConcurrentIngestion();
+void TestDurableSearchServer();
+void TestCorpusLoader();
+void TestDocumentFilter();
+void TestCompactScoring();
+void TestDocumentRangeParallelism();
+void TestSearchBudget();
+void TestBatchQueries();
+void TestQueryServer();
+void TestImpactOrderedSearch();
+void TestSpellingSuggestions();
+void TestMemoryResources();
+void TestConcurrentHashMap();
+void TestDocumentReordering();
+void TestFrozenSearchServer();
+void TestAdaptiveExecution();
+void TestConjunctiveQuery();
+void TestTracing();
+void TestIndexDelta();
 void TestSearchServer();
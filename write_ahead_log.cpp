@@ -0,0 +1,232 @@
+#include "write_ahead_log.h"
+#include "binary_format.h"
+#include "index_snapshot.h"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+WriteAheadLog::WriteAheadLog(const string& path, uint64_t first_sequence, Options options)
+    : options_(options), next_sequence_(first_sequence), durable_sequence_(first_sequence - 1) {
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+        throw runtime_error("Can't open write-ahead log "s + path);
+    }
+    flusher_ = thread([this]() {
+        RunFlusher();
+    });
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    flush_cv_.notify_all();
+    flusher_.join();
+    close(fd_);
+}
+
+uint64_t WriteAheadLog::AppendAdd(int document_id, string_view text, DocumentStatus status, const vector<int>& ratings) {
+    using namespace binary_format;
+    string tail;
+    PutInt(tail, static_cast<uint8_t>(status));
+    PutInt(tail, static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        PutInt(tail, rating);
+    }
+    PutString(tail, text);
+    return Append(tail, WalRecord::Type::ADD, document_id);
+}
+
+uint64_t WriteAheadLog::AppendRemove(int document_id) {
+    return Append({}, WalRecord::Type::REMOVE, document_id);
+}
+
+uint64_t WriteAheadLog::Append(const string& payload_tail, WalRecord::Type type, int document_id) {
+    using namespace binary_format;
+    lock_guard lock(mutex_);
+    if (error_) {
+        rethrow_exception(error_);
+    }
+    const uint64_t sequence = next_sequence_++;
+
+    string payload;
+    PutInt(payload, static_cast<uint8_t>(type));
+    PutInt(payload, sequence);
+    PutInt(payload, document_id);
+    payload += payload_tail;
+
+    PutInt(pending_, static_cast<uint32_t>(payload.size()));
+    PutInt(pending_, ComputeCrc32(payload));
+    pending_ += payload;
+    if (++pending_records_ >= options_.group_commit_records) {
+        flush_cv_.notify_one();
+    }
+    return sequence;
+}
+
+void WriteAheadLog::WaitDurable(uint64_t sequence) {
+    unique_lock lock(mutex_);
+    durable_cv_.wait(lock, [this, sequence]() {
+        return durable_sequence_ >= sequence || error_;
+    });
+    if (error_) {
+        rethrow_exception(error_);
+    }
+}
+
+void WriteAheadLog::Sync() {
+    uint64_t last_sequence;
+    {
+        lock_guard lock(mutex_);
+        last_sequence = next_sequence_ - 1;
+        if (durable_sequence_ < last_sequence) {
+            //Группа считается набранной, и фоновый поток сбрасывает её, не дожидаясь задержки
+            pending_records_ = max(pending_records_, options_.group_commit_records);
+            flush_cv_.notify_one();
+        }
+    }
+    WaitDurable(last_sequence);
+}
+
+uint64_t WriteAheadLog::GetDurableSequence() const {
+    lock_guard lock(mutex_);
+    return durable_sequence_;
+}
+
+void WriteAheadLog::Truncate() {
+    unique_lock lock(mutex_);
+    //Файл отрезается, только когда все записи на диске и фоновый поток его не трогает
+    while (!error_ && (!pending_.empty() || writing_)) {
+        if (!pending_.empty()) {
+            pending_records_ = max(pending_records_, options_.group_commit_records);
+            flush_cv_.notify_one();
+        }
+        durable_cv_.wait(lock);
+    }
+    if (error_) {
+        rethrow_exception(error_);
+    }
+    if (ftruncate(fd_, 0) != 0 || fsync(fd_) != 0) {
+        throw runtime_error("Can't truncate write-ahead log"s);
+    }
+}
+
+void WriteAheadLog::RunFlusher() {
+    unique_lock lock(mutex_);
+    while (true) {
+        //Ждём, пока наберётся группа или истечёт задержка с момента первой записи группы
+        flush_cv_.wait(lock, [this]() {
+            return stopping_ || pending_records_ > 0;
+        });
+        if (!stopping_) {
+            flush_cv_.wait_for(lock, options_.group_commit_delay, [this]() {
+                return stopping_ || pending_records_ >= options_.group_commit_records;
+            });
+        }
+        if (pending_records_ == 0 && stopping_) {
+            return;
+        }
+
+        string batch;
+        batch.swap(pending_);
+        pending_records_ = 0;
+        const uint64_t batch_sequence = next_sequence_ - 1;
+        writing_ = true;
+
+        lock.unlock();
+        exception_ptr error;
+        try {
+            WriteAll(batch);
+        } catch (...) {
+            error = current_exception();
+        }
+        lock.lock();
+        writing_ = false;
+
+        //После ошибки записи журнал непригоден: все ожидающие и новые записи получат исключение
+        if (error) {
+            error_ = error;
+            durable_cv_.notify_all();
+            return;
+        }
+        durable_sequence_ = batch_sequence;
+        durable_cv_.notify_all();
+    }
+}
+
+void WriteAheadLog::WriteAll(const string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t result = write(fd_, data.data() + written, data.size() - written);
+        if (result < 0) {
+            throw runtime_error("Can't write to write-ahead log"s);
+        }
+        written += result;
+    }
+    if (fdatasync(fd_) != 0) {
+        throw runtime_error("Can't sync write-ahead log"s);
+    }
+}
+
+uint64_t WriteAheadLog::Recover(const string& path, uint64_t after_sequence,
+                                const function<void(const WalRecord&)>& apply) {
+    using namespace binary_format;
+    const optional<string> data = ReadWholeFile(path);
+    if (!data) {
+        return after_sequence;
+    }
+
+    uint64_t last_sequence = after_sequence;
+    Reader frames(*data);
+    size_t valid_size = 0;
+    while (frames.GetRemaining() > 0) {
+        uint32_t size = 0;
+        uint32_t checksum = 0;
+        string_view payload;
+        if (!frames.GetInt(size) || !frames.GetInt(checksum) || !frames.GetBytes(size, payload)
+            || ComputeCrc32(payload) != checksum) {
+            break;
+        }
+
+        WalRecord record;
+        uint8_t type = 0;
+        Reader reader(payload);
+        reader.GetInt(type);
+        reader.GetInt(record.sequence);
+        reader.GetInt(record.document_id);
+        record.type = static_cast<WalRecord::Type>(type);
+        if (record.type == WalRecord::Type::ADD) {
+            uint8_t status = 0;
+            uint32_t rating_count = 0;
+            reader.GetInt(status);
+            reader.GetInt(rating_count);
+            record.status = static_cast<DocumentStatus>(status);
+            for (uint32_t i = 0; i < rating_count && reader.IsOk(); ++i) {
+                int rating = 0;
+                reader.GetInt(rating);
+                record.ratings.push_back(rating);
+            }
+            string_view text;
+            reader.GetString(text);
+            record.text = text;
+        }
+        if (!reader.IsOk()) {
+            break;
+        }
+
+        valid_size = data->size() - frames.GetRemaining();
+        if (record.sequence > after_sequence) {
+            apply(record);
+            last_sequence = record.sequence;
+        }
+    }
+
+    if (valid_size < data->size() && truncate(path.c_str(), valid_size) != 0) {
+        throw runtime_error("Can't cut damaged tail of write-ahead log "s + path);
+    }
+    return last_sequence;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+struct WalRecord {
+    enum class Type : uint8_t {
+        ADD = 1,
+        REMOVE = 2
+    };
+
+    Type type = Type::ADD;
+    uint64_t sequence = 0;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string text;
+};
+
+/*
+ * Журнал изменений индекса, только дописывается.
+ * Каждая запись снабжена длиной и CRC32. Записи копятся в памяти и сбрасываются на диск
+ * фоновым потоком группами: по достижении group_commit_records записей или по истечении
+ * group_commit_delay, одним write и одним fsync на группу. Добавление записи не ждёт диска.
+ */
+class WriteAheadLog {
+public:
+    struct Options {
+        size_t group_commit_records = 64;
+        std::chrono::microseconds group_commit_delay{2000};
+    };
+
+    /*
+     * Открывает журнал на дозапись. Номера новых записей начинаются с first_sequence.
+     */
+    WriteAheadLog(const std::string& path, uint64_t first_sequence, Options options);
+    WriteAheadLog(const std::string& path, uint64_t first_sequence)
+        : WriteAheadLog(path, first_sequence, Options{}) {}
+
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    //Возвращают номер добавленной записи
+    uint64_t AppendAdd(int document_id, std::string_view text, DocumentStatus status, const std::vector<int>& ratings);
+    uint64_t AppendRemove(int document_id);
+
+    //Ждёт, пока запись с номером sequence и все предыдущие не окажутся на диске
+    void WaitDurable(uint64_t sequence);
+
+    //Сбрасывает на диск все добавленные записи
+    void Sync();
+
+    //Номер последней записи, гарантированно сохранённой на диске
+    uint64_t GetDurableSequence() const;
+
+    /*
+     * Сбрасывает журнал на диск и очищает его. Вызывается, когда все записи покрыты снимком.
+     * Дожидается, пока не останется несброшенных записей и фоновый поток не закончит запись,
+     * и отрезает файл под блокировкой, так что никакая запись не окажется отрезанной наполовину.
+     * Записи, добавленные одновременно с Truncate, удаляются вместе с остальными, поэтому
+     * их тоже должен покрывать снимок; иначе журнал нельзя дописывать во время Truncate.
+     */
+    void Truncate();
+
+    /*
+     * Читает журнал и вызывает apply для записей с номером больше after_sequence.
+     * Повреждённый хвост (недописанная при сбое группа) отбрасывается и отрезается от файла.
+     * Возвращает номер последней целой записи или after_sequence, если он больше.
+     */
+    static uint64_t Recover(const std::string& path, uint64_t after_sequence,
+                            const std::function<void(const WalRecord&)>& apply);
+
+private:
+    const Options options_;
+    int fd_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable flush_cv_;
+    std::condition_variable durable_cv_;
+    std::string pending_;
+    size_t pending_records_ = 0;
+    //Фоновый поток пишет группу в файл без блокировки
+    bool writing_ = false;
+    uint64_t next_sequence_;
+    uint64_t durable_sequence_;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+    std::thread flusher_;
+
+    uint64_t Append(const std::string& payload_tail, WalRecord::Type type, int document_id);
+
+    void RunFlusher();
+
+    void WriteAll(const std::string& data);
+};